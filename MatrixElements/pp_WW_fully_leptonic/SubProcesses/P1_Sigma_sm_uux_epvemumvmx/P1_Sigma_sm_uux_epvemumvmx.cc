@@ -24,6 +24,8 @@
 #include <utility> 
 #include <vector> 
 #include <map> 
+#include <algorithm> 
+#include <mutex> 
 
 #include <P1_Sigma_sm_uux_epvemumvmx.h> 
 #include <HelAmps_sm.h> 
@@ -34,6 +36,46 @@
 namespace pp_WW_fully_leptonic_sm 
 {
 
+namespace 
+{
+
+// An external wavefunction, with the momentum and mass it was evaluated for
+struct ExternalWavefunction 
+{
+  bool valid; 
+  double p[4]; 
+  double mass; 
+  std::complex<double> w[6]; 
+}; 
+
+// External wavefunctions only depend on the momentum, mass and helicity of the
+// particle. They are cached for each call site in calculate_wavefunctions(),
+// permutation of the initial state and helicity, so that each one is
+// evaluated once for all the helicity combinations, and reused by the
+// following evaluations as long as the momentum of the particle does not
+// change. The cache is thread local, so concurrent evaluations never share it.
+thread_local ExternalWavefunction externalCache[6][2][3]; 
+
+typedef void (*ExternalFunction)(double p[4], double mass, int nhel, int nsf,
+    std::complex<double> w[6]);
+
+void external(int site, bool mirrored, ExternalFunction f, double p[4], double
+    mass, int hel, int nsf, std::complex<double> w[6])
+{
+  ExternalWavefunction& entry = externalCache[site][mirrored][hel + 1]; 
+  if ( !entry.valid || entry.mass != mass || entry.p[0] != p[0] || entry.p[1]
+      != p[1] || entry.p[2] != p[2] || entry.p[3] != p[3])
+  {
+    f(p, mass, hel, nsf, entry.w); 
+    std::copy(p, p + 4, entry.p); 
+    entry.mass = mass; 
+    entry.valid = true; 
+  }
+  std::copy(entry.w, entry.w + 6, w); 
+}
+
+}
+
 //==========================================================================
 // Class member functions for calculating the matrix elements for
 // Process: u u~ > w+ w- WEIGHTED<=4 @1
@@ -60,6 +102,11 @@ P1_Sigma_sm_uux_epvemumvmx::P1_Sigma_sm_uux_epvemumvmx(const ParameterSet&
   std::string param_card = configuration.get < std::string > ("card"); 
   params.reset(new Parameters_sm(SLHA::Reader(param_card))); 
 
+  // The couplings do not depend on the event: compute them once, so that
+  // evaluating the matrix element never modifies the parameters
+  params->updateParameters(); 
+  params->updateCouplings(); 
+
   // Set external particle masses for this matrix element
   mME.push_back(std::ref(params->ZERO)); 
   mME.push_back(std::ref(params->ZERO)); 
@@ -91,10 +138,15 @@ P1_Sigma_sm_uux_epvemumvmx::P1_Sigma_sm_uux_epvemumvmx(const ParameterSet&
     }
   }; 
 
+  // Final states are identified by their index in the map
+  for (auto& finalState: mapFinalStates)
+    resolvedFinalStates.push_back( &finalState.second); 
+
 }
 
 void P1_Sigma_sm_uux_epvemumvmx::resetHelicities() 
 {
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
   for (auto& finalState: mapFinalStates)
   {
     for (auto& subProcess: finalState.second)
@@ -105,33 +157,173 @@ void P1_Sigma_sm_uux_epvemumvmx::resetHelicities()
 }
 
 
+momemta::MatrixElement::HelicityTable P1_Sigma_sm_uux_epvemumvmx::getGoodHelicities() const
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+
+  momemta::MatrixElement::HelicityTable table; 
+  for (const auto& finalState: mapFinalStates)
+  {
+    for (const auto& subProcess: finalState.second)
+    {
+      table.push_back(subProcess.goodHel); 
+    }
+  }
+
+  return table; 
+}
+
+bool P1_Sigma_sm_uux_epvemumvmx::setGoodHelicities(const
+    momemta::MatrixElement::HelicityTable & table)
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+
+  // Check the table first, so that it is either fully applied or ignored
+  size_t index = 0; 
+  for (const auto& finalState: mapFinalStates)
+  {
+    for (const auto& subProcess: finalState.second)
+    {
+      if (index >= table.size() || table[index].size() !=
+          subProcess.goodHel.size())
+        return false; 
+      index++; 
+    }
+  }
+
+  if (index != table.size())
+    return false; 
+
+  index = 0; 
+  for (auto& finalState: mapFinalStates)
+  {
+    for (auto& subProcess: finalState.second)
+    {
+      subProcess.goodHel = table[index++]; 
+      subProcess.goodHelFrozen = true; 
+    }
+  }
+
+  return true; 
+}
+
+bool P1_Sigma_sm_uux_epvemumvmx::copyGoodHelicities(const
+    SubProcess < P1_Sigma_sm_uux_epvemumvmx > &subProcess, bool goodHel[]) const
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+  std::copy(subProcess.goodHel.begin(), subProcess.goodHel.end(), goodHel); 
+  return subProcess.goodHelFrozen; 
+}
+
+void P1_Sigma_sm_uux_epvemumvmx::pruneHelicities(SubProcess <
+    P1_Sigma_sm_uux_epvemumvmx > &subProcess, const bool goodHel[])
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+  for(int ihel = 0; ihel < 64; ihel++ )
+  {
+    if( !goodHel[ihel])
+      subProcess.goodHel[ihel] = false; 
+  }
+  subProcess.goodHelFrozen = true; 
+}
+
+//--------------------------------------------------------------------------
+// Find the subprocesses for a final state
+
+momemta::MatrixElement::FinalStateHandle P1_Sigma_sm_uux_epvemumvmx::resolveFinalState(const
+    std::vector<int> & pdgIds)
+{
+  auto finalState = mapFinalStates.find(pdgIds); 
+  if (finalState == mapFinalStates.end())
+    return -1; 
+
+  return std::distance(mapFinalStates.begin(), finalState); 
+}
+
 //--------------------------------------------------------------------------
 // Evaluate |M|^2, return a map of final states
 
 std::map < std::pair < int, int > , double >
-    P1_Sigma_sm_uux_epvemumvmx::compute(const std::pair < std::vector<double> ,
-    std::vector<double> > &initialMomenta, const std::vector < std::pair < int,
-    std::vector<double> > > &finalState)
+    P1_Sigma_sm_uux_epvemumvmx::compute(const std::pair <
+    std::vector<double> , std::vector<double> > &initialMomenta, const
+    std::vector < std::pair < int, std::vector<double> > > &finalState)
 {
+  momemta::MatrixElement::FlatResult result; 
+  evaluate(initialMomenta, finalState, false, 0, result); 
+  return toResult(result); 
+}
 
-  // Set initial particle momenta
-  momenta[0] = (double * ) (&initialMomenta.first[0]); 
-  momenta[1] = (double * ) (&initialMomenta.second[0]); 
+//--------------------------------------------------------------------------
+// Evaluate |M|^2 for a single helicity combination, chosen among the
+// non-vanishing ones, and weighted by the number of non-vanishing ones
+
+std::map < std::pair < int, int > , double >
+    P1_Sigma_sm_uux_epvemumvmx::computeSampledHelicity(const std::pair <
+    std::vector<double> , std::vector<double> > &initialMomenta, const
+    std::vector < std::pair < int, std::vector<double> > > &finalState, double
+    random)
+{
+  momemta::MatrixElement::FlatResult result; 
+  evaluate(initialMomenta, finalState, true, random, result); 
+  return toResult(result); 
+}
+
+//--------------------------------------------------------------------------
+// Same as above, for a resolved final state and without any allocation
+
+void P1_Sigma_sm_uux_epvemumvmx::computeFlat(FinalStateHandle handle,
+    const double * const initialMomenta[2], const double * const
+    finalMomenta[], momemta::MatrixElement::FlatResult & result)
+{
+  evaluate(handle, initialMomenta, finalMomenta, false, 0, result); 
+}
+
+void P1_Sigma_sm_uux_epvemumvmx::computeSampledHelicityFlat(FinalStateHandle
+    handle, const double * const initialMomenta[2], const double * const
+    finalMomenta[], double random, momemta::MatrixElement::FlatResult & result)
+{
+  evaluate(handle, initialMomenta, finalMomenta, true, random, result); 
+}
+
+void P1_Sigma_sm_uux_epvemumvmx::evaluate(const std::pair <
+    std::vector<double> , std::vector<double> > &initialMomenta, const
+    std::vector < std::pair < int, std::vector<double> > > &finalState, bool
+    sampleHelicity, double random, momemta::MatrixElement::FlatResult & result)
+{
+  result.clear(); 
 
   // Suppose final particles are passed in the "correct" order
   std::vector<int> selectedFinalState(6 - 2); 
+  const double * finalMomenta[6 - 2]; 
   for (size_t index = 0; index < (6 - 2); index++ )
   {
     selectedFinalState[index] = finalState[index].first; 
-    momenta[index + 2] = (double * ) (&finalState[index].second[0]); 
+    finalMomenta[index] = &finalState[index].second[0]; 
   }
 
-  // Set the event specific parameters
-  params->updateParameters(); 
-  params->updateCouplings(); 
+  FinalStateHandle handle = resolveFinalState(selectedFinalState); 
+  if (handle < 0)
+    return; 
 
-  // Initialise result object
-  std::map < std::pair < int, int > , double > result; 
+  const double * initial[2] = {&initialMomenta.first[0],
+      &initialMomenta.second[0]};
+  evaluate(handle, initial, finalMomenta, sampleHelicity, random, result); 
+}
+
+void P1_Sigma_sm_uux_epvemumvmx::evaluate(FinalStateHandle handle, const
+    double * const initialMomenta[2], const double * const finalMomenta[], bool
+    sampleHelicity, double random, momemta::MatrixElement::FlatResult & result)
+{
+  result.clear(); 
+
+  // Scratch memory for this evaluation
+  Workspace ws; 
+
+  // Set particle momenta
+  ws.momenta[0] = (double * ) initialMomenta[0]; 
+  ws.momenta[1] = (double * ) initialMomenta[1]; 
+  for (size_t index = 0; index < (6 - 2); index++ )
+    ws.momenta[index + 2] = (double * ) finalMomenta[index]; 
 
   // Define permutation
   int perm[6]; 
@@ -140,54 +332,81 @@ std::map < std::pair < int, int > , double >
     perm[i] = i; 
   }
 
-  for(auto &me: mapFinalStates[selectedFinalState])
+  for(auto &me: *resolvedFinalStates[handle])
   {
 
     double me_sum = 0; 
     double me_mirror_sum = 0; 
 
-    for(int ihel = 0; ihel < 64; ihel++ )
+    // Work on a copy of the helicity combinations not known to vanish, so
+    // that concurrent evaluations never access the same set. Vanishing
+    // combinations are only looked for until the set is frozen
+    bool frozen = copyGoodHelicities(me, ws.goodHel); 
+
+    // Range of helicity combinations to evaluate, and weight of each of them
+    int firstHel = 0; 
+    int lastHel = 64; 
+    double helWeight = 1; 
+    if (sampleHelicity && frozen)
     {
+      // Pick a single combination among the non-vanishing ones
+      int nGoodHel = std::count(ws.goodHel, ws.goodHel + 64, true); 
+      int index = std::min < int > (random * nGoodHel, nGoodHel - 1); 
+      lastHel = 0; 
+      for(int ihel = 0; ihel < 64; ihel++ )
+      {
+        if(ws.goodHel[ihel] && index-- == 0)
+        {
+          firstHel = ihel; 
+          lastHel = ihel + 1; 
+          break; 
+        }
+      }
+      helWeight = nGoodHel; 
+    }
 
-      if(me.goodHel[ihel])
+    for(int ihel = firstHel; ihel < lastHel; ihel++ )
+    {
+
+      if(ws.goodHel[ihel])
       {
 
         double sum = 0.; 
-        calculate_wavefunctions(perm, helicities[ihel]); 
-        double meTemp = me.callback( * this); 
+        calculate_wavefunctions(perm, helicities[ihel], ws); 
+        double meTemp = me.callback(ws.amp); 
         sum += meTemp; 
-        me_sum += meTemp/me.denominator; 
+        me_sum += helWeight * meTemp/me.denominator; 
 
         if(me.hasMirrorProcess)
         {
           perm[0] = 1; 
           perm[1] = 0; 
           // Calculate wavefunctions
-          calculate_wavefunctions(perm, helicities[ihel]); 
+          calculate_wavefunctions(perm, helicities[ihel], ws); 
           // Mirror back
           perm[0] = 0; 
           perm[1] = 1; 
-          meTemp = me.callback( * this); 
+          meTemp = me.callback(ws.amp); 
           sum += meTemp; 
-          me_mirror_sum += meTemp/me.denominator; 
+          me_mirror_sum += helWeight * meTemp/me.denominator; 
         }
 
-        if( !sum)
-          me.goodHel[ihel] = false; 
+        if( !frozen && !sum)
+          ws.goodHel[ihel] = false; 
       }
     }
 
+    if ( !frozen)
+      pruneHelicities(me, ws.goodHel); 
+
     for (auto const &initialState: me.initialStates)
     {
-      result[initialState] = me_sum; 
+      result.push_back(initialState, me_sum); 
       if (me.hasMirrorProcess)
-        result[std::make_pair(initialState.second, initialState.first)] =
-            me_mirror_sum;
+        result.push_back(std::make_pair(initialState.second,
+            initialState.first), me_mirror_sum);
     }
   }
-
-
-  return result; 
 }
 
 //==========================================================================
@@ -197,19 +416,27 @@ std::map < std::pair < int, int > , double >
 // Evaluate |M|^2 for each subprocess
 
 void P1_Sigma_sm_uux_epvemumvmx::calculate_wavefunctions(const int perm[],
-    const int hel[])
+    const int hel[], Workspace & ws)
 {
-  // Calculate wavefunctions for all processes
-  static std::complex<double> w[14][18]; 
+  // Wavefunctions for all processes are stored in the workspace
+  std::complex<double> (&w)[14][18] = ws.w; 
+  std::complex<double> * amp = ws.amp; 
+  double * * momenta = ws.momenta; 
 
   // Calculate all wavefunctions
-  ixxxxx(&momenta[perm[0]][0], mME[0], hel[0], +1, w[0]); 
-  oxxxxx(&momenta[perm[1]][0], mME[1], hel[1], -1, w[1]); 
-  ixxxxx(&momenta[perm[2]][0], mME[2], hel[2], -1, w[2]); 
-  oxxxxx(&momenta[perm[3]][0], mME[3], hel[3], +1, w[3]); 
+  external(0, perm[0] != 0, ixxxxx, &momenta[perm[0]][0], mME[0], hel[0], +1,
+      w[0]);
+  external(1, perm[1] != 1, oxxxxx, &momenta[perm[1]][0], mME[1], hel[1], -1,
+      w[1]);
+  external(2, perm[2] != 2, ixxxxx, &momenta[perm[2]][0], mME[2], hel[2], -1,
+      w[2]);
+  external(3, perm[3] != 3, oxxxxx, &momenta[perm[3]][0], mME[3], hel[3], +1,
+      w[3]);
   FFV2_3(w[2], w[3], params->GC_100, params->mdl_MW, params->mdl_WW, w[4]); 
-  oxxxxx(&momenta[perm[4]][0], mME[4], hel[4], +1, w[5]); 
-  ixxxxx(&momenta[perm[5]][0], mME[5], hel[5], -1, w[6]); 
+  external(4, perm[4] != 4, oxxxxx, &momenta[perm[4]][0], mME[4], hel[4], +1,
+      w[5]);
+  external(5, perm[5] != 5, ixxxxx, &momenta[perm[5]][0], mME[5], hel[5], -1,
+      w[6]);
   FFV2_3(w[6], w[5], params->GC_100, params->mdl_MW, params->mdl_WW, w[7]); 
   FFV1P0_3(w[0], w[1], params->GC_2, params->ZERO, params->ZERO, w[8]); 
   FFV2_5_3(w[0], w[1], params->GC_51, params->GC_58, params->mdl_MZ,
@@ -230,11 +457,12 @@ void P1_Sigma_sm_uux_epvemumvmx::calculate_wavefunctions(const int perm[],
   FFV2_0(w[13], w[1], w[4], params->GC_100, amp[5]); 
 
 }
-double P1_Sigma_sm_uux_epvemumvmx::matrix_1_uux_wpwm_wp_epve_wm_mumvmx() 
+double P1_Sigma_sm_uux_epvemumvmx::matrix_1_uux_wpwm_wp_epve_wm_mumvmx(const
+    std::complex<double> amp[])
 {
 
-  static std::complex<double> ztemp; 
-  static std::complex<double> jamp[1]; 
+  std::complex<double> ztemp; 
+  std::complex<double> jamp[1]; 
   // The color matrix
   static const double denom[1] = {1}; 
   static const double cf[1][1] = {{3}}; 
@@ -255,11 +483,12 @@ double P1_Sigma_sm_uux_epvemumvmx::matrix_1_uux_wpwm_wp_epve_wm_mumvmx()
   return matrix; 
 }
 
-double P1_Sigma_sm_uux_epvemumvmx::matrix_1_ddx_wpwm_wp_epve_wm_mumvmx() 
+double P1_Sigma_sm_uux_epvemumvmx::matrix_1_ddx_wpwm_wp_epve_wm_mumvmx(const
+    std::complex<double> amp[])
 {
 
-  static std::complex<double> ztemp; 
-  static std::complex<double> jamp[1]; 
+  std::complex<double> ztemp; 
+  std::complex<double> jamp[1]; 
   // The color matrix
   static const double denom[1] = {1}; 
   static const double cf[1][1] = {{3}}; 
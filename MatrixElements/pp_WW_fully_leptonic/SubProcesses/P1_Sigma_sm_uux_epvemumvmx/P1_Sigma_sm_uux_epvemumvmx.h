@@ -27,6 +27,7 @@
 #include <utility> 
 #include <map> 
 #include <functional> 
+#include <mutex> 
 
 #include <Parameters_sm.h> 
 #include <SubProcess.h> 
@@ -66,6 +67,23 @@ class P1_Sigma_sm_uux_epvemumvmx: public momemta::MatrixElement
         &initialMomenta,
     const std::vector < std::pair < int, std::vector<double> > > &finalState); 
 
+    // Same as compute(), but only evaluate a single helicity combination,
+    // chosen among the non-vanishing ones using random
+    virtual momemta::MatrixElement::Result computeSampledHelicity(
+    const std::pair < std::vector<double> , std::vector<double> >
+        &initialMomenta,
+    const std::vector < std::pair < int, std::vector<double> > > &finalState,
+        double random);
+
+    // Allocation-free versions of the above, for a final state resolved once
+    virtual FinalStateHandle resolveFinalState(const std::vector<int> & pdgIds); 
+    virtual void computeFlat(FinalStateHandle handle, const double * const
+        initialMomenta[2], const double * const finalMomenta[],
+        momemta::MatrixElement::FlatResult & result);
+    virtual void computeSampledHelicityFlat(FinalStateHandle handle, const
+        double * const initialMomenta[2], const double * const finalMomenta[],
+        double random, momemta::MatrixElement::FlatResult & result);
+
     virtual std::shared_ptr < momemta::MEParameters > getParameters() 
     {
       return params; 
@@ -76,6 +94,12 @@ class P1_Sigma_sm_uux_epvemumvmx: public momemta::MatrixElement
     // once)
     virtual void resetHelicities(); 
 
+    // Get or restore the helicity combinations not known to vanish, for each
+    // subprocess
+    virtual momemta::MatrixElement::HelicityTable getGoodHelicities() const; 
+    virtual bool setGoodHelicities(const momemta::MatrixElement::HelicityTable
+        & table);
+
   private:
 
     // default constructor should be hidden
@@ -105,27 +129,66 @@ class P1_Sigma_sm_uux_epvemumvmx: public momemta::MatrixElement
         1}, {1, 1, 1, 1, -1, -1}, {1, 1, 1, 1, -1, 1}, {1, 1, 1, 1, 1, -1}, {1,
         1, 1, 1, 1, 1}};
 
+    // Scratch memory used to evaluate the matrix element. A new workspace is
+    // used for each call to compute(), so that different calls never share
+    // any state
+    struct Workspace 
+    {
+      // Momenta of the external particles
+      double * momenta[6]; 
+      // Wavefunctions
+      std::complex<double> w[14][18]; 
+      // Helicity combinations not known to vanish, copied from the subprocess
+      // being evaluated
+      bool goodHel[64]; 
+      // Amplitudes
+      std::complex<double> amp[6]; 
+    }; 
+
+    // Evaluate |M|^2, summing over all helicity combinations or sampling one
+    void evaluate(const std::pair < std::vector<double> , std::vector<double>
+        > &initialMomenta, const std::vector < std::pair < int,
+        std::vector<double> > > &finalState, bool sampleHelicity, double
+        random, momemta::MatrixElement::FlatResult & result);
+    void evaluate(FinalStateHandle handle, const double * const
+        initialMomenta[2], const double * const finalMomenta[], bool
+        sampleHelicity, double random, momemta::MatrixElement::FlatResult &
+        result);
+
+    // Copy the helicity combinations of a subprocess not known to vanish,
+    // returning true if they are frozen, or forget about the ones which
+    // vanished during a first evaluation and freeze them
+    bool copyGoodHelicities(const SubProcess < P1_Sigma_sm_uux_epvemumvmx > &
+        subProcess, bool goodHel[]) const;
+    void pruneHelicities(SubProcess < P1_Sigma_sm_uux_epvemumvmx > &subProcess,
+        const bool goodHel[]);
+
     // Private functions to calculate the matrix element for all subprocesses
     // Wavefunctions
-    void calculate_wavefunctions(const int perm[], const int hel[]); 
-    std::complex<double> amp[6]; 
+    void calculate_wavefunctions(const int perm[], const int hel[], Workspace &
+        ws);
 
     // Matrix elements
-    double matrix_1_uux_wpwm_wp_epve_wm_mumvmx(); 
-    double matrix_1_ddx_wpwm_wp_epve_wm_mumvmx(); 
+    static double matrix_1_uux_wpwm_wp_epve_wm_mumvmx(const std::complex<double> amp[]); 
+    static double matrix_1_ddx_wpwm_wp_epve_wm_mumvmx(const std::complex<double> amp[]); 
 
     // map of final states
     std::map < std::vector<int> , std::vector < SubProcess <
         P1_Sigma_sm_uux_epvemumvmx >> > mapFinalStates;
 
+    // Subprocesses of each final state, indexed by FinalStateHandle
+    std::vector < std::vector < SubProcess < P1_Sigma_sm_uux_epvemumvmx >> * >
+        resolvedFinalStates;
+
     // Reference to the model parameters instance passed in the constructor
     std::shared_ptr < Parameters_sm > params; 
 
+    // Protects the helicity combinations of the subprocesses, shared by all
+    // the evaluations
+    mutable std::mutex helicitiesMutex; 
+
     // vector with external particle masses
     std::vector < std::reference_wrapper<double> > mME; 
-
-    // vector with momenta (to be changed each event)
-    double * momenta[6]; 
 }; 
 
 
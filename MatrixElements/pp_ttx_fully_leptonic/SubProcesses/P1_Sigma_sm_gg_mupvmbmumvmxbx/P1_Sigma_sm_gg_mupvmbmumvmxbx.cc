@@ -24,6 +24,8 @@
 #include <utility> 
 #include <vector> 
 #include <map> 
+#include <algorithm> 
+#include <mutex> 
 
 #include <P1_Sigma_sm_gg_mupvmbmumvmxbx.h> 
 #include <HelAmps_sm.h> 
@@ -34,6 +36,64 @@
 namespace pp_ttx_fully_leptonic_sm 
 {
 
+namespace 
+{
+
+// An external wavefunction, with the momentum and mass it was evaluated for
+struct ExternalWavefunction 
+{
+  bool valid; 
+  double p[4]; 
+  double mass; 
+  std::complex<double> w[6]; 
+}; 
+
+// External wavefunctions only depend on the momentum, mass and helicity of the
+// particle. They are cached for each call site in calculate_wavefunctions(),
+// permutation of the initial state and helicity, so that each one is
+// evaluated once for all the helicity combinations, and reused by the
+// following evaluations as long as the momentum of the particle does not
+// change. The cache is thread local, so concurrent evaluations never share it.
+thread_local ExternalWavefunction externalCache[10][2][3]; 
+
+typedef void (*ExternalFunction)(double p[4], double mass, int nhel, int nsf,
+    std::complex<double> w[6]);
+
+void external(int site, bool mirrored, ExternalFunction f, double p[4], double
+    mass, int hel, int nsf, std::complex<double> w[6])
+{
+  ExternalWavefunction& entry = externalCache[site][mirrored][hel + 1]; 
+  if ( !entry.valid || entry.mass != mass || entry.p[0] != p[0] || entry.p[1]
+      != p[1] || entry.p[2] != p[2] || entry.p[3] != p[3])
+  {
+    f(p, mass, hel, nsf, entry.w); 
+    std::copy(p, p + 4, entry.p); 
+    entry.mass = mass; 
+    entry.valid = true; 
+  }
+  std::copy(entry.w, entry.w + 6, w); 
+}
+
+typedef void (*BatchExternalFunction)(double * const p[batch::NLANES], double
+    mass, int nhel, int nsf, batch::CVec w[6]);
+
+// Same as above for batches of points. Those are only cached for the duration
+// of a batch, in the workspace
+template < typename Workspace > void external(Workspace & ws, int site, bool
+    mirrored, BatchExternalFunction f, double * const p[batch::NLANES], double
+    mass, int hel, int nsf, batch::CVec w[6])
+{
+  batch::CVec * cached = ws.external[site][mirrored][hel + 1]; 
+  if ( !ws.externalCached[site][mirrored][hel + 1])
+  {
+    f(p, mass, hel, nsf, cached); 
+    ws.externalCached[site][mirrored][hel + 1] = true; 
+  }
+  std::copy(cached, cached + 6, w); 
+}
+
+}
+
 //==========================================================================
 // Class member functions for calculating the matrix elements for
 // Process: g g > t t~ WEIGHTED<=2 @1
@@ -73,6 +133,11 @@ P1_Sigma_sm_gg_mupvmbmumvmxbx::P1_Sigma_sm_gg_mupvmbmumvmxbx(const
   std::string param_card = configuration.get < std::string > ("card"); 
   params.reset(new Parameters_sm(SLHA::Reader(param_card))); 
 
+  // The couplings do not depend on the event: compute them once, so that
+  // evaluating the matrix element never modifies the parameters
+  params->updateParameters(); 
+  params->updateCouplings(); 
+
   // Set external particle masses for this matrix element
   mME.push_back(std::ref(params->ZERO)); 
   mME.push_back(std::ref(params->ZERO)); 
@@ -107,10 +172,15 @@ P1_Sigma_sm_gg_mupvmbmumvmxbx::P1_Sigma_sm_gg_mupvmbmumvmxbx(const
     }
   }; 
 
+  // Final states are identified by their index in the map
+  for (auto& finalState: mapFinalStates)
+    resolvedFinalStates.push_back( &finalState.second); 
+
 }
 
 void P1_Sigma_sm_gg_mupvmbmumvmxbx::resetHelicities() 
 {
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
   for (auto& finalState: mapFinalStates)
   {
     for (auto& subProcess: finalState.second)
@@ -121,6 +191,89 @@ void P1_Sigma_sm_gg_mupvmbmumvmxbx::resetHelicities()
 }
 
 
+momemta::MatrixElement::HelicityTable P1_Sigma_sm_gg_mupvmbmumvmxbx::getGoodHelicities() const
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+
+  momemta::MatrixElement::HelicityTable table; 
+  for (const auto& finalState: mapFinalStates)
+  {
+    for (const auto& subProcess: finalState.second)
+    {
+      table.push_back(subProcess.goodHel); 
+    }
+  }
+
+  return table; 
+}
+
+bool P1_Sigma_sm_gg_mupvmbmumvmxbx::setGoodHelicities(const
+    momemta::MatrixElement::HelicityTable & table)
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+
+  // Check the table first, so that it is either fully applied or ignored
+  size_t index = 0; 
+  for (const auto& finalState: mapFinalStates)
+  {
+    for (const auto& subProcess: finalState.second)
+    {
+      if (index >= table.size() || table[index].size() !=
+          subProcess.goodHel.size())
+        return false; 
+      index++; 
+    }
+  }
+
+  if (index != table.size())
+    return false; 
+
+  index = 0; 
+  for (auto& finalState: mapFinalStates)
+  {
+    for (auto& subProcess: finalState.second)
+    {
+      subProcess.goodHel = table[index++]; 
+      subProcess.goodHelFrozen = true; 
+    }
+  }
+
+  return true; 
+}
+
+bool P1_Sigma_sm_gg_mupvmbmumvmxbx::copyGoodHelicities(const
+    SubProcess < P1_Sigma_sm_gg_mupvmbmumvmxbx > &subProcess, bool goodHel[]) const
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+  std::copy(subProcess.goodHel.begin(), subProcess.goodHel.end(), goodHel); 
+  return subProcess.goodHelFrozen; 
+}
+
+void P1_Sigma_sm_gg_mupvmbmumvmxbx::pruneHelicities(SubProcess <
+    P1_Sigma_sm_gg_mupvmbmumvmxbx > &subProcess, const bool goodHel[])
+{
+  std::lock_guard<std::mutex> lock(helicitiesMutex); 
+  for(int ihel = 0; ihel < 256; ihel++ )
+  {
+    if( !goodHel[ihel])
+      subProcess.goodHel[ihel] = false; 
+  }
+  subProcess.goodHelFrozen = true; 
+}
+
+//--------------------------------------------------------------------------
+// Find the subprocesses for a final state
+
+momemta::MatrixElement::FinalStateHandle P1_Sigma_sm_gg_mupvmbmumvmxbx::resolveFinalState(const
+    std::vector<int> & pdgIds)
+{
+  auto finalState = mapFinalStates.find(pdgIds); 
+  if (finalState == mapFinalStates.end())
+    return -1; 
+
+  return std::distance(mapFinalStates.begin(), finalState); 
+}
+
 //--------------------------------------------------------------------------
 // Evaluate |M|^2, return a map of final states
 
@@ -129,25 +282,82 @@ std::map < std::pair < int, int > , double >
     std::vector<double> , std::vector<double> > &initialMomenta, const
     std::vector < std::pair < int, std::vector<double> > > &finalState)
 {
+  momemta::MatrixElement::FlatResult result; 
+  evaluate(initialMomenta, finalState, false, 0, result); 
+  return toResult(result); 
+}
+
+//--------------------------------------------------------------------------
+// Evaluate |M|^2 for a single helicity combination, chosen among the
+// non-vanishing ones, and weighted by the number of non-vanishing ones
+
+std::map < std::pair < int, int > , double >
+    P1_Sigma_sm_gg_mupvmbmumvmxbx::computeSampledHelicity(const std::pair <
+    std::vector<double> , std::vector<double> > &initialMomenta, const
+    std::vector < std::pair < int, std::vector<double> > > &finalState, double
+    random)
+{
+  momemta::MatrixElement::FlatResult result; 
+  evaluate(initialMomenta, finalState, true, random, result); 
+  return toResult(result); 
+}
+
+//--------------------------------------------------------------------------
+// Same as above, for a resolved final state and without any allocation
+
+void P1_Sigma_sm_gg_mupvmbmumvmxbx::computeFlat(FinalStateHandle handle,
+    const double * const initialMomenta[2], const double * const
+    finalMomenta[], momemta::MatrixElement::FlatResult & result)
+{
+  evaluate(handle, initialMomenta, finalMomenta, false, 0, result); 
+}
+
+void P1_Sigma_sm_gg_mupvmbmumvmxbx::computeSampledHelicityFlat(FinalStateHandle
+    handle, const double * const initialMomenta[2], const double * const
+    finalMomenta[], double random, momemta::MatrixElement::FlatResult & result)
+{
+  evaluate(handle, initialMomenta, finalMomenta, true, random, result); 
+}
 
-  // Set initial particle momenta
-  momenta[0] = (double * ) (&initialMomenta.first[0]); 
-  momenta[1] = (double * ) (&initialMomenta.second[0]); 
+void P1_Sigma_sm_gg_mupvmbmumvmxbx::evaluate(const std::pair <
+    std::vector<double> , std::vector<double> > &initialMomenta, const
+    std::vector < std::pair < int, std::vector<double> > > &finalState, bool
+    sampleHelicity, double random, momemta::MatrixElement::FlatResult & result)
+{
+  result.clear(); 
 
   // Suppose final particles are passed in the "correct" order
   std::vector<int> selectedFinalState(8 - 2); 
+  const double * finalMomenta[8 - 2]; 
   for (size_t index = 0; index < (8 - 2); index++ )
   {
     selectedFinalState[index] = finalState[index].first; 
-    momenta[index + 2] = (double * ) (&finalState[index].second[0]); 
+    finalMomenta[index] = &finalState[index].second[0]; 
   }
 
-  // Set the event specific parameters
-  params->updateParameters(); 
-  params->updateCouplings(); 
+  FinalStateHandle handle = resolveFinalState(selectedFinalState); 
+  if (handle < 0)
+    return; 
+
+  const double * initial[2] = {&initialMomenta.first[0],
+      &initialMomenta.second[0]};
+  evaluate(handle, initial, finalMomenta, sampleHelicity, random, result); 
+}
+
+void P1_Sigma_sm_gg_mupvmbmumvmxbx::evaluate(FinalStateHandle handle, const
+    double * const initialMomenta[2], const double * const finalMomenta[], bool
+    sampleHelicity, double random, momemta::MatrixElement::FlatResult & result)
+{
+  result.clear(); 
 
-  // Initialise result object
-  std::map < std::pair < int, int > , double > result; 
+  // Scratch memory for this evaluation
+  Workspace ws; 
+
+  // Set particle momenta
+  ws.momenta[0] = (double * ) initialMomenta[0]; 
+  ws.momenta[1] = (double * ) initialMomenta[1]; 
+  for (size_t index = 0; index < (8 - 2); index++ )
+    ws.momenta[index + 2] = (double * ) finalMomenta[index]; 
 
   // Define permutation
   int perm[8]; 
@@ -156,54 +366,224 @@ std::map < std::pair < int, int > , double >
     perm[i] = i; 
   }
 
-  for(auto &me: mapFinalStates[selectedFinalState])
+  for(auto &me: *resolvedFinalStates[handle])
   {
 
     double me_sum = 0; 
     double me_mirror_sum = 0; 
 
-    for(int ihel = 0; ihel < 256; ihel++ )
+    // Work on a copy of the helicity combinations not known to vanish, so
+    // that concurrent evaluations never access the same set. Vanishing
+    // combinations are only looked for until the set is frozen
+    bool frozen = copyGoodHelicities(me, ws.goodHel); 
+
+    // Range of helicity combinations to evaluate, and weight of each of them
+    int firstHel = 0; 
+    int lastHel = 256; 
+    double helWeight = 1; 
+    if (sampleHelicity && frozen)
+    {
+      // Pick a single combination among the non-vanishing ones
+      int nGoodHel = std::count(ws.goodHel, ws.goodHel + 256, true); 
+      int index = std::min < int > (random * nGoodHel, nGoodHel - 1); 
+      lastHel = 0; 
+      for(int ihel = 0; ihel < 256; ihel++ )
+      {
+        if(ws.goodHel[ihel] && index-- == 0)
+        {
+          firstHel = ihel; 
+          lastHel = ihel + 1; 
+          break; 
+        }
+      }
+      helWeight = nGoodHel; 
+    }
+
+    for(int ihel = firstHel; ihel < lastHel; ihel++ )
     {
 
-      if(me.goodHel[ihel])
+      if(ws.goodHel[ihel])
       {
 
         double sum = 0.; 
-        calculate_wavefunctions(perm, helicities[ihel]); 
-        double meTemp = me.callback( * this); 
+        calculate_wavefunctions(perm, helicities[ihel], ws); 
+        double meTemp = me.callback(ws.amp); 
         sum += meTemp; 
-        me_sum += meTemp/me.denominator; 
+        me_sum += helWeight * meTemp/me.denominator; 
 
         if(me.hasMirrorProcess)
         {
           perm[0] = 1; 
           perm[1] = 0; 
           // Calculate wavefunctions
-          calculate_wavefunctions(perm, helicities[ihel]); 
+          calculate_wavefunctions(perm, helicities[ihel], ws); 
           // Mirror back
           perm[0] = 0; 
           perm[1] = 1; 
-          meTemp = me.callback( * this); 
+          meTemp = me.callback(ws.amp); 
           sum += meTemp; 
-          me_mirror_sum += meTemp/me.denominator; 
+          me_mirror_sum += helWeight * meTemp/me.denominator; 
         }
 
-        if( !sum)
-          me.goodHel[ihel] = false; 
+        if( !frozen && !sum)
+          ws.goodHel[ihel] = false; 
       }
     }
 
+    if ( !frozen)
+      pruneHelicities(me, ws.goodHel); 
+
     for (auto const &initialState: me.initialStates)
     {
-      result[initialState] = me_sum; 
+      result.push_back(initialState, me_sum); 
       if (me.hasMirrorProcess)
-        result[std::make_pair(initialState.second, initialState.first)] =
-            me_mirror_sum;
+        result.push_back(std::make_pair(initialState.second,
+            initialState.first), me_mirror_sum);
     }
   }
+}
+
+//--------------------------------------------------------------------------
+// Evaluate |M|^2 for several phase-space points, return a map of final states
+// for each point
+
+std::vector < std::map < std::pair < int, int > , double > >
+    P1_Sigma_sm_gg_mupvmbmumvmxbx::computeBatch(const std::vector < std::pair
+    < std::vector<double> , std::vector<double> >> &initialMomenta, const
+    std::vector < std::vector < std::pair < int, std::vector<double> > >>
+    &finalStates)
+{
+  using batch::NLANES; 
 
+  std::vector < std::map < std::pair < int, int > , double > >
+      results(initialMomenta.size());
 
-  return result; 
+  // Scratch memory for this evaluation
+  BatchWorkspace ws; 
+
+  for (size_t first = 0; first < initialMomenta.size(); first += NLANES)
+  {
+    size_t n_points = std::min < size_t > (NLANES, initialMomenta.size() -
+        first);
+
+    // All the points of a batch must share the same final state. If that is
+    // not the case, fall back to the scalar evaluation
+    std::vector<int> selectedFinalState(8 - 2); 
+    for (size_t index = 0; index < (8 - 2); index++ )
+      selectedFinalState[index] = finalStates[first][index].first; 
+
+    bool sameFinalState = true; 
+    for (size_t point = first + 1; point < first + n_points; point++ )
+    {
+      for (size_t index = 0; index < (8 - 2); index++ )
+        sameFinalState &= (finalStates[point][index].first ==
+            selectedFinalState[index]);
+    }
+
+    if ( !sameFinalState)
+    {
+      for (size_t point = first; point < first + n_points; point++ )
+        results[point] = compute(initialMomenta[point], finalStates[point]); 
+      continue; 
+    }
+
+    auto subProcesses = mapFinalStates.find(selectedFinalState); 
+    if (subProcesses == mapFinalStates.end())
+      continue; 
+
+    // Set particle momenta. Unused lanes of the last batch are filled with the
+    // last point, and their result discarded
+    for (size_t lane = 0; lane < NLANES; lane++ )
+    {
+      size_t point = first + std::min(lane, n_points - 1); 
+      ws.momenta[0][lane] = (double * ) (&initialMomenta[point].first[0]); 
+      ws.momenta[1][lane] = (double * ) (&initialMomenta[point].second[0]); 
+      for (size_t index = 0; index < (8 - 2); index++ )
+        ws.momenta[index + 2][lane] = (double * )
+            (&finalStates[point][index].second[0]);
+    }
+    std::fill( &ws.externalCached[0][0][0], &ws.externalCached[0][0][0] +
+        sizeof(ws.externalCached)/sizeof(ws.externalCached[0][0][0]), false);
+
+    // Define permutation
+    int perm[8]; 
+    for(int i = 0; i < 8; i++ )
+    {
+      perm[i] = i; 
+    }
+
+    // Evaluate the matrix element for each lane, from the batched amplitudes
+    auto evaluate = [&ws](SubProcess < P1_Sigma_sm_gg_mupvmbmumvmxbx > & me,
+        double sum[], double me_sum[])
+    {
+      std::complex<double> amp[4]; 
+      for (size_t lane = 0; lane < NLANES; lane++ )
+      {
+        for (size_t i = 0; i < 4; i++ )
+          amp[i] = ws.amp[i].get(lane); 
+        double meTemp = me.callback(amp); 
+        sum[lane] += meTemp; 
+        me_sum[lane] += meTemp/me.denominator; 
+      }
+    }; 
+
+    for(auto &me: subProcesses->second)
+    {
+
+      double me_sum[NLANES] = {0}; 
+      double me_mirror_sum[NLANES] = {0}; 
+
+      bool frozen = copyGoodHelicities(me, ws.goodHel); 
+
+      for(int ihel = 0; ihel < 256; ihel++ )
+      {
+
+        if(ws.goodHel[ihel])
+        {
+
+          double sum[NLANES] = {0}; 
+          calculate_wavefunctions(perm, helicities[ihel], ws); 
+          evaluate(me, sum, me_sum); 
+
+          if(me.hasMirrorProcess)
+          {
+            perm[0] = 1; 
+            perm[1] = 0; 
+            // Calculate wavefunctions
+            calculate_wavefunctions(perm, helicities[ihel], ws); 
+            // Mirror back
+            perm[0] = 0; 
+            perm[1] = 1; 
+            evaluate(me, sum, me_mirror_sum); 
+          }
+
+          // Only forget about this helicity if it vanishes for all the points
+          bool zero = true; 
+          for (size_t lane = 0; lane < n_points; lane++ )
+            zero &= !sum[lane]; 
+          if( !frozen && zero)
+            ws.goodHel[ihel] = false; 
+        }
+      }
+
+      if ( !frozen)
+        pruneHelicities(me, ws.goodHel); 
+
+      for (size_t lane = 0; lane < n_points; lane++ )
+      {
+        auto& result = results[first + lane]; 
+        for (auto const &initialState: me.initialStates)
+        {
+          result[initialState] = me_sum[lane]; 
+          if (me.hasMirrorProcess)
+            result[std::make_pair(initialState.second, initialState.first)] =
+                me_mirror_sum[lane];
+        }
+      }
+    }
+  }
+
+  return results; 
 }
 
 //==========================================================================
@@ -213,29 +593,89 @@ std::map < std::pair < int, int > , double >
 // Evaluate |M|^2 for each subprocess
 
 void P1_Sigma_sm_gg_mupvmbmumvmxbx::calculate_wavefunctions(const int perm[],
-    const int hel[])
+    const int hel[], Workspace & ws)
 {
-  // Calculate wavefunctions for all processes
-  static std::complex<double> w[18][18]; 
+  // Wavefunctions for all processes are stored in the workspace
+  std::complex<double> (&w)[18][18] = ws.w; 
+  std::complex<double> * amp = ws.amp; 
+  double * * momenta = ws.momenta; 
 
   // Calculate all wavefunctions
-  vxxxxx(&momenta[perm[0]][0], mME[0], hel[0], -1, w[0]); 
-  vxxxxx(&momenta[perm[1]][0], mME[1], hel[1], -1, w[1]); 
-  ixxxxx(&momenta[perm[2]][0], mME[2], hel[2], -1, w[2]); 
-  oxxxxx(&momenta[perm[3]][0], mME[3], hel[3], +1, w[3]); 
+  external(0, perm[0] != 0, vxxxxx, &momenta[perm[0]][0], mME[0], hel[0], -1,
+      w[0]);
+  external(1, perm[1] != 1, vxxxxx, &momenta[perm[1]][0], mME[1], hel[1], -1,
+      w[1]);
+  external(2, perm[2] != 2, ixxxxx, &momenta[perm[2]][0], mME[2], hel[2], -1,
+      w[2]);
+  external(3, perm[3] != 3, oxxxxx, &momenta[perm[3]][0], mME[3], hel[3], +1,
+      w[3]);
+  FFV2_3(w[2], w[3], params->GC_100, params->mdl_MW, params->mdl_WW, w[4]); 
+  external(4, perm[4] != 4, oxxxxx, &momenta[perm[4]][0], mME[4], hel[4], +1,
+      w[5]);
+  FFV2_1(w[5], w[4], params->GC_100, params->mdl_MT, params->mdl_WT, w[6]); 
+  external(5, perm[5] != 5, oxxxxx, &momenta[perm[5]][0], mME[5], hel[5], +1,
+      w[7]);
+  external(6, perm[6] != 6, ixxxxx, &momenta[perm[6]][0], mME[6], hel[6], -1,
+      w[8]);
+  FFV2_3(w[8], w[7], params->GC_100, params->mdl_MW, params->mdl_WW, w[9]); 
+  external(7, perm[7] != 7, ixxxxx, &momenta[perm[7]][0], mME[7], hel[7], -1,
+      w[10]);
+  FFV2_2(w[10], w[9], params->GC_100, params->mdl_MT, params->mdl_WT, w[11]); 
+  VVV1P0_1(w[0], w[1], params->GC_10, params->ZERO, params->ZERO, w[12]); 
+  FFV1_1(w[6], w[0], params->GC_11, params->mdl_MT, params->mdl_WT, w[13]); 
+  FFV1_2(w[11], w[0], params->GC_11, params->mdl_MT, params->mdl_WT, w[14]); 
+  external(8, perm[0] != 0, ixxxxx, &momenta[perm[0]][0], mME[0], hel[0], +1,
+      w[15]);
+  external(9, perm[1] != 1, oxxxxx, &momenta[perm[1]][0], mME[1], hel[1], -1,
+      w[16]);
+  FFV1P0_3(w[15], w[16], params->GC_11, params->ZERO, params->ZERO, w[17]); 
+
+  // Calculate all amplitudes
+  // Amplitude(s) for diagram number 0
+  FFV1_0(w[11], w[6], w[12], params->GC_11, amp[0]); 
+  FFV1_0(w[11], w[13], w[1], params->GC_11, amp[1]); 
+  FFV1_0(w[14], w[6], w[1], params->GC_11, amp[2]); 
+  FFV1_0(w[11], w[6], w[17], params->GC_11, amp[3]); 
+
+}
+void P1_Sigma_sm_gg_mupvmbmumvmxbx::calculate_wavefunctions(const int perm[],
+    const int hel[], BatchWorkspace & ws)
+{
+  using namespace batch; 
+
+  // Wavefunctions for all processes are stored in the workspace
+  CVec (&w)[18][18] = ws.w; 
+  CVec * amp = ws.amp; 
+  double * (&momenta)[8][NLANES] = ws.momenta; 
+
+  // Calculate all wavefunctions, for all lanes at once
+  external(ws, 0, perm[0] != 0, vxxxxx, momenta[perm[0]], mME[0], hel[0], -1,
+      w[0]);
+  external(ws, 1, perm[1] != 1, vxxxxx, momenta[perm[1]], mME[1], hel[1], -1,
+      w[1]);
+  external(ws, 2, perm[2] != 2, ixxxxx, momenta[perm[2]], mME[2], hel[2], -1,
+      w[2]);
+  external(ws, 3, perm[3] != 3, oxxxxx, momenta[perm[3]], mME[3], hel[3], +1,
+      w[3]);
   FFV2_3(w[2], w[3], params->GC_100, params->mdl_MW, params->mdl_WW, w[4]); 
-  oxxxxx(&momenta[perm[4]][0], mME[4], hel[4], +1, w[5]); 
+  external(ws, 4, perm[4] != 4, oxxxxx, momenta[perm[4]], mME[4], hel[4], +1,
+      w[5]);
   FFV2_1(w[5], w[4], params->GC_100, params->mdl_MT, params->mdl_WT, w[6]); 
-  oxxxxx(&momenta[perm[5]][0], mME[5], hel[5], +1, w[7]); 
-  ixxxxx(&momenta[perm[6]][0], mME[6], hel[6], -1, w[8]); 
+  external(ws, 5, perm[5] != 5, oxxxxx, momenta[perm[5]], mME[5], hel[5], +1,
+      w[7]);
+  external(ws, 6, perm[6] != 6, ixxxxx, momenta[perm[6]], mME[6], hel[6], -1,
+      w[8]);
   FFV2_3(w[8], w[7], params->GC_100, params->mdl_MW, params->mdl_WW, w[9]); 
-  ixxxxx(&momenta[perm[7]][0], mME[7], hel[7], -1, w[10]); 
+  external(ws, 7, perm[7] != 7, ixxxxx, momenta[perm[7]], mME[7], hel[7], -1,
+      w[10]);
   FFV2_2(w[10], w[9], params->GC_100, params->mdl_MT, params->mdl_WT, w[11]); 
   VVV1P0_1(w[0], w[1], params->GC_10, params->ZERO, params->ZERO, w[12]); 
   FFV1_1(w[6], w[0], params->GC_11, params->mdl_MT, params->mdl_WT, w[13]); 
   FFV1_2(w[11], w[0], params->GC_11, params->mdl_MT, params->mdl_WT, w[14]); 
-  ixxxxx(&momenta[perm[0]][0], mME[0], hel[0], +1, w[15]); 
-  oxxxxx(&momenta[perm[1]][0], mME[1], hel[1], -1, w[16]); 
+  external(ws, 8, perm[0] != 0, ixxxxx, momenta[perm[0]], mME[0], hel[0], +1,
+      w[15]);
+  external(ws, 9, perm[1] != 1, oxxxxx, momenta[perm[1]], mME[1], hel[1], -1,
+      w[16]);
   FFV1P0_3(w[15], w[16], params->GC_11, params->ZERO, params->ZERO, w[17]); 
 
   // Calculate all amplitudes
@@ -246,11 +686,12 @@ void P1_Sigma_sm_gg_mupvmbmumvmxbx::calculate_wavefunctions(const int perm[],
   FFV1_0(w[11], w[6], w[17], params->GC_11, amp[3]); 
 
 }
-double P1_Sigma_sm_gg_mupvmbmumvmxbx::matrix_1_gg_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx() 
+double P1_Sigma_sm_gg_mupvmbmumvmxbx::matrix_1_gg_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx(const
+    std::complex<double> amp[])
 {
 
-  static std::complex<double> ztemp; 
-  static std::complex<double> jamp[2]; 
+  std::complex<double> ztemp; 
+  std::complex<double> jamp[2]; 
   // The color matrix
   static const double denom[2] = {3, 3}; 
   static const double cf[2][2] = {{16, -2}, {-2, 16}}; 
@@ -273,11 +714,12 @@ double P1_Sigma_sm_gg_mupvmbmumvmxbx::matrix_1_gg_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_
   return matrix; 
 }
 
-double P1_Sigma_sm_gg_mupvmbmumvmxbx::matrix_1_uux_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx() 
+double P1_Sigma_sm_gg_mupvmbmumvmxbx::matrix_1_uux_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx(const
+    std::complex<double> amp[])
 {
 
-  static std::complex<double> ztemp; 
-  static std::complex<double> jamp[2]; 
+  std::complex<double> ztemp; 
+  std::complex<double> jamp[2]; 
   // The color matrix
   static const double denom[2] = {1, 1}; 
   static const double cf[2][2] = {{9, 3}, {3, 9}}; 
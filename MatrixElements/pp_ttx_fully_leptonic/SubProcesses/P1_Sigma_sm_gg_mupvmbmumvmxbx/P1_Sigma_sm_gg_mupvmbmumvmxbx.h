@@ -27,7 +27,9 @@
 #include <utility> 
 #include <map> 
 #include <functional> 
+#include <mutex> 
 
+#include <HelAmps_sm_batch.h> 
 #include <Parameters_sm.h> 
 #include <SubProcess.h> 
 
@@ -79,6 +81,31 @@ class P1_Sigma_sm_gg_mupvmbmumvmxbx: public momemta::MatrixElement
         &initialMomenta,
     const std::vector < std::pair < int, std::vector<double> > > &finalState); 
 
+    // Same as compute(), but only evaluate a single helicity combination,
+    // chosen among the non-vanishing ones using random
+    virtual momemta::MatrixElement::Result computeSampledHelicity(
+    const std::pair < std::vector<double> , std::vector<double> >
+        &initialMomenta,
+    const std::vector < std::pair < int, std::vector<double> > > &finalState,
+        double random);
+
+    // Allocation-free versions of the above, for a final state resolved once
+    virtual FinalStateHandle resolveFinalState(const std::vector<int> & pdgIds); 
+    virtual void computeFlat(FinalStateHandle handle, const double * const
+        initialMomenta[2], const double * const finalMomenta[],
+        momemta::MatrixElement::FlatResult & result);
+    virtual void computeSampledHelicityFlat(FinalStateHandle handle, const
+        double * const initialMomenta[2], const double * const finalMomenta[],
+        double random, momemta::MatrixElement::FlatResult & result);
+
+    // Calculate the cross section for several phase-space points, evaluating
+    // batch::NLANES points at once
+    virtual std::vector < momemta::MatrixElement::Result > computeBatch(
+    const std::vector < std::pair < std::vector<double> , std::vector<double>
+        >> &initialMomenta,
+    const std::vector < std::vector < std::pair < int, std::vector<double> >
+        >> &finalStates);
+
     virtual std::shared_ptr < momemta::MEParameters > getParameters() 
     {
       return params; 
@@ -89,6 +116,12 @@ class P1_Sigma_sm_gg_mupvmbmumvmxbx: public momemta::MatrixElement
     // once)
     void resetHelicities(); 
 
+    // Get or restore the helicity combinations not known to vanish, for each
+    // subprocess
+    virtual momemta::MatrixElement::HelicityTable getGoodHelicities() const; 
+    virtual bool setGoodHelicities(const momemta::MatrixElement::HelicityTable
+        & table);
+
   private:
 
     // default constructor should be hidden
@@ -206,27 +239,86 @@ class P1_Sigma_sm_gg_mupvmbmumvmxbx: public momemta::MatrixElement
         {1, 1, 1, 1, 1, 1, -1, 1}, {1, 1, 1, 1, 1, 1, 1, -1}, {1, 1, 1, 1, 1,
         1, 1, 1}};
 
+    // Scratch memory used to evaluate the matrix element. A new workspace is
+    // used for each call to compute(), so that different calls never share
+    // any state
+    struct Workspace 
+    {
+      // Momenta of the external particles
+      double * momenta[8]; 
+      // Wavefunctions
+      std::complex<double> w[18][18]; 
+      // Helicity combinations not known to vanish, copied from the subprocess
+      // being evaluated
+      bool goodHel[256]; 
+      // Amplitudes
+      std::complex<double> amp[4]; 
+    }; 
+
+    // Same as Workspace, holding batch::NLANES phase-space points
+    struct BatchWorkspace 
+    {
+      // Momenta of the external particles, for each lane
+      double * momenta[8][batch::NLANES]; 
+      // Wavefunctions
+      batch::CVec w[18][18]; 
+      // Helicity combinations not known to vanish, copied from the subprocess
+      // being evaluated
+      bool goodHel[256]; 
+      // Amplitudes
+      batch::CVec amp[4]; 
+      // External wavefunctions already evaluated for the current points,
+      // indexed by call site, permutation and helicity
+      batch::CVec external[10][2][3][6]; 
+      bool externalCached[10][2][3]; 
+    }; 
+
+    // Evaluate |M|^2, summing over all helicity combinations or sampling one
+    void evaluate(const std::pair < std::vector<double> , std::vector<double>
+        > &initialMomenta, const std::vector < std::pair < int,
+        std::vector<double> > > &finalState, bool sampleHelicity, double
+        random, momemta::MatrixElement::FlatResult & result);
+    void evaluate(FinalStateHandle handle, const double * const
+        initialMomenta[2], const double * const finalMomenta[], bool
+        sampleHelicity, double random, momemta::MatrixElement::FlatResult &
+        result);
+
+    // Copy the helicity combinations of a subprocess not known to vanish,
+    // returning true if they are frozen, or forget about the ones which
+    // vanished during a first evaluation and freeze them
+    bool copyGoodHelicities(const SubProcess < P1_Sigma_sm_gg_mupvmbmumvmxbx > &
+        subProcess, bool goodHel[]) const;
+    void pruneHelicities(SubProcess < P1_Sigma_sm_gg_mupvmbmumvmxbx > &subProcess,
+        const bool goodHel[]);
+
     // Private functions to calculate the matrix element for all subprocesses
     // Wavefunctions
-    void calculate_wavefunctions(const int perm[], const int hel[]); 
-    std::complex<double> amp[4]; 
+    void calculate_wavefunctions(const int perm[], const int hel[], Workspace &
+        ws);
+    void calculate_wavefunctions(const int perm[], const int hel[],
+        BatchWorkspace & ws);
 
     // Matrix elements
-    double matrix_1_gg_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx(); 
-    double matrix_1_uux_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx(); 
+    static double matrix_1_gg_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx(const std::complex<double> amp[]); 
+    static double matrix_1_uux_ttx_t_wpb_wp_mupvm_tx_wmbx_wm_mumvmx(const std::complex<double> amp[]); 
 
     // map of final states
     std::map < std::vector<int> , std::vector < SubProcess <
         P1_Sigma_sm_gg_mupvmbmumvmxbx >> > mapFinalStates;
 
+    // Subprocesses of each final state, indexed by FinalStateHandle
+    std::vector < std::vector < SubProcess < P1_Sigma_sm_gg_mupvmbmumvmxbx >> * >
+        resolvedFinalStates;
+
     // Reference to the model parameters instance passed in the constructor
     std::shared_ptr < Parameters_sm > params; 
 
+    // Protects the helicity combinations of the subprocesses, shared by all
+    // the evaluations
+    mutable std::mutex helicitiesMutex; 
+
     // vector with external particle masses
     std::vector < std::reference_wrapper<double> > mME; 
-
-    // vector with momenta (to be changed each event)
-    double * momenta[8]; 
 }; 
 
 
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <complex>
+#include <functional>
 #include <vector> 
 #include <utility>
 
@@ -30,25 +32,31 @@ namespace pp_ttx_fully_leptonic_sm {
     template<class T>
     struct SubProcess {
         public:
-            using Callback = std::function<double(T&)>;
+            // Evaluate the matrix element from the amplitudes
+            using Callback = std::function<double(const std::complex<double>*)>;
     
             SubProcess(const Callback& callback, bool mirror, const std::vector<std::pair<int, int>>& iniStates, int ncomb, int denom):
                 callback(callback), 
                 hasMirrorProcess(mirror), 
                 initialStates(iniStates), 
                 goodHel(ncomb, true), 
+                goodHelFrozen(false), 
                 denominator(denom) {
                     // Empty
                 }
 
             void resetHelicities() {
                 std::fill(goodHel.begin(), goodHel.end(), true);
+                goodHelFrozen = false;
             }
     
             Callback callback;
             bool hasMirrorProcess; 
             std::vector<std::pair<int, int>> initialStates; 
             std::vector<bool> goodHel; 
+            // True once goodHel is final: after a first evaluation summing over all the
+            // helicity combinations, or once restored from a table
+            bool goodHelFrozen;
             int denominator;
     
         private:
@@ -0,0 +1,300 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <HelAmps_sm_batch.h>
+#include <HelAmps_sm.h>
+
+namespace pp_ttx_fully_leptonic_sm {
+namespace batch {
+
+namespace {
+    template <typename Function>
+    void external(double * const p[NLANES], CVec wf[6], Function f) {
+        std::complex<double> lane[6];
+        for (int l = 0; l < NLANES; l++) {
+            f(p[l], lane);
+            for (int i = 0; i < 6; i++)
+                wf[i].set(l, lane[i]);
+        }
+    }
+}
+
+void ixxxxx(double * const p[NLANES], double fmass, int nhel, int nsf, CVec fi[6]) {
+    external(p, fi, [&](double* p, std::complex<double>* wf) {
+        pp_ttx_fully_leptonic_sm::ixxxxx(p, fmass, nhel, nsf, wf);
+    });
+}
+
+void oxxxxx(double * const p[NLANES], double fmass, int nhel, int nsf, CVec fo[6]) {
+    external(p, fo, [&](double* p, std::complex<double>* wf) {
+        pp_ttx_fully_leptonic_sm::oxxxxx(p, fmass, nhel, nsf, wf);
+    });
+}
+
+void vxxxxx(double * const p[NLANES], double vmass, int nhel, int nsv, CVec vc[6]) {
+    external(p, vc, [&](double* p, std::complex<double>* wf) {
+        pp_ttx_fully_leptonic_sm::vxxxxx(p, vmass, nhel, nsv, wf);
+    });
+}
+
+// The vertices below are copied from HelAmps_sm.cc, with each complex number replaced by a CVec
+// and each real number depending on the kinematics by a RVec.
+
+void FFV2_3(const CVec F1[], const CVec F2[], std::complex<double> COUP, double M3, double W3, CVec V3[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  CVec denom; 
+  CVec TMP0; 
+  RVec P3[4]; 
+  double OM3; 
+  OM3 = 0.; 
+  if (M3 != 0.)
+    OM3 = 1./(M3 * M3); 
+  V3[0] = +F1[0] + F2[0]; 
+  V3[1] = +F1[1] + F2[1]; 
+  P3[0] = -V3[0].real(); 
+  P3[1] = -V3[1].real(); 
+  P3[2] = -V3[1].imag(); 
+  P3[3] = -V3[0].imag(); 
+  TMP0 = (F1[2] * (F2[4] * (P3[0] + P3[3]) + F2[5] * (P3[1] + cI * (P3[2]))) +
+      F1[3] * (F2[4] * (P3[1] - cI * (P3[2])) + F2[5] * (P3[0] - P3[3])));
+  denom = COUP/((P3[0] * P3[0]) - (P3[1] * P3[1]) - (P3[2] * P3[2]) - (P3[3] *
+      P3[3]) - M3 * (M3 - cI * W3));
+  V3[2] = denom * (-cI) * (F2[4] * F1[2] + F2[5] * F1[3] - P3[0] * OM3 * TMP0); 
+  V3[3] = denom * (-cI) * (-F2[4] * F1[3] - F2[5] * F1[2] - P3[1] * OM3 *
+      TMP0);
+  V3[4] = denom * (-cI) * (-cI * (F2[5] * F1[2]) + cI * (F2[4] * F1[3]) - P3[2]
+      * OM3 * TMP0);
+  V3[5] = denom * (-cI) * (F2[5] * F1[3] - F2[4] * F1[2] - P3[3] * OM3 * TMP0); 
+}
+
+void FFV1P0_3(const CVec F1[], const CVec F2[], std::complex<double> COUP, double M3, double W3, CVec V3[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  RVec P3[4]; 
+  CVec denom; 
+  V3[0] = +F1[0] + F2[0]; 
+  V3[1] = +F1[1] + F2[1]; 
+  P3[0] = -V3[0].real(); 
+  P3[1] = -V3[1].real(); 
+  P3[2] = -V3[1].imag(); 
+  P3[3] = -V3[0].imag(); 
+  denom = COUP/((P3[0] * P3[0]) - (P3[1] * P3[1]) - (P3[2] * P3[2]) - (P3[3] *
+      P3[3]) - M3 * (M3 - cI * W3));
+  V3[2] = denom * (-cI) * (F2[4] * F1[2] + F2[5] * F1[3] + F2[2] * F1[4] +
+      F2[3] * F1[5]);
+  V3[3] = denom * (-cI) * (F2[3] * F1[4] + F2[2] * F1[5] - F2[5] * F1[2] -
+      F2[4] * F1[3]);
+  V3[4] = denom * (-cI) * (-cI * (F2[5] * F1[2] + F2[2] * F1[5]) + cI * (F2[4]
+      * F1[3] + F2[3] * F1[4]));
+  V3[5] = denom * (-cI) * (F2[5] * F1[3] + F2[2] * F1[4] - F2[4] * F1[2] -
+      F2[3] * F1[5]);
+}
+
+void FFV2_2(const CVec F1[], const CVec V3[], std::complex<double> COUP, double M2, double W2, CVec F2[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  RVec P2[4]; 
+  CVec denom; 
+  F2[0] = +F1[0] + V3[0]; 
+  F2[1] = +F1[1] + V3[1]; 
+  P2[0] = -F2[0].real(); 
+  P2[1] = -F2[1].real(); 
+  P2[2] = -F2[1].imag(); 
+  P2[3] = -F2[0].imag(); 
+  denom = COUP/((P2[0] * P2[0]) - (P2[1] * P2[1]) - (P2[2] * P2[2]) - (P2[3] *
+      P2[3]) - M2 * (M2 - cI * W2));
+  F2[2] = denom * cI * (F1[2] * (P2[0] * (V3[2] + V3[5]) + (P2[1] * (-1.) *
+      (V3[3] + cI * (V3[4])) + (P2[2] * (+cI * (V3[3]) - V3[4]) - P2[3] *
+      (V3[2] + V3[5])))) + F1[3] * (P2[0] * (V3[3] - cI * (V3[4])) + (P2[1] *
+      (V3[5] - V3[2]) + (P2[2] * (-cI * (V3[5]) + cI * (V3[2])) + P2[3] * (+cI
+      * (V3[4]) - V3[3])))));
+  F2[3] = denom * cI * (F1[2] * (P2[0] * (V3[3] + cI * (V3[4])) + (P2[1] *
+      (-1.) * (V3[2] + V3[5]) + (P2[2] * (-1.) * (+cI * (V3[2] + V3[5])) +
+      P2[3] * (V3[3] + cI * (V3[4]))))) + F1[3] * (P2[0] * (V3[2] - V3[5]) +
+      (P2[1] * (+cI * (V3[4]) - V3[3]) + (P2[2] * (-1.) * (V3[4] + cI *
+      (V3[3])) + P2[3] * (V3[2] - V3[5])))));
+  F2[4] = denom * - cI * M2 * (F1[2] * (-1.) * (V3[2] + V3[5]) + F1[3] * (+cI *
+      (V3[4]) - V3[3]));
+  F2[5] = denom * cI * M2 * (F1[2] * (V3[3] + cI * (V3[4])) + F1[3] * (V3[2] -
+      V3[5]));
+}
+
+void FFV2_1(const CVec F2[], const CVec V3[], std::complex<double> COUP, double M1, double W1, CVec F1[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  RVec P1[4]; 
+  CVec denom; 
+  F1[0] = +F2[0] + V3[0]; 
+  F1[1] = +F2[1] + V3[1]; 
+  P1[0] = -F1[0].real(); 
+  P1[1] = -F1[1].real(); 
+  P1[2] = -F1[1].imag(); 
+  P1[3] = -F1[0].imag(); 
+  denom = COUP/((P1[0] * P1[0]) - (P1[1] * P1[1]) - (P1[2] * P1[2]) - (P1[3] *
+      P1[3]) - M1 * (M1 - cI * W1));
+  F1[2] = denom * cI * M1 * (F2[4] * (V3[2] + V3[5]) + F2[5] * (V3[3] + cI *
+      (V3[4])));
+  F1[3] = denom * - cI * M1 * (F2[4] * (+cI * (V3[4]) - V3[3]) + F2[5] * (V3[5]
+      - V3[2]));
+  F1[4] = denom * (-cI) * (F2[4] * (P1[0] * (V3[2] + V3[5]) + (P1[1] * (+cI *
+      (V3[4]) - V3[3]) + (P1[2] * (-1.) * (V3[4] + cI * (V3[3])) - P1[3] *
+      (V3[2] + V3[5])))) + F2[5] * (P1[0] * (V3[3] + cI * (V3[4])) + (P1[1] *
+      (V3[5] - V3[2]) + (P1[2] * (-cI * (V3[2]) + cI * (V3[5])) - P1[3] *
+      (V3[3] + cI * (V3[4]))))));
+  F1[5] = denom * (-cI) * (F2[4] * (P1[0] * (V3[3] - cI * (V3[4])) + (P1[1] *
+      (-1.) * (V3[2] + V3[5]) + (P1[2] * (+cI * (V3[2] + V3[5])) + P1[3] *
+      (V3[3] - cI * (V3[4]))))) + F2[5] * (P1[0] * (V3[2] - V3[5]) + (P1[1] *
+      (-1.) * (V3[3] + cI * (V3[4])) + (P1[2] * (+cI * (V3[3]) - V3[4]) + P1[3]
+      * (V3[2] - V3[5])))));
+}
+
+void FFV1_2(const CVec F1[], const CVec V3[], std::complex<double> COUP, double M2, double W2, CVec F2[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  RVec P2[4]; 
+  CVec denom; 
+  F2[0] = +F1[0] + V3[0]; 
+  F2[1] = +F1[1] + V3[1]; 
+  P2[0] = -F2[0].real(); 
+  P2[1] = -F2[1].real(); 
+  P2[2] = -F2[1].imag(); 
+  P2[3] = -F2[0].imag(); 
+  denom = COUP/((P2[0] * P2[0]) - (P2[1] * P2[1]) - (P2[2] * P2[2]) - (P2[3] *
+      P2[3]) - M2 * (M2 - cI * W2));
+  F2[2] = denom * cI * (F1[2] * (P2[0] * (V3[2] + V3[5]) + (P2[1] * (-1.) *
+      (V3[3] + cI * (V3[4])) + (P2[2] * (+cI * (V3[3]) - V3[4]) - P2[3] *
+      (V3[2] + V3[5])))) + (F1[3] * (P2[0] * (V3[3] - cI * (V3[4])) + (P2[1] *
+      (V3[5] - V3[2]) + (P2[2] * (-cI * (V3[5]) + cI * (V3[2])) + P2[3] * (+cI
+      * (V3[4]) - V3[3])))) + M2 * (F1[4] * (V3[2] - V3[5]) + F1[5] * (+cI *
+      (V3[4]) - V3[3]))));
+  F2[3] = denom * (-cI) * (F1[2] * (P2[0] * (-1.) * (V3[3] + cI * (V3[4])) +
+      (P2[1] * (V3[2] + V3[5]) + (P2[2] * (+cI * (V3[2] + V3[5])) - P2[3] *
+      (V3[3] + cI * (V3[4]))))) + (F1[3] * (P2[0] * (V3[5] - V3[2]) + (P2[1] *
+      (V3[3] - cI * (V3[4])) + (P2[2] * (V3[4] + cI * (V3[3])) + P2[3] * (V3[5]
+      - V3[2])))) + M2 * (F1[4] * (V3[3] + cI * (V3[4])) - F1[5] * (V3[2] +
+      V3[5]))));
+  F2[4] = denom * (-cI) * (F1[4] * (P2[0] * (V3[5] - V3[2]) + (P2[1] * (V3[3] +
+      cI * (V3[4])) + (P2[2] * (V3[4] - cI * (V3[3])) + P2[3] * (V3[5] -
+      V3[2])))) + (F1[5] * (P2[0] * (V3[3] - cI * (V3[4])) + (P2[1] * (-1.) *
+      (V3[2] + V3[5]) + (P2[2] * (+cI * (V3[2] + V3[5])) + P2[3] * (V3[3] - cI
+      * (V3[4]))))) + M2 * (F1[2] * (-1.) * (V3[2] + V3[5]) + F1[3] * (+cI *
+      (V3[4]) - V3[3]))));
+  F2[5] = denom * cI * (F1[4] * (P2[0] * (-1.) * (V3[3] + cI * (V3[4])) +
+      (P2[1] * (V3[2] - V3[5]) + (P2[2] * (-cI * (V3[5]) + cI * (V3[2])) +
+      P2[3] * (V3[3] + cI * (V3[4]))))) + (F1[5] * (P2[0] * (V3[2] + V3[5]) +
+      (P2[1] * (+cI * (V3[4]) - V3[3]) + (P2[2] * (-1.) * (V3[4] + cI *
+      (V3[3])) - P2[3] * (V3[2] + V3[5])))) + M2 * (F1[2] * (V3[3] + cI *
+      (V3[4])) + F1[3] * (V3[2] - V3[5]))));
+}
+
+void FFV1_0(const CVec F1[], const CVec F2[], const CVec V3[], std::complex<double> COUP, CVec& vertex)
+{
+  static const std::complex<double> cI(0., 1.); 
+  CVec TMP1; 
+  TMP1 = (F1[2] * (F2[4] * (V3[2] + V3[5]) + F2[5] * (V3[3] + cI * (V3[4]))) +
+      (F1[3] * (F2[4] * (V3[3] - cI * (V3[4])) + F2[5] * (V3[2] - V3[5])) +
+      (F1[4] * (F2[2] * (V3[2] - V3[5]) - F2[3] * (V3[3] + cI * (V3[4]))) +
+      F1[5] * (F2[2] * (+cI * (V3[4]) - V3[3]) + F2[3] * (V3[2] + V3[5])))));
+  vertex = COUP * - cI * TMP1; 
+}
+
+void FFV1_1(const CVec F2[], const CVec V3[], std::complex<double> COUP, double M1, double W1, CVec F1[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  RVec P1[4]; 
+  CVec denom; 
+  F1[0] = +F2[0] + V3[0]; 
+  F1[1] = +F2[1] + V3[1]; 
+  P1[0] = -F1[0].real(); 
+  P1[1] = -F1[1].real(); 
+  P1[2] = -F1[1].imag(); 
+  P1[3] = -F1[0].imag(); 
+  denom = COUP/((P1[0] * P1[0]) - (P1[1] * P1[1]) - (P1[2] * P1[2]) - (P1[3] *
+      P1[3]) - M1 * (M1 - cI * W1));
+  F1[2] = denom * cI * (F2[2] * (P1[0] * (V3[5] - V3[2]) + (P1[1] * (V3[3] - cI
+      * (V3[4])) + (P1[2] * (V3[4] + cI * (V3[3])) + P1[3] * (V3[5] - V3[2]))))
+      + (F2[3] * (P1[0] * (V3[3] + cI * (V3[4])) + (P1[1] * (-1.) * (V3[2] +
+      V3[5]) + (P1[2] * (-1.) * (+cI * (V3[2] + V3[5])) + P1[3] * (V3[3] + cI *
+      (V3[4]))))) + M1 * (F2[4] * (V3[2] + V3[5]) + F2[5] * (V3[3] + cI *
+      (V3[4])))));
+  F1[3] = denom * (-cI) * (F2[2] * (P1[0] * (+cI * (V3[4]) - V3[3]) + (P1[1] *
+      (V3[2] - V3[5]) + (P1[2] * (-cI * (V3[2]) + cI * (V3[5])) + P1[3] *
+      (V3[3] - cI * (V3[4]))))) + (F2[3] * (P1[0] * (V3[2] + V3[5]) + (P1[1] *
+      (-1.) * (V3[3] + cI * (V3[4])) + (P1[2] * (+cI * (V3[3]) - V3[4]) - P1[3]
+      * (V3[2] + V3[5])))) + M1 * (F2[4] * (+cI * (V3[4]) - V3[3]) + F2[5] *
+      (V3[5] - V3[2]))));
+  F1[4] = denom * (-cI) * (F2[4] * (P1[0] * (V3[2] + V3[5]) + (P1[1] * (+cI *
+      (V3[4]) - V3[3]) + (P1[2] * (-1.) * (V3[4] + cI * (V3[3])) - P1[3] *
+      (V3[2] + V3[5])))) + (F2[5] * (P1[0] * (V3[3] + cI * (V3[4])) + (P1[1] *
+      (V3[5] - V3[2]) + (P1[2] * (-cI * (V3[2]) + cI * (V3[5])) - P1[3] *
+      (V3[3] + cI * (V3[4]))))) + M1 * (F2[2] * (V3[5] - V3[2]) + F2[3] *
+      (V3[3] + cI * (V3[4])))));
+  F1[5] = denom * cI * (F2[4] * (P1[0] * (+cI * (V3[4]) - V3[3]) + (P1[1] *
+      (V3[2] + V3[5]) + (P1[2] * (-1.) * (+cI * (V3[2] + V3[5])) + P1[3] * (+cI
+      * (V3[4]) - V3[3])))) + (F2[5] * (P1[0] * (V3[5] - V3[2]) + (P1[1] *
+      (V3[3] + cI * (V3[4])) + (P1[2] * (V3[4] - cI * (V3[3])) + P1[3] * (V3[5]
+      - V3[2])))) + M1 * (F2[2] * (+cI * (V3[4]) - V3[3]) + F2[3] * (V3[2] +
+      V3[5]))));
+}
+
+void VVV1P0_1(const CVec V2[], const CVec V3[], std::complex<double> COUP, double M1, double W1, CVec V1[])
+{
+  static const std::complex<double> cI(0., 1.); 
+  CVec TMP2; 
+  RVec P1[4]; 
+  RVec P2[4]; 
+  RVec P3[4]; 
+  CVec TMP6; 
+  CVec TMP5; 
+  CVec TMP4; 
+  CVec denom; 
+  CVec TMP3; 
+  P2[0] = V2[0].real(); 
+  P2[1] = V2[1].real(); 
+  P2[2] = V2[1].imag(); 
+  P2[3] = V2[0].imag(); 
+  P3[0] = V3[0].real(); 
+  P3[1] = V3[1].real(); 
+  P3[2] = V3[1].imag(); 
+  P3[3] = V3[0].imag(); 
+  V1[0] = +V2[0] + V3[0]; 
+  V1[1] = +V2[1] + V3[1]; 
+  P1[0] = -V1[0].real(); 
+  P1[1] = -V1[1].real(); 
+  P1[2] = -V1[1].imag(); 
+  P1[3] = -V1[0].imag(); 
+  TMP5 = (P3[0] * V2[2] - P3[1] * V2[3] - P3[2] * V2[4] - P3[3] * V2[5]); 
+  TMP4 = (P1[0] * V2[2] - P1[1] * V2[3] - P1[2] * V2[4] - P1[3] * V2[5]); 
+  TMP6 = (V3[2] * V2[2] - V3[3] * V2[3] - V3[4] * V2[4] - V3[5] * V2[5]); 
+  TMP3 = (V3[2] * P2[0] - V3[3] * P2[1] - V3[4] * P2[2] - V3[5] * P2[3]); 
+  TMP2 = (V3[2] * P1[0] - V3[3] * P1[1] - V3[4] * P1[2] - V3[5] * P1[3]); 
+  denom = COUP/((P1[0] * P1[0]) - (P1[1] * P1[1]) - (P1[2] * P1[2]) - (P1[3] *
+      P1[3]) - M1 * (M1 - cI * W1));
+  V1[2] = denom * (TMP6 * (-cI * (P2[0]) + cI * (P3[0])) + (V2[2] * (-cI *
+      (TMP2) + cI * (TMP3)) + V3[2] * (-cI * (TMP5) + cI * (TMP4))));
+  V1[3] = denom * (TMP6 * (-cI * (P2[1]) + cI * (P3[1])) + (V2[3] * (-cI *
+      (TMP2) + cI * (TMP3)) + V3[3] * (-cI * (TMP5) + cI * (TMP4))));
+  V1[4] = denom * (TMP6 * (-cI * (P2[2]) + cI * (P3[2])) + (V2[4] * (-cI *
+      (TMP2) + cI * (TMP3)) + V3[4] * (-cI * (TMP5) + cI * (TMP4))));
+  V1[5] = denom * (TMP6 * (-cI * (P2[3]) + cI * (P3[3])) + (V2[5] * (-cI *
+      (TMP2) + cI * (TMP3)) + V3[5] * (-cI * (TMP5) + cI * (TMP4))));
+}
+
+}
+}
@@ -0,0 +1,121 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <momemta/Module.h>
+#include <momemta/Pool.h>
+
+#include <Profiler.h>
+
+namespace momemta {
+
+/**
+ * \brief A sequence of modules executed for a batch of phase-space points, one module at a time
+ *
+ * Each module is executed for all the points of the batch (see Module::work_batch()) before the next one. The pool only
+ * holds the values of a single point: the outputs of the modules used by the following ones are saved for each point
+ * in BlockCopies, and restored before executing the modules using them.
+ *
+ * The plan does not own the modules.
+ */
+class BatchPlan {
+public:
+    /// A module of the plan, and the values it needs for each point
+    struct Step {
+        Module* module;
+        unsigned int hooks; ///< Hooks implemented by the module, see ModuleDef::hooks
+        bool uses_inputs; ///< If true, the module reads the inputs set by the callback given to execute()
+        std::vector<std::size_t> inputs; ///< Copies restored before executing the module for a point
+        std::vector<std::size_t> outputs; ///< Copies saved after executing the module for a point
+    };
+
+    void clear();
+
+    /**
+     * \brief Add the copies of a memory block
+     *
+     * \return The index of the copies, to be used in Step
+     */
+    std::size_t addCopies(BlockCopies copies);
+
+    /// Append a module to the plan
+    void add(const Step& step);
+
+    /// Copies restored by loadOutputs()
+    void setOutputs(const std::vector<std::size_t>& outputs);
+
+    /**
+     * \brief Record the execution of the modules of the plan in \p profiler
+     *
+     * All the modules of the plan must already be registered in \p profiler. The time spent executing a module for
+     * a batch is shared evenly between the points of the batch.
+     */
+    void setProfiler(std::shared_ptr<Profiler> profiler);
+
+    /**
+     * \brief Execute the modules for \p n points
+     *
+     * \param n Number of points of the batch
+     * \param set_inputs Called with the index of a point to set the inputs of the computation graph for this point
+     * \param statuses Filled with the status of each point. Only points with Module::Status::OK went through all the
+     *      modules.
+     *
+     * \return Module::Status::ABORT if a module aborted the integration for one of the points,
+     *      Module::Status::OK otherwise
+     */
+    Module::Status execute(std::size_t n, const std::function<void(std::size_t)>& set_inputs,
+                           Module::Status* statuses);
+
+    /// Restore the outputs (see setOutputs()) of point \p i of the last batch
+    void loadOutputs(std::size_t i);
+
+private:
+    /// The interface given to Module::work_batch(), for the step being executed
+    class StepBatch: public Module::Batch {
+    public:
+        StepBatch(BatchPlan& plan, const Step& step, std::size_t n,
+                  const std::function<void(std::size_t)>& set_inputs, Module::Status* statuses);
+
+        virtual std::size_t size() const override;
+        virtual Module::Status& status(std::size_t i) override;
+        virtual void load(std::size_t i) override;
+        virtual void store(std::size_t i) override;
+
+    private:
+        BatchPlan& m_plan;
+        const Step& m_step;
+        std::size_t m_size;
+        const std::function<void(std::size_t)>& m_set_inputs;
+        Module::Status* m_statuses;
+    };
+
+    std::vector<Step> m_steps;
+    std::vector<BlockCopies> m_copies;
+    std::vector<std::size_t> m_outputs;
+
+    std::shared_ptr<Profiler> m_profiler;
+    std::vector<std::size_t> m_profiler_indices;
+    std::vector<Module::Status> m_previous_statuses;
+};
+
+}
@@ -0,0 +1,158 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <momemta/Module.h>
+#include <momemta/ModuleDef.h>
+
+#include <Profiler.h>
+
+namespace momemta {
+
+/**
+ * \brief A flat sequence of modules to execute for each point or solution
+ *
+ * Modules are stored as plain pointers in contiguous arrays. The per-point and per-loop hooks are only called on the
+ * modules actually overriding them (see ModuleDef::hooks): most modules only implement Module::work(), and calling
+ * the empty hooks of the others would cost a virtual call each time.
+ *
+ * The plan does not own the modules.
+ *
+ * If a Profiler is attached to the plan, the calls to Module::work() done by work() are recorded while the profiler is
+ * enabled.
+ */
+class ExecutionPlan {
+public:
+    /**
+     * \brief Append a module to the plan
+     *
+     * \param module The module
+     * \param hooks The hooks implemented by the module. Use momemta::HOOK_ALL if unknown.
+     */
+    void add(Module* module, unsigned int hooks) {
+        m_modules.push_back(module);
+
+        if (hooks & HOOK_BEGIN_POINT)
+            m_begin_point.push_back(module);
+        if (hooks & HOOK_BEGIN_LOOP)
+            m_begin_loop.push_back(module);
+        if (hooks & HOOK_END_LOOP)
+            m_end_loop.push_back(module);
+        if (hooks & HOOK_END_POINT)
+            m_end_point.push_back(module);
+    }
+
+    void clear() {
+        m_modules.clear();
+        m_begin_point.clear();
+        m_begin_loop.clear();
+        m_end_loop.clear();
+        m_end_point.clear();
+
+        m_profiler.reset();
+        m_profiler_indices.clear();
+    }
+
+    /**
+     * \brief Record the execution of the modules of the plan in \p profiler
+     *
+     * All the modules of the plan must already be registered in \p profiler.
+     */
+    void setProfiler(std::shared_ptr<Profiler> profiler) {
+        m_profiler = profiler;
+
+        m_profiler_indices.clear();
+        if (m_profiler) {
+            for (auto module: m_modules)
+                m_profiler_indices.push_back(m_profiler->index(module));
+        }
+    }
+
+    /// All the modules of the plan, in execution order
+    const std::vector<Module*>& modules() const {
+        return m_modules;
+    }
+
+    /**
+     * \brief Call Module::work() for each module, until one of them does not return Module::Status::OK
+     *
+     * \return The status returned by the last module executed
+     */
+    Module::Status work() const {
+        if (m_profiler && m_profiler->enabled())
+            return profiledWork();
+
+        for (auto module: m_modules) {
+            auto status = module->work();
+            if (status != Module::Status::OK)
+                return status;
+        }
+
+        return Module::Status::OK;
+    }
+
+    void beginPoint() const {
+        for (auto module: m_begin_point)
+            module->beginPoint();
+    }
+
+    void beginLoop() const {
+        for (auto module: m_begin_loop)
+            module->beginLoop();
+    }
+
+    void endLoop() const {
+        for (auto module: m_end_loop)
+            module->endLoop();
+    }
+
+    void endPoint() const {
+        for (auto module: m_end_point)
+            module->endPoint();
+    }
+
+private:
+    Module::Status profiledWork() const {
+        for (std::size_t i = 0; i < m_modules.size(); i++) {
+            auto start = Profiler::clock::now();
+            auto status = m_modules[i]->work();
+            m_profiler->record(m_profiler_indices[i], status, Profiler::clock::now() - start);
+
+            if (status != Module::Status::OK)
+                return status;
+        }
+
+        return Module::Status::OK;
+    }
+
+    std::vector<Module*> m_modules;
+
+    std::vector<Module*> m_begin_point;
+    std::vector<Module*> m_begin_loop;
+    std::vector<Module*> m_end_loop;
+    std::vector<Module*> m_end_point;
+
+    std::shared_ptr<Profiler> m_profiler;
+    std::vector<std::size_t> m_profiler_indices;
+};
+
+}
@@ -0,0 +1,236 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <momemta/Types.h>
+#include <momemta/Value.h>
+
+/**
+ * \file
+ * \brief Lightweight 4-vectors for the internal computations of modules
+ *
+ * Modules exchange LorentzVector, but ROOT recomputes every derived quantity (mass, angles, ...) each time it is
+ * requested, and its layout gives the compiler little room for vectorization. The types below are only meant to be
+ * used inside modules: values are converted from and to LorentzVector at the boundaries.
+ */
+
+namespace momemta {
+
+/**
+ * \brief Plain 4-vector, stored as \f$(p_x, p_y, p_z, E)\f$ in an aligned array
+ *
+ * \note The alignment is only guaranteed on the stack: C++11 `new` ignores it.
+ */
+struct alignas(32) FourVector {
+    double v[4];
+
+    FourVector() = default;
+
+    FourVector(double px, double py, double pz, double E): v{px, py, pz, E} {}
+
+    explicit FourVector(const LorentzVector& p): v{p.Px(), p.Py(), p.Pz(), p.E()} {}
+
+    LorentzVector toLorentzVector() const {
+        return LorentzVector(v[0], v[1], v[2], v[3]);
+    }
+
+    double Px() const { return v[0]; }
+    double Py() const { return v[1]; }
+    double Pz() const { return v[2]; }
+    double E() const { return v[3]; }
+
+    double Pt2() const { return v[0] * v[0] + v[1] * v[1]; }
+    double P2() const { return Pt2() + v[2] * v[2]; }
+    double M2() const { return v[3] * v[3] - P2(); }
+
+    /// Minkowski product, with metric \f$(-, -, -, +)\f$
+    double Dot(const FourVector& other) const {
+        return v[3] * other.v[3] - v[0] * other.v[0] - v[1] * other.v[1] - v[2] * other.v[2];
+    }
+
+    FourVector& operator+=(const FourVector& other) {
+        for (std::size_t i = 0; i < 4; i++)
+            v[i] += other.v[i];
+        return *this;
+    }
+
+    FourVector& operator-=(const FourVector& other) {
+        for (std::size_t i = 0; i < 4; i++)
+            v[i] -= other.v[i];
+        return *this;
+    }
+
+    FourVector& operator*=(double factor) {
+        for (std::size_t i = 0; i < 4; i++)
+            v[i] *= factor;
+        return *this;
+    }
+};
+
+inline FourVector operator+(FourVector a, const FourVector& b) {
+    return a += b;
+}
+
+inline FourVector operator-(FourVector a, const FourVector& b) {
+    return a -= b;
+}
+
+inline FourVector operator*(FourVector a, double factor) {
+    return a *= factor;
+}
+
+/**
+ * \brief A set of 4-vectors, stored as a structure of arrays
+ *
+ * Each component is stored in its own contiguous array, so that loops computing the same quantity for all the
+ * vectors can be vectorized by the compiler.
+ */
+class FourVectors {
+public:
+    explicit FourVectors(std::size_t size = 0) {
+        resize(size);
+    }
+
+    void resize(std::size_t size) {
+        m_px.resize(size);
+        m_py.resize(size);
+        m_pz.resize(size);
+        m_E.resize(size);
+    }
+
+    std::size_t size() const {
+        return m_E.size();
+    }
+
+    void set(std::size_t index, const LorentzVector& p) {
+        m_px[index] = p.Px();
+        m_py[index] = p.Py();
+        m_pz[index] = p.Pz();
+        m_E[index] = p.E();
+    }
+
+    FourVector get(std::size_t index) const {
+        return FourVector(m_px[index], m_py[index], m_pz[index], m_E[index]);
+    }
+
+    const double* px() const { return m_px.data(); }
+    const double* py() const { return m_py.data(); }
+    const double* pz() const { return m_pz.data(); }
+    const double* E() const { return m_E.data(); }
+
+    /// Fill \p result with \f$p_T^2\f$ of each vector
+    void Pt2(double* result) const {
+        const std::size_t n = size();
+        const double* x = m_px.data();
+        const double* y = m_py.data();
+        for (std::size_t i = 0; i < n; i++)
+            result[i] = x[i] * x[i] + y[i] * y[i];
+    }
+
+    /// Fill \p result with \f$|\vec{p}|^2\f$ of each vector
+    void P2(double* result) const {
+        const std::size_t n = size();
+        const double* x = m_px.data();
+        const double* y = m_py.data();
+        const double* z = m_pz.data();
+        for (std::size_t i = 0; i < n; i++)
+            result[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+    }
+
+    /// Fill \p result with \f$m^2\f$ of each vector
+    void M2(double* result) const {
+        const std::size_t n = size();
+        const double* x = m_px.data();
+        const double* y = m_py.data();
+        const double* z = m_pz.data();
+        const double* e = m_E.data();
+        for (std::size_t i = 0; i < n; i++)
+            result[i] = e[i] * e[i] - (x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+    }
+
+private:
+    std::vector<double> m_px;
+    std::vector<double> m_py;
+    std::vector<double> m_pz;
+    std::vector<double> m_E;
+};
+
+/**
+ * \brief Derived quantities of a 4-vector
+ *
+ * Computed using the LorentzVector functions, so that the values are exactly the ones a module would get by calling
+ * them directly.
+ */
+struct Kinematics {
+    double E, P, Pt, M;
+    double Eta, Phi, Theta;
+    double cos_phi, sin_phi;
+    double cosh_eta, sinh_eta;
+
+    void compute(const LorentzVector& p) {
+        E = p.E();
+        P = p.P();
+        Pt = p.Pt();
+        M = p.M();
+        Eta = p.Eta();
+        Phi = p.Phi();
+        Theta = p.Theta();
+        cos_phi = std::cos(Phi);
+        sin_phi = std::sin(Phi);
+        cosh_eta = std::cosh(Eta);
+        sinh_eta = std::sinh(Eta);
+    }
+};
+
+/**
+ * \brief Derived quantities of an input 4-vector, only computed again when the input changes
+ *
+ * Transfer functions typically use the angles and mass of a reconstructed particle, which is constant during the
+ * integration of an event. Comparing the 4 components to their previous values is much cheaper than the `sqrt`,
+ * `atan2` and hyperbolic functions needed to get these quantities.
+ */
+class CachedKinematics {
+public:
+    CachedKinematics() = default;
+
+    explicit CachedKinematics(const Value<LorentzVector>& value): m_value(value) {}
+
+    const Kinematics& get() {
+        const LorentzVector& p = *m_value;
+        if (!m_valid || !(p == m_last)) {
+            m_kinematics.compute(p);
+            m_last = p;
+            m_valid = true;
+        }
+
+        return m_kinematics;
+    }
+
+private:
+    Value<LorentzVector> m_value;
+    LorentzVector m_last;
+    Kinematics m_kinematics;
+    bool m_valid = false;
+};
+
+}
@@ -4,20 +4,21 @@
 #include <momemta/Configuration.h>
 #include <momemta/Module.h>
 
+#include <BatchPlan.h>
 #include <ExecutionPath.h>
+#include <ExecutionPlan.h>
+#include <Profiler.h>
 
+#include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/config.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
-#ifdef DEBUG_TIMING
-#include <chrono>
-#endif
-
 namespace momemta {
 
 // Graph definitions
@@ -29,6 +30,8 @@ struct Vertex {
     std::string type; // Module type
     momemta::ModuleList::value_type def;
     Configuration::ModuleDecl decl;
+    std::vector<std::string> merged; ///< Names of the identical modules merged into this one
+    bool folded = false; ///< If true, the outputs of this module are constant and computed only once
 };
 
 /// An edge of the graph, symbolizing the connection between two modules (an InputTag)
@@ -42,6 +45,13 @@ typedef boost::adjacency_list<boost::listS, boost::listS, boost::bidirectionalS,
 typedef boost::graph_traits<Graph>::vertex_descriptor vertex_t;
 typedef boost::graph_traits<Graph>::edge_descriptor edge_t;
 
+/// When a module needs to be executed, deduced from what its inputs depend on
+enum class ModuleStage {
+    Constant, ///< Depends neither on the event nor on the phase-space point: executed only once, by configure()
+    Event, ///< Only depends on the event: executed once per integration, and when the event changes
+    Point ///< Depends on the phase-space point: executed for each phase-space point
+};
+
 /**
  * Abstraction of the computation graph
  *
@@ -61,25 +71,75 @@ public:
      * memory
      *
      * \param pool The memory pool used by the modules to allocate their memory
+     * \param outputs Values read once the computation graph is executed, restored for each point of a batch by
+     *      loadBatchOutputs()
      */
-    void initialize(PoolPtr pool);
+    void initialize(PoolPtr pool, const std::vector<InputTag>& outputs = {});
+
+    /**
+     * \brief Create a new computation graph with the same structure as this one
+     *
+     * The new graph shares the modules' declarations with this graph, but no module instance: it must be initialized
+     * with its own memory pool before use. This avoids the cost of building the graph again from the configuration.
+     *
+     * \return A new uninitialized computation graph
+     */
+    std::shared_ptr<ComputationGraph> clone() const;
 
     // Interface to module methods
-    /// Call Module::configure() for each module of the computation graph.
+    /**
+     * \brief Call Module::configure() for each module of the computation graph.
+     *
+     * Modules of the ModuleStage::Constant stage are then executed, once and for all: their outputs are folded into
+     * constant values of the memory pool, and they are skipped by all the other functions except finish().
+     */
     void configure();
     /// Call Module::beginIntegration() for each module of the computation graph.
     void beginIntegration();
-    /// Execute each module of the computation graph.
+    /**
+     * \brief Execute each module of the computation graph
+     *
+     * Modules of the ModuleStage::Event stage are only executed for the first point, and again after a call to
+     * beginIntegration() or invalidateEvent(). Modules of the ModuleStage::Constant stage are never executed here.
+     */
     Module::Status execute();
+    /**
+     * \brief Execute each module of the computation graph for a batch of phase-space points
+     *
+     * Same as execute(), except that each module of the ModuleStage::Point stage is executed for all the points of
+     * the batch before the next one (see Module::work_batch()). The values produced by these modules are copied for
+     * each point of the batch: the other ones do not depend on the phase-space point.
+     *
+     * \param n Number of points of the batch
+     * \param set_inputs Called with the index of a point to set the phase-space point (the `cuba` values) in the
+     *      memory pool
+     * \param statuses Filled with the status of each point
+     *
+     * \return Module::Status::ABORT if the integration must be aborted, Module::Status::OK otherwise
+     */
+    Module::Status executeBatch(std::size_t n, const std::function<void(std::size_t)>& set_inputs,
+                                Module::Status* statuses);
+    /// Restore the outputs given to initialize() for point \p i of the last batch executed by executeBatch()
+    void loadBatchOutputs(std::size_t i);
+    /// Notify that the event changed: per-event modules will be executed again by the next call to execute()
+    void invalidateEvent();
     /// Call Module::endIntegration() for each module of the computation graph.
     void endIntegration();
     /// Call Module::finish() for each module of the computation graph.
     void finish();
 
-#ifdef DEBUG_TIMING
-    /// \private
+    /**
+     * \brief Enable or disable the profiling of the modules
+     *
+     * While enabled, each call to Module::work() is recorded, including the calls done by the loopers.
+     */
+    void setProfiling(bool enabled);
+    /// \return The profiler recording the execution of the modules (see setProfiling())
+    const Profiler& getProfiler() const;
+    /// Reset the execution statistics of the modules
+    void resetProfile();
+    /// Log the time spent in each module since the profiling was enabled
     void logTimings() const;
-#endif
 
     /**
      * \brief Set the number of integration dimensions needed by the computation graph
@@ -91,13 +151,24 @@ public:
     size_t getNDimensions() const;
 
     /// \private ; only public for unit tests
-    void addDecl(const boost::uuids::uuid& path, const Configuration::ModuleDecl& decl);
+    void addDecl(const boost::uuids::uuid& path, const Configuration::ModuleDecl& decl,
+                 ModuleStage stage = ModuleStage::Point);
     /// \private ; only public for unit tests
     const std::vector<boost::uuids::uuid>& getPaths() const;
     /// \private ; only public for unit tests
     const std::vector<Configuration::ModuleDecl>& getDecls(const boost::uuids::uuid& path) const;
+    /// \private ; only public for unit tests
+    ModuleStage getStage(const std::string& module_name) const;
 
 private:
+    Module::Status runModules(const ExecutionPlan& plan);
+
+    /// Collect the declaration of a module, and of the modules of its path if it's a Looper, recursively
+    void collectDecls(const Configuration::ModuleDecl& decl,
+                      std::vector<const Configuration::ModuleDecl*>& decls) const;
+    /// Compile #batch_plan from the modules of #point_plan
+    void compileBatchPlan();
+
     std::vector<boost::uuids::uuid> sorted_execution_paths;
     std::unordered_map<
             boost::uuids::uuid,
@@ -105,13 +176,32 @@ private:
             boost::hash<boost::uuids::uuid>
     > module_decls;
 
+    std::unordered_map<std::string, ModuleStage> module_stages;
+
     std::vector<ModulePtr> modules;
+    /// Modules not folded into constants
+    std::vector<Module*> integration_modules;
+
+    // Modules of the default execution path, split by stage
+    ExecutionPlan constant_plan;
+    ExecutionPlan event_plan;
+    ExecutionPlan point_plan;
+
+    // Execution of the modules of the point stage by batches, compiled the first time it's needed
+    PoolPtr pool;
+    std::vector<InputTag> outputs;
+    std::vector<unsigned int> point_hooks;
+    BatchPlan batch_plan;
+    bool batch_plan_compiled = false;
+
+    bool event_modules_executed = false;
+    Module::Status constant_status = Module::Status::OK;
+    Module::Status event_status = Module::Status::OK;
 
     size_t n_dimensions; ///< Number of integration dimensions needed, after modules pruning
 
-#ifdef DEBUG_TIMING
-    std::unordered_map<Module *, std::chrono::high_resolution_clock::duration> module_timings;
-#endif
+    /// Shared with the execution paths of the loopers
+    std::shared_ptr<Profiler> profiler = std::make_shared<Profiler>();
 };
 
 /**
@@ -120,6 +210,23 @@ private:
  * Connections between modules are used as constrains for proper ordering of operations. If a module does not contribute
  * to the graph (it's output is not used and it's not a sticky module), it's ignored and removed from the final graph.
  *
+ * Modules present in a looper execution path but not depending, even indirectly, on the looper's outputs are moved
+ * out of the path, right before the looper: their result is the same for every solution, so they only need to be
+ * executed once. Stateful and sticky modules, as well as nested loopers, are never moved.
+ *
+ * Modules of the default execution path are also classified using the modules they depend on (see ModuleStage), so
+ * that the ones not depending on the phase-space point are not executed for each point. Modules depending on nothing
+ * at all are folded into constants.
+ *
+ * Identical modules (same type, same parameters and same inputs, in the same execution path) are merged into a
+ * single one, and the modules using their outputs are rewired to it. Sticky modules and loopers are never merged.
+ *
+ * Merged and folded modules are shown in the graph exported by exportGraph().
+ *
+ * Among all the orders allowed by the connections, filters (see ModuleDefBuilder::Filter()) and the modules they
+ * depend on are executed first, starting with the cheapest ones, so that the other modules are not executed for the
+ * points rejected by a filter.
+ *
  * In case it's not possible to build the computation graph (cyclic dependencies for example), an exception is thrown.
  *
  * \sa momemta::ComputationGraph
@@ -165,13 +272,22 @@ public:
     void exportGraph(const std::string& output) const;
 
 private:
+    void hoist_loop_invariants();
+    void merge_duplicate_modules();
+    void schedule_filters();
+    std::unordered_map<std::string, ModuleStage> classify_modules() const;
     void prune_graph();
     void sort_graph();
     void validate();
 
+    ExecutionPath& get_path(const boost::uuids::uuid& id);
+
     const momemta::ModuleList& available_modules;
     const Configuration& configuration;
 
+    /// Copy of the configuration's execution paths, updated when modules are moved out of a looper
+    std::vector<std::shared_ptr<ExecutionPath>> execution_paths;
+
     Graph g;
     std::unordered_map<std::string, vertex_t> vertices;
 
@@ -0,0 +1,77 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <momemta/Types.h>
+#include <momemta/Value.h>
+
+namespace momemta {
+
+/**
+ * \brief Detect changes of a set of 4-momenta from one phase-space point to the next
+ *
+ * Blocks use it to compute the coefficients depending only on the visible particles once, and then only solve the
+ * equations depending on the phase-space point. The visible particles are usually constant during the integration of
+ * an event, unless a transfer function is applied on them, in which case the coefficients are simply recomputed for
+ * each point.
+ *
+ * The comparison is exact, so that the cached coefficients are always identical to the ones that would be computed
+ * from the current momenta.
+ */
+class InputsWatcher {
+public:
+    void watch(const Value<LorentzVector>& value) {
+        m_values.push_back(value);
+        m_last.resize(m_values.size());
+        m_valid = false;
+    }
+
+    void watch(const std::vector<Value<LorentzVector>>& values) {
+        for (const auto& value: values)
+            watch(value);
+    }
+
+    /**
+     * \brief Check if any of the watched momenta changed since the previous call
+     *
+     * \return True on the first call, and whenever one of the momenta differs from its value at the previous call
+     */
+    bool changed() {
+        bool changed = !m_valid;
+        for (std::size_t i = 0; i < m_values.size(); i++) {
+            const LorentzVector& value = *m_values[i];
+            if (changed || !(value == m_last[i])) {
+                changed = true;
+                m_last[i] = value;
+            }
+        }
+
+        m_valid = true;
+        return changed;
+    }
+
+private:
+    std::vector<Value<LorentzVector>> m_values;
+    std::vector<LorentzVector> m_last;
+    bool m_valid = false;
+};
+
+}
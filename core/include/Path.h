@@ -22,13 +22,14 @@
 #include <string>
 #include <vector>
 
-class Module;
+#include <ExecutionPlan.h>
 
 
 /**
  * \brief An execution path
  *
- * A Path represents an ordered sequence of modules, accessible using the Path::modules() method.
+ * A Path represents an ordered sequence of modules, accessible using the Path::modules() method, or as a flat
+ * momemta::ExecutionPlan using Path::plan().
  *
  * \note A Path does not by itself execute any modules, this is left to the user of this class
  *
@@ -43,6 +44,16 @@ public:
      */
     Path(const std::vector<std::shared_ptr<Module>>& modules);
 
+    /**
+     * \brief Create a new instance of Path, knowing which hooks each module implements
+     *
+     * \param modules The sequence of modules
+     * \param hooks The hooks implemented by each module (see momemta::ModuleDef::hooks)
+     * \param profiler If not null, profiler recording the execution of the modules (see momemta::ExecutionPlan::work())
+     */
+    Path(const std::vector<std::shared_ptr<Module>>& modules, const std::vector<unsigned int>& hooks,
+         std::shared_ptr<momemta::Profiler> profiler = nullptr);
+
     /**
      * \brief Create a new instance of Path from an existing instance
      *
@@ -64,7 +75,10 @@ public:
      */
     const std::vector<std::shared_ptr<Module>>& modules() const;
 
+    /// The modules of this execution Path, as a flat plan
+    const momemta::ExecutionPlan& plan() const;
 
 private:
     std::vector<std::shared_ptr<Module>> modules_;
+    momemta::ExecutionPlan plan_;
 };
\ No newline at end of file
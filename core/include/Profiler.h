@@ -0,0 +1,110 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <momemta/Module.h>
+#include <momemta/Profile.h>
+
+namespace momemta {
+
+/**
+ * \brief Collect execution statistics of the modules of a computation graph
+ *
+ * Modules are registered once, when the graph is initialized, and then referred to by their index. Recording a call
+ * only increments counters: the duration of each call is stored in a histogram with 4 bins per power of two
+ * nanoseconds, from which the percentiles are estimated.
+ *
+ * A profiler is not thread-safe: each computation graph has its own.
+ */
+class Profiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// Number of bins of the histogram of call durations, covering up to about 18 minutes
+    static constexpr std::size_t N_BINS = 4 * 40;
+
+    /**
+     * \brief Register a module
+     *
+     * \return The index used to record the calls of the module
+     */
+    std::size_t add(const Module* module, const std::string& name, const std::string& type);
+
+    /// \return The index of a registered module
+    std::size_t index(const Module* module) const;
+
+    /// Forget all the modules and their statistics
+    void clear();
+
+    void setEnabled(bool enabled) {
+        m_enabled = enabled;
+    }
+
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    /// Record a call of the module at \p index
+    void record(std::size_t index, Module::Status status, clock::duration duration) {
+        auto& entry = m_entries[index];
+        entry.calls++;
+        entry.statuses[static_cast<std::size_t>(status)]++;
+        entry.total += duration;
+        entry.histogram[bin(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count())]++;
+    }
+
+    /// Reset the statistics of all the modules
+    void reset();
+
+    /// Add the statistics of \p other to the ones of the modules with the same name
+    void merge(const Profiler& other);
+
+    /// \return The statistics of each module, in the order in which they were registered
+    std::vector<ModuleProfile> profile() const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string type;
+        std::uint64_t calls = 0;
+        std::array<std::uint64_t, 3> statuses = {}; ///< Indexed by Module::Status
+        clock::duration total = clock::duration::zero();
+        std::array<std::uint64_t, N_BINS> histogram = {};
+    };
+
+    /// Bin of the histogram for a call of \p ns nanoseconds
+    static std::size_t bin(std::int64_t ns);
+
+    /// Estimate a quantile of the call durations of \p entry, in seconds
+    static double quantile(const Entry& entry, double q);
+
+    std::vector<Entry> m_entries;
+    std::unordered_map<const Module*, std::size_t> m_indices;
+    bool m_enabled = false;
+};
+
+}
@@ -0,0 +1,79 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace momemta {
+
+/**
+ * \brief A process-wide registry of read-only resources
+ *
+ * Heavy objects (PDF grids, histograms, ...) are identified by a key, and shared between all their users as long as at
+ * least one of them keeps a reference to the resource. Different instances of the same configuration (for example
+ * created using MoMEMta::clone()) thus share a single copy of these objects.
+ *
+ * \warning Shared resources are accessed concurrently when computing weights in parallel, and must not be modified.
+ * Only share objects whose const functions are safe to call from several threads at once.
+ *
+ * \tparam T Type of the resources
+ */
+template <typename T>
+class SharedResources {
+public:
+    using Factory = std::function<std::shared_ptr<T>()>;
+
+    /**
+     * \brief Retrieve a resource, creating it if needed
+     *
+     * \param key Unique identifier of the resource
+     * \param factory Function used to create the resource, only called if the resource does not exist yet
+     *
+     * \return The resource associated with \p key
+     */
+    static std::shared_ptr<const T> get(const std::string& key, const Factory& factory) {
+        std::lock_guard<std::mutex> lock(mutex());
+
+        auto& resource = resources()[key];
+        std::shared_ptr<const T> result = resource.lock();
+        if (! result) {
+            result = factory();
+            resource = result;
+        }
+
+        return result;
+    }
+
+private:
+    static std::mutex& mutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::unordered_map<std::string, std::weak_ptr<const T>>& resources() {
+        static std::unordered_map<std::string, std::weak_ptr<const T>> s_resources;
+        return s_resources;
+    }
+};
+
+}
@@ -0,0 +1,137 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <BatchPlan.h>
+
+#include <momemta/ModuleDef.h>
+
+namespace momemta {
+
+void BatchPlan::clear() {
+    m_steps.clear();
+    m_copies.clear();
+    m_outputs.clear();
+
+    m_profiler.reset();
+    m_profiler_indices.clear();
+}
+
+std::size_t BatchPlan::addCopies(BlockCopies copies) {
+    m_copies.push_back(std::move(copies));
+    return m_copies.size() - 1;
+}
+
+void BatchPlan::add(const Step& step) {
+    m_steps.push_back(step);
+}
+
+void BatchPlan::setOutputs(const std::vector<std::size_t>& outputs) {
+    m_outputs = outputs;
+}
+
+void BatchPlan::setProfiler(std::shared_ptr<Profiler> profiler) {
+    m_profiler = profiler;
+
+    m_profiler_indices.clear();
+    if (m_profiler) {
+        for (const auto& step: m_steps)
+            m_profiler_indices.push_back(m_profiler->index(step.module));
+    }
+}
+
+Module::Status BatchPlan::execute(std::size_t n, const std::function<void(std::size_t)>& set_inputs,
+                                  Module::Status* statuses) {
+    for (auto& copies: m_copies)
+        copies.reserve(n);
+
+    std::fill(statuses, statuses + n, Module::Status::OK);
+
+    const bool profiling = m_profiler && m_profiler->enabled();
+
+    for (std::size_t s = 0; s < m_steps.size(); s++) {
+        StepBatch batch(*this, m_steps[s], n, set_inputs, statuses);
+
+        if (!profiling) {
+            m_steps[s].module->work_batch(batch);
+        } else {
+            m_previous_statuses.assign(statuses, statuses + n);
+
+            auto start = Profiler::clock::now();
+            m_steps[s].module->work_batch(batch);
+            auto duration = Profiler::clock::now() - start;
+
+            std::size_t n_executed = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                if (m_previous_statuses[i] == Module::Status::OK)
+                    n_executed++;
+            }
+
+            for (std::size_t i = 0; i < n; i++) {
+                if (m_previous_statuses[i] == Module::Status::OK)
+                    m_profiler->record(m_profiler_indices[s], statuses[i], duration / n_executed);
+            }
+        }
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (statuses[i] == Module::Status::ABORT)
+                return Module::Status::ABORT;
+        }
+    }
+
+    return Module::Status::OK;
+}
+
+void BatchPlan::loadOutputs(std::size_t i) {
+    for (auto copies: m_outputs)
+        m_copies[copies].restore(i);
+}
+
+BatchPlan::StepBatch::StepBatch(BatchPlan& plan, const Step& step, std::size_t n,
+                                const std::function<void(std::size_t)>& set_inputs, Module::Status* statuses):
+        m_plan(plan), m_step(step), m_size(n), m_set_inputs(set_inputs), m_statuses(statuses) {
+    // Empty
+}
+
+std::size_t BatchPlan::StepBatch::size() const {
+    return m_size;
+}
+
+Module::Status& BatchPlan::StepBatch::status(std::size_t i) {
+    return m_statuses[i];
+}
+
+void BatchPlan::StepBatch::load(std::size_t i) {
+    if (m_step.uses_inputs)
+        m_set_inputs(i);
+
+    for (auto copies: m_step.inputs)
+        m_plan.m_copies[copies].restore(i);
+
+    if (m_step.hooks & HOOK_BEGIN_POINT)
+        m_step.module->beginPoint();
+}
+
+void BatchPlan::StepBatch::store(std::size_t i) {
+    if ((m_step.hooks & HOOK_END_POINT) && m_statuses[i] == Module::Status::OK)
+        m_step.module->endPoint();
+
+    for (auto copies: m_step.outputs)
+        m_plan.m_copies[copies].save(i);
+}
+
+}
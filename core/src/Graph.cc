@@ -24,11 +24,10 @@
 #include <boost/graph/graphviz.hpp>
 #include <boost/graph/topological_sort.hpp>
 
+#include <algorithm>
 #include <array>
-
-#ifdef DEBUG_TIMING
-using namespace std::chrono;
-#endif
+#include <limits>
+#include <set>
 
 using namespace boost::uuids;
 
@@ -126,17 +125,13 @@ bool isConnectedDirectlyTo(Graph& g, vertex_t from, vertex_t to) {
 }
 
 /**
- * Check if a module is present in a looper's executation path
- *
- * This method assumes that the name of the attribute for the looper's path is `path`.
+ * Check if a module is present in an executation path
  *
- * \param looper_decl The declaration of the looper, used to retrieve the execution path
+ * \param looper_path The execution path
  * \param module_name The name of the module to look for
  * \return True if the module is present in the path, false otherwise
  */
-bool checkInPath(const Configuration::ModuleDecl& looper_decl, const std::string& module_name) {
-
-    const auto& looper_path = looper_decl.parameters->get<ExecutionPath>("path");
+bool checkInPath(const ExecutionPath& looper_path, const std::string& module_name) {
 
     auto it = std::find_if(looper_path.elements.begin(), looper_path.elements.end(),
                            [&module_name](const std::string& m) {
@@ -146,6 +141,98 @@ bool checkInPath(const Configuration::ModuleDecl& looper_decl, const std::string
     return it != looper_path.elements.end();
 }
 
+/**
+ * Compare two parameter values
+ *
+ * \return True if both values have the same type and are equal. Values of an unsupported type are never equal.
+ */
+bool isSameParameter(const momemta::any& a, const momemta::any& b);
+
+/**
+ * Compare two sets of parameters, ignoring the name of the module
+ *
+ * \return True if both sets have the same parameters, with the same values
+ */
+bool isSameParameterSet(const ParameterSet& a, const ParameterSet& b) {
+    auto a_names = a.getNames();
+    auto b_names = b.getNames();
+
+    if (a_names.size() != b_names.size())
+        return false;
+
+    for (const auto& name: a_names) {
+        if (name == "@name")
+            continue;
+
+        if (!b.exists(name) || !isSameParameter(a.rawGet(name), b.rawGet(name)))
+            return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+bool isSameValue(const T& a, const T& b) {
+    return a == b;
+}
+
+// InputTag::operator== ignores the index
+bool isSameValue(const InputTag& a, const InputTag& b) {
+    return a.toString() == b.toString();
+}
+
+bool isSameValue(const std::vector<InputTag>& a, const std::vector<InputTag>& b) {
+    return (a.size() == b.size()) &&
+           std::equal(a.begin(), a.end(), b.begin(), [](const InputTag& x, const InputTag& y) {
+               return isSameValue(x, y);
+           });
+}
+
+template <typename T>
+bool isSameParameterAs(const momemta::any& a, const momemta::any& b, bool& result) {
+    if (a.type() != typeid(T))
+        return false;
+
+    result = (b.type() == typeid(T)) && isSameValue(momemta::any_cast<const T&>(a), momemta::any_cast<const T&>(b));
+    return true;
+}
+
+bool isSameParameter(const momemta::any& a, const momemta::any& b) {
+    bool result = false;
+
+    if (isSameParameterAs<int64_t>(a, b, result) ||
+        isSameParameterAs<double>(a, b, result) ||
+        isSameParameterAs<bool>(a, b, result) ||
+        isSameParameterAs<std::string>(a, b, result) ||
+        isSameParameterAs<InputTag>(a, b, result) ||
+        isSameParameterAs<std::vector<int64_t>>(a, b, result) ||
+        isSameParameterAs<std::vector<double>>(a, b, result) ||
+        isSameParameterAs<std::vector<bool>>(a, b, result) ||
+        isSameParameterAs<std::vector<std::string>>(a, b, result) ||
+        isSameParameterAs<std::vector<InputTag>>(a, b, result))
+        return result;
+
+    if (a.type() == typeid(ParameterSet) && b.type() == typeid(ParameterSet))
+        return isSameParameterSet(momemta::any_cast<const ParameterSet&>(a), momemta::any_cast<const ParameterSet&>(b));
+
+    if (a.type() == typeid(std::vector<ParameterSet>) && b.type() == typeid(std::vector<ParameterSet>)) {
+        const auto& a_sets = momemta::any_cast<const std::vector<ParameterSet>&>(a);
+        const auto& b_sets = momemta::any_cast<const std::vector<ParameterSet>&>(b);
+
+        if (a_sets.size() != b_sets.size())
+            return false;
+
+        for (std::size_t i = 0; i < a_sets.size(); i++) {
+            if (!isSameParameterSet(a_sets[i], b_sets[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
 momemta::ModuleList::value_type get_module_def(const std::string& module_type,
                                                const momemta::ModuleList& available_modules) {
 
@@ -159,7 +246,9 @@ momemta::ModuleList::value_type get_module_def(const std::string& module_type,
     return *it;
 }
 
-void ComputationGraph::addDecl(const uuid& path, const Configuration::ModuleDecl& decl) {
+void ComputationGraph::addDecl(const uuid& path, const Configuration::ModuleDecl& decl, ModuleStage stage) {
+
+    module_stages[decl.name] = stage;
 
     auto& storage = module_decls;
 
@@ -184,11 +273,18 @@ const std::vector<Configuration::ModuleDecl>& ComputationGraph::getDecls(const u
     return module_decls.at(path);
 }
 
-void ComputationGraph::initialize(PoolPtr pool) {
+ModuleStage ComputationGraph::getStage(const std::string& module_name) const {
+    return module_stages.at(module_name);
+}
+
+void ComputationGraph::initialize(PoolPtr pool, const std::vector<InputTag>& outputs) {
     const auto& execution_paths = sorted_execution_paths;
 
-    // Keep track of the instantiated modules in their own execution path
+    // Keep track of the instantiated modules in their own execution path, and of the hooks they implement
     std::map<uuid, std::vector<ModulePtr>> module_instances;
+    std::map<uuid, std::vector<unsigned int>> module_hooks;
+
+    profiler->clear();
 
     // The list of execution path is sorted in the order we must execute the modules (modules from the first path first,
     // then modules from the second path, etc.)
@@ -209,11 +305,14 @@ void ComputationGraph::initialize(PoolPtr pool) {
 
                 // Replace the `path` parameter with the list of modules
                 // Since paths are sorted and we iterate backwards, we are sure to find an existing path.
-                params->raw_set("path", Path(module_instances.at(config_path_id)));
+                params->raw_set("path", Path(module_instances.at(config_path_id), module_hooks.at(config_path_id),
+                                             profiler));
             }
 
             try {
                 module_instances[*it].push_back(ModuleFactory::get().create(module_decl_it->type, pool, *params));
+                module_hooks[*it].push_back(ModuleRegistry::get().find(module_decl_it->type).module_def.hooks);
+                profiler->add(module_instances[*it].back().get(), module_decl_it->name, module_decl_it->type);
             } catch (...) {
                 LOG(fatal) << "Exception while trying to create module " << module_decl_it->type
                            << "::" << module_decl_it->name
@@ -224,11 +323,164 @@ void ComputationGraph::initialize(PoolPtr pool) {
     }
 
     modules = module_instances[DEFAULT_EXECUTION_PATH];
+    const auto& hooks = module_hooks[DEFAULT_EXECUTION_PATH];
+
+    integration_modules.clear();
+    for (const auto& module: modules) {
+        if (module_stages.at(module->name()) != ModuleStage::Constant)
+            integration_modules.push_back(module.get());
+    }
+
+    // Compile the flat execution plans of the default execution path, one per stage
+    constant_plan.clear();
+    event_plan.clear();
+    point_plan.clear();
+    point_hooks.clear();
+    for (std::size_t i = 0; i < modules.size(); i++) {
+        switch (module_stages.at(modules[i]->name())) {
+            case ModuleStage::Constant:
+                constant_plan.add(modules[i].get(), hooks[i]);
+                break;
+            case ModuleStage::Event:
+                event_plan.add(modules[i].get(), hooks[i]);
+                break;
+            case ModuleStage::Point:
+                point_plan.add(modules[i].get(), hooks[i]);
+                point_hooks.push_back(hooks[i]);
+                break;
+        }
+    }
+
+    constant_plan.setProfiler(profiler);
+    event_plan.setProfiler(profiler);
+    point_plan.setProfiler(profiler);
+
+    this->pool = pool;
+    this->outputs = outputs;
+    batch_plan.clear();
+    batch_plan_compiled = false;
+
+    event_modules_executed = false;
+}
+
+void ComputationGraph::collectDecls(const Configuration::ModuleDecl& decl,
+                                    std::vector<const Configuration::ModuleDecl*>& decls) const {
+    decls.push_back(&decl);
+
+    if (decl.type == "Looper") {
+        for (const auto& path_decl: getDecls(decl.parameters->get<ExecutionPath>("path").id))
+            collectDecls(path_decl, decls);
+    }
+}
+
+void ComputationGraph::compileBatchPlan() {
+    // Modules are instantiated in the order of their declarations
+    const auto& decls = getDecls(DEFAULT_EXECUTION_PATH);
+
+    std::vector<const Configuration::ModuleDecl*> point_decls;
+    for (const auto& decl: decls) {
+        if (module_stages.at(decl.name) == ModuleStage::Point)
+            point_decls.push_back(&decl);
+    }
+
+    assert(point_decls.size() == point_plan.modules().size());
+
+    // Step executing each module, including the modules of the paths of the loopers
+    std::unordered_map<std::string, std::size_t> producers;
+    std::vector<std::vector<const Configuration::ModuleDecl*>> groups(point_decls.size());
+    for (std::size_t s = 0; s < point_decls.size(); s++) {
+        collectDecls(*point_decls[s], groups[s]);
+        for (auto decl: groups[s])
+            producers.emplace(decl->name, s);
+    }
+
+    // Only the values produced by a step and used by another one, or read after the execution, are copied
+    std::vector<BatchPlan::Step> steps(point_decls.size());
+    std::unordered_map<std::string, std::size_t> copies;
+    auto get_copies = [this, &copies, &producers, &steps](const InputTag& tag) -> std::size_t {
+        InputTag block(tag.module, tag.parameter);
+        auto it = copies.find(block.toString());
+        if (it != copies.end())
+            return it->second;
+
+        std::size_t index = batch_plan.addCopies(pool->copies(block));
+        steps[producers.at(tag.module)].outputs.push_back(index);
+        copies.emplace(block.toString(), index);
+
+        return index;
+    };
+
+    for (std::size_t s = 0; s < point_decls.size(); s++) {
+        auto& step = steps[s];
+        step.module = point_plan.modules()[s];
+        step.hooks = point_hooks[s];
+        step.uses_inputs = false;
+
+        for (auto decl: groups[s]) {
+            const auto& def = ModuleRegistry::get().find(decl->type).module_def;
+            for (const auto& input_def: def.inputs) {
+                momemta::gtl::optional<std::vector<InputTag>> inputTags =
+                        momemta::getInputTagsForInput(input_def, *decl->parameters);
+
+                if (! inputTags)
+                    continue;
+
+                for (const auto& tag: *inputTags) {
+                    if (tag.module == "cuba") {
+                        step.uses_inputs = true;
+                        continue;
+                    }
+
+                    auto producer = producers.find(tag.module);
+                    if (producer == producers.end() || producer->second == s)
+                        continue;
+
+                    std::size_t index = get_copies(tag);
+                    if (std::find(step.inputs.begin(), step.inputs.end(), index) == step.inputs.end())
+                        step.inputs.push_back(index);
+                }
+            }
+        }
+    }
+
+    std::vector<std::size_t> output_copies;
+    for (const auto& tag: outputs) {
+        if (producers.count(tag.module))
+            output_copies.push_back(get_copies(tag));
+    }
+
+    for (const auto& step: steps)
+        batch_plan.add(step);
+
+    batch_plan.setOutputs(output_copies);
+    batch_plan.setProfiler(profiler);
+
+    batch_plan_compiled = true;
+}
+
+std::shared_ptr<ComputationGraph> ComputationGraph::clone() const {
+    auto graph = std::make_shared<ComputationGraph>();
+
+    graph->sorted_execution_paths = sorted_execution_paths;
+    graph->module_decls = module_decls;
+    graph->module_stages = module_stages;
+    graph->n_dimensions = n_dimensions;
+
+    return graph;
 }
 
 void ComputationGraph::configure() {
     for (auto& module: modules)
         module->configure();
+
+    // Fold the constant modules: compute their outputs once and for all
+    for (auto module: constant_plan.modules())
+        module->beginIntegration();
+
+    constant_status = runModules(constant_plan);
+
+    for (auto module: constant_plan.modules())
+        module->endIntegration();
 }
 
 void ComputationGraph::finish() {
@@ -237,51 +489,94 @@ void ComputationGraph::finish() {
 }
 
 void ComputationGraph::beginIntegration() {
-    for (auto& module: modules)
+    for (auto module: integration_modules)
         module->beginIntegration();
+
+    // beginIntegration may have reset the modules' outputs
+    event_modules_executed = false;
+}
+
+void ComputationGraph::invalidateEvent() {
+    event_modules_executed = false;
 }
 
 void ComputationGraph::endIntegration() {
-    for (auto& module: modules)
+    for (auto module: integration_modules)
         module->endIntegration();
 }
 
+Module::Status ComputationGraph::runModules(const ExecutionPlan& plan) {
+    // Module::Status::NEXT stops the execution for the current integration step, Module::Status::ABORT the integration
+    return plan.work();
+}
+
 Module::Status ComputationGraph::execute() {
-    for (auto& module: modules)
-        module->beginPoint();
+    // Constant modules were executed by configure(). Constant and per-event modules are not stateful: they do not
+    // need beginPoint() and endPoint()
+    if (constant_status != Module::Status::OK)
+        return constant_status;
+
+    if (!event_modules_executed) {
+        event_status = runModules(event_plan);
+        event_modules_executed = true;
+    }
 
-    for (auto& module: modules) {
-#ifdef DEBUG_TIMING
-        auto start = high_resolution_clock::now();
-#endif
-        auto status = module->work();
-#ifdef DEBUG_TIMING
-        module_timings[module.get()] += high_resolution_clock::now() - start;
-#endif
+    if (event_status != Module::Status::OK)
+        return event_status;
 
-        if (status == Module::Status::NEXT) {
-            // Stop execution for the current integration step
-            return Module::Status::NEXT;
-        } else if (status == Module::Status::ABORT) {
-            // Abort integration
-            return Module::Status::ABORT;
-        }
-    }
+    point_plan.beginPoint();
 
-    for (auto& module: modules)
-        module->endPoint();
+    auto status = runModules(point_plan);
+    if (status != Module::Status::OK)
+        return status;
+
+    point_plan.endPoint();
 
     return Module::Status::OK;
 }
 
-#ifdef DEBUG_TIMING
+Module::Status ComputationGraph::executeBatch(std::size_t n, const std::function<void(std::size_t)>& set_inputs,
+                                             Module::Status* statuses) {
+    if (!batch_plan_compiled)
+        compileBatchPlan();
+
+    if (constant_status == Module::Status::OK && !event_modules_executed) {
+        event_status = runModules(event_plan);
+        event_modules_executed = true;
+    }
+
+    auto status = (constant_status != Module::Status::OK) ? constant_status : event_status;
+    if (status != Module::Status::OK) {
+        std::fill(statuses, statuses + n, status);
+        return (status == Module::Status::ABORT) ? status : Module::Status::OK;
+    }
+
+    return batch_plan.execute(n, set_inputs, statuses);
+}
+
+void ComputationGraph::loadBatchOutputs(std::size_t i) {
+    batch_plan.loadOutputs(i);
+}
+
+void ComputationGraph::setProfiling(bool enabled) {
+    profiler->setEnabled(enabled);
+}
+
+const Profiler& ComputationGraph::getProfiler() const {
+    return *profiler;
+}
+
+void ComputationGraph::resetProfile() {
+    profiler->reset();
+}
+
 void ComputationGraph::logTimings() const {
-    LOG(info) << "Time spent evaluating modules (more details for loopers below):";
-    for (auto it: module_timings) {
-        LOG(info) << "    " << it.first->name() << ": " << duration_cast<duration<double>>(it.second).count() << "s";
+    LOG(info) << "Time spent evaluating modules (loopers include the modules of their path):";
+    for (const auto& module: profiler->profile()) {
+        LOG(info) << "    " << module.name << ": " << module.total_time << "s (" << module.calls << " calls, "
+                  << module.next << " rejected)";
     }
 }
-#endif
 
 void ComputationGraph::setNDimensions(size_t n) {
     n_dimensions = n;
@@ -293,7 +588,23 @@ size_t ComputationGraph::getNDimensions() const {
 
 ComputationGraphBuilder::ComputationGraphBuilder(const momemta::ModuleList& available_modules,
                                                  const Configuration& configuration):
-        available_modules(available_modules), configuration(configuration) { }
+        available_modules(available_modules), configuration(configuration) {
+
+    // Modules may be moved from one path to another while building the graph: work on a copy
+    for (const auto& path: configuration.getPaths())
+        execution_paths.push_back(std::make_shared<ExecutionPath>(*path));
+}
+
+ExecutionPath& ComputationGraphBuilder::get_path(const uuid& id) {
+    auto it = std::find_if(execution_paths.begin(), execution_paths.end(),
+                           [&id](const std::shared_ptr<ExecutionPath>& path) {
+                               return path->id == id;
+                           });
+
+    assert(it != execution_paths.end());
+
+    return **it;
+}
 
 std::shared_ptr<ComputationGraph> ComputationGraphBuilder::build() {
 
@@ -374,6 +685,12 @@ std::shared_ptr<ComputationGraph> ComputationGraphBuilder::build() {
         }
     }
 
+    // Move the modules not depending on a looper out of its path
+    hoist_loop_invariants();
+
+    // Only keep one module out of a set of identical ones
+    merge_duplicate_modules();
+
     // We need to make sure that any dependencies of a module inside a looper
     // is ran before the looper itself.
     for (const auto& vertex: vertices) {
@@ -384,7 +701,7 @@ std::shared_ptr<ComputationGraph> ComputationGraphBuilder::build() {
         const auto& looper_decl = g[looper_vtx].decl;
 
         // Retrieve the looper path
-        const auto& looper_path = looper_decl.parameters->get<ExecutionPath>("path");
+        const auto& looper_path = get_path(looper_decl.parameters->get<ExecutionPath>("path").id);
 
         // Add virtual link between the looper and all module inside its execution path
         for (const auto& m: looper_path.elements) {
@@ -518,9 +835,17 @@ std::shared_ptr<ComputationGraph> ComputationGraphBuilder::build() {
         }
     }
 
-    // Finally, everything is setup. Create the final computation graph
-    const auto& execution_paths = configuration.getPaths();
+    // Find which modules need to be executed for each phase-space point
+    const auto stages = classify_modules();
+
+    for (auto vertex: sorted_vertices) {
+        if (stages.at(g[vertex].name) == ModuleStage::Constant) {
+            LOG(info) << "Module '" << g[vertex].name << "' does not depend on anything. Folding its outputs into constants.";
+            g[vertex].folded = true;
+        }
+    }
 
+    // Finally, everything is setup. Create the final computation graph
     std::shared_ptr<ComputationGraph> computationGraph(new ComputationGraph());
     computationGraph->setNDimensions(n_dimensions);
         
@@ -545,12 +870,287 @@ std::shared_ptr<ComputationGraph> ComputationGraphBuilder::build() {
         // The first declared path must always be the default one, otherwise we are in trouble
         assert(!computationGraph->getPaths().empty() || execution_path == DEFAULT_EXECUTION_PATH);
 
-        computationGraph->addDecl(execution_path, g[vertex].decl);
+        computationGraph->addDecl(execution_path, g[vertex].decl, stages.at(g[vertex].name));
     }
 
     return computationGraph;
 }
 
+void ComputationGraphBuilder::hoist_loop_invariants() {
+
+    auto find_looper = [this](const ExecutionPath& path) -> vertex_t {
+        for (const auto& vertex: vertices) {
+            const auto& v = g[vertex.second];
+            if (v.type == "Looper" && v.decl.parameters->get<ExecutionPath>("path").id == path.id)
+                return vertex.second;
+        }
+
+        return boost::graph_traits<Graph>::null_vertex();
+    };
+
+    // Execution path containing a module, or nullptr for the default path
+    auto find_parent_path = [this](const std::string& module_name) -> ExecutionPath* {
+        for (const auto& path: execution_paths) {
+            if (checkInPath(*path, module_name))
+                return path.get();
+        }
+
+        return nullptr;
+    };
+
+    // Moving a module out of a nested looper may allow to move it out of the enclosing looper as well
+    bool moved = true;
+    while (moved) {
+        moved = false;
+
+        for (const auto& path: execution_paths) {
+            vertex_t looper = find_looper(*path);
+            if (looper == boost::graph_traits<Graph>::null_vertex())
+                continue;
+
+            // All the modules executed by the looper: the ones of its path, and of the paths of nested loopers
+            std::set<std::string> nested;
+            std::vector<const ExecutionPath*> to_visit = {path.get()};
+            while (!to_visit.empty()) {
+                const ExecutionPath* p = to_visit.back();
+                to_visit.pop_back();
+
+                for (const auto& m: p->elements) {
+                    nested.insert(m);
+
+                    auto module_it = vertices.find(m);
+                    if (module_it != vertices.end() && g[module_it->second].type == "Looper")
+                        to_visit.push_back(&get_path(
+                                g[module_it->second].decl.parameters->get<ExecutionPath>("path").id));
+                }
+            }
+
+            // A module must stay in the path if it uses an output of the looper, of a module staying in the path,
+            // or of a module of a nested looper
+            auto must_stay = [&](vertex_t vertex, const std::set<std::string>& staying) -> bool {
+                const auto& v = g[vertex];
+                if (v.type == "Looper" || v.def.sticky || v.def.hooks != HOOK_NONE)
+                    return true;
+
+                in_edge_iterator_t i, i_end;
+                for (std::tie(i, i_end) = boost::in_edges(vertex, g); i != i_end; ++i) {
+                    auto source = boost::source(*i, g);
+                    if (source == looper)
+                        return true;
+
+                    const auto& source_name = g[source].name;
+                    if (nested.count(source_name) &&
+                            (staying.count(source_name) || !checkInPath(*path, source_name)))
+                        return true;
+                }
+
+                return false;
+            };
+
+            std::set<std::string> staying;
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (const auto& m: path->elements) {
+                    auto module_it = vertices.find(m);
+                    if (staying.count(m) || module_it == vertices.end())
+                        continue;
+
+                    if (must_stay(module_it->second, staying)) {
+                        staying.insert(m);
+                        changed = true;
+                    }
+                }
+            }
+
+            ExecutionPath* parent_path = find_parent_path(g[looper].name);
+
+            for (auto it = path->elements.begin(); it != path->elements.end();) {
+                if (staying.count(*it) || vertices.find(*it) == vertices.end()) {
+                    ++it;
+                    continue;
+                }
+
+                LOG(info) << "Module '" << *it << "' does not depend on Looper '" << g[looper].name
+                          << "' outputs. Moving it out of the Looper execution path.";
+
+                if (parent_path)
+                    parent_path->elements.push_back(*it);
+
+                it = path->elements.erase(it);
+                moved = true;
+            }
+        }
+    }
+}
+
+void ComputationGraphBuilder::merge_duplicate_modules() {
+
+    auto path_of = [this](const std::string& module_name) -> uuid {
+        for (const auto& path: execution_paths) {
+            if (checkInPath(*path, module_name))
+                return path->id;
+        }
+
+        return DEFAULT_EXECUTION_PATH;
+    };
+
+    // Integrands are read directly from the pool by MoMEMta: a module producing one cannot be replaced
+    auto produces_integrand = [this](vertex_t vertex) -> bool {
+        out_edge_iterator_t o, o_end;
+        for (std::tie(o, o_end) = boost::out_edges(vertex, g); o != o_end; ++o) {
+            if (g[boost::target(*o, g)].def.internal)
+                return true;
+        }
+
+        return false;
+    };
+
+    auto can_merge = [this](vertex_t vertex) -> bool {
+        const auto& v = g[vertex];
+        return !v.def.internal && !v.def.sticky && v.type != "Looper";
+    };
+
+    auto are_duplicates = [&](vertex_t a, vertex_t b) -> bool {
+        return g[a].type == g[b].type && can_merge(a) && can_merge(b) &&
+               path_of(g[a].name) == path_of(g[b].name) &&
+               isSameParameterSet(*g[a].decl.parameters, *g[b].decl.parameters);
+    };
+
+    // Merging two modules may make their consumers identical: repeat until nothing changes
+    bool merged = true;
+    while (merged) {
+        merged = false;
+
+        typename boost::graph_traits<Graph>::vertex_iterator a, b, vtx_end;
+        for (std::tie(a, vtx_end) = boost::vertices(g); a != vtx_end && !merged; ++a) {
+            for (b = std::next(a); b != vtx_end; ++b) {
+                if (!are_duplicates(*a, *b))
+                    continue;
+
+                // Keep the module declared first, unless the other one produces an integrand
+                vertex_t keep = (g[*a].id < g[*b].id) ? *a : *b;
+                vertex_t remove = (keep == *a) ? *b : *a;
+                if (produces_integrand(remove))
+                    std::swap(keep, remove);
+
+                if (produces_integrand(remove))
+                    continue;
+
+                const std::string keep_name = g[keep].name;
+                const std::string remove_name = g[remove].name;
+
+                LOG(info) << "Module '" << remove_name << "' is identical to module '" << keep_name
+                          << "'. Merging them.";
+
+                // Rewire the consumers of the removed module
+                std::vector<std::pair<vertex_t, Edge>> consumers;
+                out_edge_iterator_t o, o_end;
+                for (std::tie(o, o_end) = boost::out_edges(remove, g); o != o_end; ++o)
+                    consumers.emplace_back(boost::target(*o, g), g[*o]);
+
+                std::set<vertex_t> updated_consumers;
+                for (auto& consumer: consumers) {
+                    auto& consumer_vertex = g[consumer.first];
+
+                    if (updated_consumers.insert(consumer.first).second) {
+                        for (const auto& input: consumer_vertex.def.inputs) {
+                            momemta::gtl::optional<std::vector<InputTag>> inputTags =
+                                    momemta::getInputTagsForInput(input, *consumer_vertex.decl.parameters);
+
+                            if (! inputTags)
+                                continue;
+
+                            bool update_decl = false;
+                            for (auto& inputTag: *inputTags) {
+                                if (inputTag.module == remove_name) {
+                                    inputTag.module = keep_name;
+                                    inputTag.update();
+                                    update_decl = true;
+                                }
+                            }
+
+                            if (update_decl)
+                                momemta::setInputTagsForInput(input, *consumer_vertex.decl.parameters, *inputTags);
+                        }
+                    }
+
+                    Edge& edge = consumer.second;
+                    edge.tag.module = keep_name;
+                    edge.tag.update();
+
+                    edge_t e;
+                    bool inserted;
+                    std::tie(e, inserted) = boost::add_edge(keep, consumer.first, g);
+                    g[e] = edge;
+                }
+
+                for (auto& path: execution_paths) {
+                    auto& elements = path->elements;
+                    elements.erase(std::remove(elements.begin(), elements.end(), remove_name), elements.end());
+                }
+
+                auto& merged_names = g[keep].merged;
+                merged_names.push_back(remove_name);
+                merged_names.insert(merged_names.end(), g[remove].merged.begin(), g[remove].merged.end());
+
+                boost::clear_vertex(remove, g);
+                boost::remove_vertex(remove, g);
+                vertices.erase(remove_name);
+
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+std::unordered_map<std::string, ModuleStage> ComputationGraphBuilder::classify_modules() const {
+
+    std::unordered_map<std::string, ModuleStage> stages;
+
+    // Vertices are sorted: the stage of all the inputs of a module is known when reaching it
+    for (auto vertex: sorted_vertices) {
+        const auto& v = g[vertex];
+
+        auto in_looper_path = std::any_of(execution_paths.begin(), execution_paths.end(),
+                                          [&v](const std::shared_ptr<ExecutionPath>& path) {
+                                              return checkInPath(*path, v.name);
+                                          });
+
+        // Modules with side effects or a state must always be executed, as well as loopers and their paths
+        ModuleStage stage = ModuleStage::Constant;
+        if (v.type == "Looper" || v.def.sticky || v.def.hooks != HOOK_NONE || in_looper_path)
+            stage = ModuleStage::Point;
+
+        in_edge_iterator_t i, i_end;
+        for (std::tie(i, i_end) = boost::in_edges(vertex, g); i != i_end && stage != ModuleStage::Point; ++i) {
+            if (g[*i].virt)
+                continue;
+
+            const auto& source = g[boost::source(*i, g)];
+
+            ModuleStage source_stage;
+            if (source.def.internal)
+                // Phase-space points come from cuba, the other internal modules hold the event
+                source_stage = (source.name == "cuba") ? ModuleStage::Point : ModuleStage::Event;
+            else
+                source_stage = stages.at(source.name);
+
+            stage = std::max(stage, source_stage);
+        }
+
+        if (stage == ModuleStage::Event)
+            LOG(debug) << "Module '" << v.name << "' only depends on the event. It will be executed once per event.";
+        else if (stage == ModuleStage::Constant)
+            LOG(debug) << "Module '" << v.name << "' does not depend on the event. It will be executed once.";
+
+        stages.emplace(v.name, stage);
+    }
+
+    return stages;
+}
+
 void ComputationGraphBuilder::prune_graph() {
 
     // Find all vertices not connected to something and remove them
@@ -600,6 +1200,97 @@ void ComputationGraphBuilder::sort_graph() {
                                          [this](const vertex_t& vertex) -> bool {
                                              return g[vertex].def.internal;
                                          }), sorted_vertices.end());
+
+    schedule_filters();
+}
+
+void ComputationGraphBuilder::schedule_filters() {
+
+    // For each module needed by a filter, the cost of executing the cheapest of these filters, including all the
+    // modules it depends on. Modules not needed by any filter are executed last.
+    std::unordered_map<vertex_t, double> priorities;
+
+    for (auto filter: sorted_vertices) {
+        if (!g[filter].def.filter)
+            continue;
+
+        std::set<vertex_t> needed = {filter};
+        std::vector<vertex_t> to_visit = {filter};
+        while (!to_visit.empty()) {
+            auto vertex = to_visit.back();
+            to_visit.pop_back();
+
+            in_edge_iterator_t i, i_end;
+            for (std::tie(i, i_end) = boost::in_edges(vertex, g); i != i_end; ++i) {
+                auto source = boost::source(*i, g);
+                if (!g[source].def.internal && needed.insert(source).second)
+                    to_visit.push_back(source);
+            }
+        }
+
+        double cost = 0;
+        for (auto vertex: needed)
+            cost += g[vertex].def.cost;
+
+        for (auto vertex: needed) {
+            auto it = priorities.find(vertex);
+            if (it == priorities.end() || cost < it->second)
+                priorities[vertex] = cost;
+        }
+    }
+
+    if (priorities.empty())
+        return;
+
+    // Sort the graph again, always executing next the available module with the lowest priority. Ties are broken
+    // using the previous order, which is kept as is if there's no filter.
+    std::vector<vertex_t> previous_order(sorted_vertices.begin(), sorted_vertices.end());
+    std::unordered_map<vertex_t, size_t> positions;
+    std::unordered_map<vertex_t, size_t> n_dependencies;
+    for (size_t i = 0; i < previous_order.size(); i++) {
+        positions.emplace(previous_order[i], i);
+        n_dependencies.emplace(previous_order[i], 0);
+    }
+
+    for (auto vertex: sorted_vertices) {
+        in_edge_iterator_t i, i_end;
+        for (std::tie(i, i_end) = boost::in_edges(vertex, g); i != i_end; ++i) {
+            if (!g[boost::source(*i, g)].def.internal)
+                n_dependencies[vertex]++;
+        }
+    }
+
+    auto key = [&priorities, &positions](vertex_t vertex) -> std::pair<double, size_t> {
+        auto it = priorities.find(vertex);
+        double priority = (it == priorities.end()) ? std::numeric_limits<double>::infinity() : it->second;
+        return std::make_pair(priority, positions.at(vertex));
+    };
+
+    std::set<std::pair<double, size_t>> available;
+    for (auto vertex: sorted_vertices) {
+        if (n_dependencies.at(vertex) == 0)
+            available.insert(key(vertex));
+    }
+
+    sorted_vertices.clear();
+
+    while (!available.empty()) {
+        auto vertex = previous_order[available.begin()->second];
+        available.erase(available.begin());
+        sorted_vertices.push_back(vertex);
+
+        out_edge_iterator_t o, o_end;
+        for (std::tie(o, o_end) = boost::out_edges(vertex, g); o != o_end; ++o) {
+            auto target = boost::target(*o, g);
+            if (g[target].def.internal)
+                continue;
+
+            if (--n_dependencies.at(target) == 0)
+                available.insert(key(target));
+        }
+    }
+
+    assert(sorted_vertices.size() == previous_order.size());
 }
 
 void ComputationGraphBuilder::validate() {
@@ -669,7 +1360,8 @@ void ComputationGraphBuilder::validate() {
                 auto target = boost::target(*e, g);
 
                 // Check if target is inside the looper path
-                if (! checkInPath(decl, g[target].name)) {
+                const auto& path = get_path(decl.parameters->get<ExecutionPath>("path").id);
+                if (! checkInPath(path, g[target].name)) {
                     auto& loopers = modules_not_in_path[target];
                     auto it = std::find(loopers.begin(), loopers.end(), vertex);
                     if (it == loopers.end())
@@ -737,8 +1429,26 @@ public:
             extra = "fillcolor=\"" + path_colors.at(graph[v].decl.parameters->get<ExecutionPath>("path").id) + "\"";
         }
 
+        std::string label = graph[v].name;
+
+        if (graph[v].folded) {
+            shape = "box";
+            style = "dotted";
+            label += "\\n(constant)";
+        }
+
+        if (!graph[v].merged.empty()) {
+            label += "\\n(merged with ";
+            for (size_t i = 0; i < graph[v].merged.size(); i++) {
+                if (i != 0)
+                    label += ", ";
+                label += graph[v].merged[i];
+            }
+            label += ")";
+        }
+
         out << "[shape=\"" << shape << "\",color=\"" << color << "\",style=\"" << style
-            << "\",label=\"" << graph[v].name << "\"";
+            << "\",label=\"" << label << "\"";
 
         if (!extra.empty()) {
             out << "," << extra;
@@ -878,7 +1588,7 @@ void ComputationGraphBuilder::exportGraph(const std::string& output) const {
     if (! graph_exportable)
         return;
 
-    graphviz_export(g, configuration.getPaths(), output);
+    graphviz_export(g, execution_paths, output);
 }
 
 }
@@ -23,13 +23,28 @@
 
 using namespace std;
 
-bool solveQuadratic(const double a, const double b, const double c, std::vector<double>& roots,
-                    bool verbose) {
+namespace {
+
+// The solvers are written once for any container of roots, so that the versions appending to a
+// std::vector and the allocation-free versions give exactly the same results.
+
+template <typename Roots>
+bool solve2QuadsDegImpl(const double a11, const double a10, const double a01, const double a00,
+                        const double b11, const double b10, const double b01, const double b00,
+                        Roots& E1, Roots& E2, bool verbose);
+
+template <typename Roots>
+bool solve2LinearImpl(const double a10, const double a01, const double a00, const double b10,
+                      const double b01, const double b00, Roots& E1, Roots& E2, bool verbose);
+
+template <typename Roots>
+bool solveQuadraticImpl(const double a, const double b, const double c, Roots& roots, bool verbose) {
 
     if (!a) {
         if (!b) {
-            cout << "No solution to equation " << a << " x^2 + " << b << " x + " << c << endl
-                 << endl;
+            if (verbose)
+                cout << "No solution to equation " << a << " x^2 + " << b << " x + " << c << endl
+                     << endl;
             return false;
         }
         roots.push_back(-c / b);
@@ -66,11 +81,12 @@ bool solveQuadratic(const double a, const double b, const double c, std::vector<
     }
 }
 
-bool solveCubic(const double a, const double b, const double c, const double d,
-                std::vector<double>& roots, bool verbose) {
+template <typename Roots>
+bool solveCubicImpl(const double a, const double b, const double c, const double d, Roots& roots,
+                    bool verbose) {
 
     if (a == 0)
-        return solveQuadratic(b, c, d, roots, verbose);
+        return solveQuadraticImpl(b, c, d, roots, verbose);
 
     const double an = b / a;
     const double bn = c / a;
@@ -95,11 +111,8 @@ bool solveCubic(const double a, const double b, const double c, const double d,
         else
             B = Q / A;
 
-        const double x = A + B - an / 3.;
-
-        roots.push_back(x);
-        roots.push_back(x);
-        roots.push_back(x);
+        // Single real root, the two others are complex
+        roots.push_back(A + B - an / 3.);
     }
 
     if (verbose) {
@@ -114,11 +127,12 @@ bool solveCubic(const double a, const double b, const double c, const double d,
     return true;
 }
 
-bool solveQuartic(const double a, const double b, const double c, const double d, const double e,
-                  std::vector<double>& roots, bool verbose) {
+template <typename Roots>
+bool solveQuarticImpl(const double a, const double b, const double c, const double d, const double e,
+                      Roots& roots, bool verbose) {
 
     if (!a)
-        return solveCubic(b, c, d, e, roots, verbose);
+        return solveCubicImpl(b, c, d, e, roots, verbose);
 
     if (!b && !c && !d && !e) {
         roots.push_back(0.);
@@ -126,8 +140,8 @@ bool solveQuartic(const double a, const double b, const double c, const double d
         roots.push_back(0.);
         roots.push_back(0.);
     } else if (!b && !d) {
-        std::vector<double> sq_sol;
-        solveQuadratic(a, c, e, sq_sol, verbose);
+        QuadraticRoots sq_sol;
+        solveQuadraticImpl(a, c, e, sq_sol, verbose);
         for (unsigned short i = 0; i < sq_sol.size(); ++i) {
             if (sq_sol[i] < 0)
                 continue;
@@ -141,8 +155,8 @@ bool solveQuartic(const double a, const double b, const double c, const double d
         const double dn =
                 -3. * QU(0.25 * b / a) + e / a - 0.25 * b * d / SQ(a) + c * SQ(b / 4.) / CB(a);
 
-        std::vector<double> res;
-        solveCubic(1., 2. * bn, SQ(bn) - 4. * dn, -SQ(cn), res, verbose);
+        CubicRoots res;
+        solveCubicImpl(1., 2. * bn, SQ(bn) - 4. * dn, -SQ(cn), res, verbose);
         short pChoice = -1;
 
         for (unsigned short i = 0; i < res.size(); ++i) {
@@ -161,8 +175,8 @@ bool solveQuartic(const double a, const double b, const double c, const double d
         }
 
         const double p = sqrt(res[pChoice]);
-        solveQuadratic(p, SQ(p), 0.5 * (p * (bn + res[pChoice]) - cn), roots, verbose);
-        solveQuadratic(p, -SQ(p), 0.5 * (p * (bn + res[pChoice]) + cn), roots, verbose);
+        solveQuadraticImpl(p, SQ(p), 0.5 * (p * (bn + res[pChoice]) - cn), roots, verbose);
+        solveQuadraticImpl(p, -SQ(p), 0.5 * (p * (bn + res[pChoice]) + cn), roots, verbose);
 
         for (unsigned short i = 0; i < roots.size(); ++i)
             roots[i] -= an / 4.;
@@ -189,20 +203,21 @@ bool solveQuartic(const double a, const double b, const double c, const double d
     return nRoots > 0;
 }
 
-bool solve2Quads(const double a20, const double a02, const double a11, const double a10,
-                 const double a01, const double a00, const double b20, const double b02,
-                 const double b11, const double b10, const double b01, const double b00,
-                 std::vector<double>& E1, std::vector<double>& E2, bool verbose) {
+template <typename Roots>
+bool solve2QuadsImpl(const double a20, const double a02, const double a11, const double a10,
+                     const double a01, const double a00, const double b20, const double b02,
+                     const double b11, const double b10, const double b01, const double b00,
+                     Roots& E1, Roots& E2, bool verbose) {
 
     // The procedure used in this function relies on a20 != 0 or b20 != 0
     if (a20 == 0. && b20 == 0.) {
 
         if (a02 != 0. || b02 != 0.) {
             // Swapping E1 <-> E2 should suffice!
-            return solve2Quads(a02, a20, a11, a01, a10, a00, b02, b20, b11, b01, b10, b00, E2, E1,
-                               verbose);
+            return solve2QuadsImpl(a02, a20, a11, a01, a10, a00, b02, b20, b11, b01, b10, b00, E2, E1,
+                                   verbose);
         } else {
-            return solve2QuadsDeg(a11, a10, a01, a00, b11, b10, b01, b00, E1, E2, verbose);
+            return solve2QuadsDegImpl(a11, a10, a01, a00, b11, b10, b01, b00, E1, E2, verbose);
         }
     }
 
@@ -223,7 +238,7 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
                      2. * a00 * beta * gamma;
     const double e = a20 * SQ(omega) - a10 * omega * gamma + a00 * SQ(gamma);
 
-    solveQuartic(a, b, c, d, e, E2, verbose);
+    solveQuarticImpl(a, b, c, d, e, E2, verbose);
 
     for (unsigned short i = 0; i < E2.size(); ++i) {
 
@@ -238,14 +253,15 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
         } else if (alpha * SQ(e2) + delta * e2 + omega == 0.) {
             // Up to two solutions for e1
 
-            std::vector<double> e1;
+            QuadraticRoots e1;
 
-            if (!solveQuadratic(a20, a11 * e2 + a10, a02 * SQ(e2) + a01 * e2 + a00, e1, verbose)) {
+            if (!solveQuadraticImpl(a20, a11 * e2 + a10, a02 * SQ(e2) + a01 * e2 + a00, e1, verbose)) {
 
-                if (!solveQuadratic(b20, b11 * e2 + b10, b02 * SQ(e2) + b01 * e2 + b00, e1,
-                                    verbose)) {
-                    cout << "Error in solve2Quads: there should be at least one solution for e1!"
-                         << endl;
+                if (!solveQuadraticImpl(b20, b11 * e2 + b10, b02 * SQ(e2) + b01 * e2 + b00, e1,
+                                        verbose)) {
+                    if (verbose)
+                        cout << "Error in solve2Quads: there should be at least one solution for e1!"
+                             << endl;
                     E1.clear();
                     E2.clear();
                     return false;
@@ -260,9 +276,10 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
                 if (i < E2.size() - 1) {
 
                     if (e2 != E2[i + 1]) {
-                        cout << "Error in solve2Quads: if there are two solutions for e1, e2 "
-                                "should be degenerate!"
-                             << endl;
+                        if (verbose)
+                            cout << "Error in solve2Quads: if there are two solutions for e1, e2 "
+                                    "should be degenerate!"
+                                 << endl;
                         E1.clear();
                         E2.clear();
                         return false;
@@ -274,9 +291,10 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
                     continue;
 
                 } else {
-                    cout << "Error in solve2Quads: if there are two solutions for e1, e2 should be "
-                            "degenerate!"
-                         << endl;
+                    if (verbose)
+                        cout << "Error in solve2Quads: if there are two solutions for e1, e2 should be "
+                                "degenerate!"
+                             << endl;
                     E1.clear();
                     E2.clear();
                     return false;
@@ -293,17 +311,18 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
     return true;
 }
 
-bool solve2QuadsDeg(const double a11, const double a10, const double a01, const double a00,
-                    const double b11, const double b10, const double b01, const double b00,
-                    vector<double>& E1, vector<double>& E2, bool verbose) {
+template <typename Roots>
+bool solve2QuadsDegImpl(const double a11, const double a10, const double a01, const double a00,
+                        const double b11, const double b10, const double b01, const double b00,
+                        Roots& E1, Roots& E2, bool verbose) {
 
     if (a11 == 0. && b11 == 0.)
-        return solve2Linear(a10, a01, a00, b10, b01, b00, E1, E2, verbose);
+        return solve2LinearImpl(a10, a01, a00, b10, b01, b00, E1, E2, verbose);
 
-    bool result = solveQuadratic(a11 * (b11 * a10 - a11 * b10),
-                                 a01 * (b11 * a10 - a11 * b10) - a01 * (b11 * a01 - a11 * b01) +
-                                         a11 * (b11 * a00 - a11 * b00),
-                                 a01 * (b11 * a00 - a11 * b00), E1, verbose);
+    bool result = solveQuadraticImpl(a11 * (b11 * a10 - a11 * b10),
+                                     a01 * (b11 * a10 - a11 * b10) - a01 * (b11 * a01 - a11 * b01) +
+                                             a11 * (b11 * a00 - a11 * b00),
+                                     a01 * (b11 * a00 - a11 * b00), E1, verbose);
 
     if (!result) {
         if (verbose) {
@@ -354,9 +373,9 @@ bool solve2QuadsDeg(const double a11, const double a10, const double a01, const
     return E1.size();
 }
 
-bool solve2Linear(const double a10, const double a01, const double a00, const double b10,
-                  const double b01, const double b00, std::vector<double>& E1,
-                  std::vector<double>& E2, bool verbose) {
+template <typename Roots>
+bool solve2LinearImpl(const double a10, const double a01, const double a00, const double b10,
+                      const double b01, const double b00, Roots& E1, Roots& E2, bool verbose) {
 
     const double det = a10 * b01 - b10 * a01;
 
@@ -370,10 +389,12 @@ bool solve2Linear(const double a10, const double a01, const double a00, const do
             }
             return false;
         } else {
-            cout << "Error in solve2Linear: indeterminate system:" << endl;
-            cout << " " << a10 << "*E1 + " << a01 << "*E2 + " << a00 << " = 0" << endl;
-            cout << " " << b10 << "*E1 + " << b01 << "*E2 + " << b00 << " = 0" << endl;
-            cout << endl;
+            if (verbose) {
+                cout << "Error in solve2Linear: indeterminate system:" << endl;
+                cout << " " << a10 << "*E1 + " << a01 << "*E2 + " << a00 << " = 0" << endl;
+                cout << " " << b10 << "*E1 + " << b01 << "*E2 + " << b00 << " = 0" << endl;
+                cout << endl;
+            }
             return false;
         }
     }
@@ -397,6 +418,148 @@ bool solve2Linear(const double a10, const double a01, const double a00, const do
     return true;
 }
 
+}
+
+bool solveQuadratic(const double a, const double b, const double c, std::vector<double>& roots,
+                    bool verbose) {
+    return solveQuadraticImpl(a, b, c, roots, verbose);
+}
+
+bool solveQuadratic(const double a, const double b, const double c, QuadraticRoots& roots) {
+    roots.clear();
+    return solveQuadraticImpl(a, b, c, roots, false);
+}
+
+bool solveCubic(const double a, const double b, const double c, const double d,
+                std::vector<double>& roots, bool verbose) {
+    return solveCubicImpl(a, b, c, d, roots, verbose);
+}
+
+bool solveCubic(const double a, const double b, const double c, const double d, CubicRoots& roots) {
+    roots.clear();
+    return solveCubicImpl(a, b, c, d, roots, false);
+}
+
+bool solveQuartic(const double a, const double b, const double c, const double d, const double e,
+                  std::vector<double>& roots, bool verbose) {
+    return solveQuarticImpl(a, b, c, d, e, roots, verbose);
+}
+
+bool solveQuartic(const double a, const double b, const double c, const double d, const double e,
+                  QuarticRoots& roots) {
+    roots.clear();
+    return solveQuarticImpl(a, b, c, d, e, roots, false);
+}
+
+bool solve2Quads(const double a20, const double a02, const double a11, const double a10,
+                 const double a01, const double a00, const double b20, const double b02,
+                 const double b11, const double b10, const double b01, const double b00,
+                 std::vector<double>& E1, std::vector<double>& E2, bool verbose) {
+    return solve2QuadsImpl(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00, E1, E2,
+                           verbose);
+}
+
+bool solve2Quads(const double a20, const double a02, const double a11, const double a10,
+                 const double a01, const double a00, const double b20, const double b02,
+                 const double b11, const double b10, const double b01, const double b00,
+                 QuarticRoots& E1, QuarticRoots& E2) {
+    E1.clear();
+    E2.clear();
+    return solve2QuadsImpl(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00, E1, E2,
+                           false);
+}
+
+bool solve2QuadsDeg(const double a11, const double a10, const double a01, const double a00,
+                    const double b11, const double b10, const double b01, const double b00,
+                    vector<double>& E1, vector<double>& E2, bool verbose) {
+    return solve2QuadsDegImpl(a11, a10, a01, a00, b11, b10, b01, b00, E1, E2, verbose);
+}
+
+bool solve2QuadsDeg(const double a11, const double a10, const double a01, const double a00,
+                    const double b11, const double b10, const double b01, const double b00,
+                    QuadraticRoots& E1, QuadraticRoots& E2) {
+    E1.clear();
+    E2.clear();
+    return solve2QuadsDegImpl(a11, a10, a01, a00, b11, b10, b01, b00, E1, E2, false);
+}
+
+bool solve2Linear(const double a10, const double a01, const double a00, const double b10,
+                  const double b01, const double b00, std::vector<double>& E1,
+                  std::vector<double>& E2, bool verbose) {
+    return solve2LinearImpl(a10, a01, a00, b10, b01, b00, E1, E2, verbose);
+}
+
+bool solve2Linear(const double a10, const double a01, const double a00, const double b10,
+                  const double b01, const double b00, FixedRoots<1>& E1, FixedRoots<1>& E2) {
+    E1.clear();
+    E2.clear();
+    return solve2LinearImpl(a10, a01, a00, b10, b01, b00, E1, E2, false);
+}
+
+double polishQuarticRoot(const double a, const double b, const double c, const double d, const double e, double x,
+                         const unsigned int iterations) {
+
+    double f = (((a * x + b) * x + c) * x + d) * x + e;
+
+    for (unsigned int i = 0; i < iterations && f != 0.; i++) {
+        const double df = ((4. * a * x + 3. * b) * x + 2. * c) * x + d;
+        if (df == 0.)
+            break;
+
+        const double new_x = x - f / df;
+        const double new_f = (((a * new_x + b) * new_x + c) * new_x + d) * new_x + e;
+
+        if (!(std::abs(new_f) < std::abs(f)))
+            break;
+
+        x = new_x;
+        f = new_f;
+    }
+
+    return x;
+}
+
+void polish2QuadsSolution(const double a20, const double a02, const double a11, const double a10, const double a01,
+                          const double a00, const double b20, const double b02, const double b11, const double b10,
+                          const double b01, const double b00, double& E1, double& E2, const unsigned int iterations) {
+
+    auto residual = [&](const double x, const double y, double& F, double& G) {
+        F = a20 * SQ(x) + a02 * SQ(y) + a11 * x * y + a10 * x + a01 * y + a00;
+        G = b20 * SQ(x) + b02 * SQ(y) + b11 * x * y + b10 * x + b01 * y + b00;
+        return SQ(F) + SQ(G);
+    };
+
+    double F, G;
+    double norm = residual(E1, E2, F, G);
+
+    for (unsigned int i = 0; i < iterations && norm != 0.; i++) {
+        // Jacobian of the system
+        const double dF1 = 2. * a20 * E1 + a11 * E2 + a10;
+        const double dF2 = 2. * a02 * E2 + a11 * E1 + a01;
+        const double dG1 = 2. * b20 * E1 + b11 * E2 + b10;
+        const double dG2 = 2. * b02 * E2 + b11 * E1 + b01;
+
+        const double det = dF1 * dG2 - dF2 * dG1;
+        if (det == 0.)
+            break;
+
+        const double new_E1 = E1 - (F * dG2 - G * dF2) / det;
+        const double new_E2 = E2 - (G * dF1 - F * dG1) / det;
+
+        double new_F, new_G;
+        const double new_norm = residual(new_E1, new_E2, new_F, new_G);
+
+        if (!(new_norm < norm))
+            break;
+
+        E1 = new_E1;
+        E2 = new_E2;
+        F = new_F;
+        G = new_G;
+        norm = new_norm;
+    }
+}
+
 double BreitWigner(const double s, const double m, const double g) {
     double k = m * g;
     return k / (std::pow(s - m * m, 2.) + std::pow(m * g, 2.));
@@ -0,0 +1,226 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <momemta/MathBatch.h>
+
+#include <cmath>
+
+namespace momemta {
+namespace batch {
+
+namespace {
+
+// The functions below solve the generic case for a single lane. They follow the scalar
+// implementations in Math.cc operation by operation, but compute every branch and select the
+// right result at the end, so that they can be inlined in the lane loops.
+
+inline double signOf(const double x) {
+    return (x > 0) - (x < 0);
+}
+
+/// Roots of a*x^2 + b*x + c, for a != 0. Returns true if the roots are real.
+inline bool quadraticLane(const double a, const double b, const double c, double& r0, double& r1) {
+    const double rho = SQ(b) - 4. * a * c;
+    const double sqrt_rho = std::sqrt(rho);
+
+    const double x = -0.5 * (b + signOf(b) * sqrt_rho);
+    const bool b_null = (b == 0.);
+
+    r0 = b_null ? sqrt_rho / (2. * a) : x / a;
+    r1 = b_null ? -sqrt_rho / (2. * a) : c / x;
+
+    return rho >= 0.;
+}
+
+/// Roots of a*x^3 + b*x^2 + c*x + d, for a != 0. Returns the number of real roots.
+inline std::size_t cubicLane(const double a, const double b, const double c, const double d, double roots[3]) {
+    const double an = b / a;
+    const double bn = c / a;
+    const double cn = d / a;
+
+    const double Q = SQ(an) / 9. - bn / 3.;
+    const double R = CB(an) / 27. - an * bn / 6. + cn / 2.;
+
+    const bool three_roots = SQ(R) < CB(Q);
+
+    // Three distinct real roots
+    const double theta = std::acos(R / std::sqrt(CB(Q))) / 3.;
+    const double t0 = -2. * std::sqrt(Q) * std::cos(theta) - an / 3.;
+    const double t1 = -2. * std::sqrt(Q) * cosXpm2PI3(theta, 1.) - an / 3.;
+    const double t2 = -2. * std::sqrt(Q) * cosXpm2PI3(theta, -1.) - an / 3.;
+
+    // A single real root
+    const double A = -signOf(R) * std::cbrt(std::abs(R) + std::sqrt(SQ(R) - CB(Q)));
+    const double B = (A == 0.) ? 0. : Q / A;
+    const double x = A + B - an / 3.;
+
+    roots[0] = three_roots ? t0 : x;
+    roots[1] = three_roots ? t1 : x;
+    roots[2] = three_roots ? t2 : x;
+
+    return three_roots ? 3 : 1;
+}
+
+/// Roots of a*x^4 + b*x^3 + c*x^2 + d*x + e, for a != 0 and (b, d) != (0, 0). Returns the number of roots.
+inline std::size_t quarticLane(const double a, const double b, const double c, const double d, const double e,
+                               double roots[4]) {
+    const double an = b / a;
+    const double bn = c / a - (3. / 8.) * SQ(b / a);
+    const double cn = CB(0.5 * b / a) - 0.5 * b * c / SQ(a) + d / a;
+    const double dn = -3. * QU(0.25 * b / a) + e / a - 0.25 * b * d / SQ(a) + c * SQ(b / 4.) / CB(a);
+
+    // Factorize into two quadratics using the first positive root of the resolvent cubic
+    double res[3];
+    cubicLane(1., 2. * bn, SQ(bn) - 4. * dn, -SQ(cn), res);
+
+    const double r = (res[0] > 0) ? res[0] : ((res[1] > 0) ? res[1] : res[2]);
+    const bool found = r > 0;
+
+    const double p = std::sqrt(r);
+    double q[4];
+    const bool first = quadraticLane(p, SQ(p), 0.5 * (p * (bn + r) - cn), q[0], q[1]);
+    const bool second = quadraticLane(p, -SQ(p), 0.5 * (p * (bn + r) + cn), q[2], q[3]);
+
+    // Roots of the first quadratic come first, if any
+    roots[0] = (first ? q[0] : q[2]) - an / 4.;
+    roots[1] = (first ? q[1] : q[3]) - an / 4.;
+    roots[2] = q[2] - an / 4.;
+    roots[3] = q[3] - an / 4.;
+
+    return found ? 2 * first + 2 * second : 0;
+}
+
+}
+
+void solveQuadratic(const double a[NLANES], const double b[NLANES], const double c[NLANES],
+                    LaneRoots<2>& roots) {
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        const bool real = quadraticLane(a[l], b[l], c[l], roots.roots[0][l], roots.roots[1][l]);
+        roots.size[l] = real ? 2 : 0;
+    }
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        if (a[l] == 0.) {
+            QuadraticRoots lane_roots;
+            ::solveQuadratic(a[l], b[l], c[l], lane_roots);
+            roots.set(l, lane_roots);
+        }
+    }
+}
+
+void solveCubic(const double a[NLANES], const double b[NLANES], const double c[NLANES],
+                const double d[NLANES], LaneRoots<3>& roots) {
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        double lane_roots[3];
+        roots.size[l] = cubicLane(a[l], b[l], c[l], d[l], lane_roots);
+
+        for (std::size_t i = 0; i < 3; i++)
+            roots.roots[i][l] = lane_roots[i];
+    }
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        if (a[l] == 0.) {
+            CubicRoots lane_roots;
+            ::solveCubic(a[l], b[l], c[l], d[l], lane_roots);
+            roots.set(l, lane_roots);
+        }
+    }
+}
+
+void solveQuartic(const double a[NLANES], const double b[NLANES], const double c[NLANES],
+                  const double d[NLANES], const double e[NLANES], LaneRoots<4>& roots) {
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        double lane_roots[4];
+        roots.size[l] = quarticLane(a[l], b[l], c[l], d[l], e[l], lane_roots);
+
+        for (std::size_t i = 0; i < 4; i++)
+            roots.roots[i][l] = lane_roots[i];
+    }
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        if (a[l] == 0. || (b[l] == 0. && d[l] == 0.)) {
+            QuarticRoots lane_roots;
+            ::solveQuartic(a[l], b[l], c[l], d[l], e[l], lane_roots);
+            roots.set(l, lane_roots);
+        }
+    }
+}
+
+void solve2Quads(const double a20[NLANES], const double a02[NLANES], const double a11[NLANES],
+                 const double a10[NLANES], const double a01[NLANES], const double a00[NLANES],
+                 const double b20[NLANES], const double b02[NLANES], const double b11[NLANES],
+                 const double b10[NLANES], const double b01[NLANES], const double b00[NLANES],
+                 LaneRoots<4>& E1, LaneRoots<4>& E2) {
+
+    alignas(32) double alpha[NLANES], beta[NLANES], gamma[NLANES], delta[NLANES], omega[NLANES];
+    alignas(32) double a[NLANES], b[NLANES], c[NLANES], d[NLANES], e[NLANES];
+
+    // Eliminate the E1^2 term, and insert E1 back to get a quartic in E2
+    for (std::size_t l = 0; l < NLANES; l++) {
+        alpha[l] = b20[l] * a02[l] - a20[l] * b02[l];
+        beta[l] = b20[l] * a11[l] - a20[l] * b11[l];
+        gamma[l] = b20[l] * a10[l] - a20[l] * b10[l];
+        delta[l] = b20[l] * a01[l] - a20[l] * b01[l];
+        omega[l] = b20[l] * a00[l] - a20[l] * b00[l];
+
+        a[l] = a20[l] * SQ(alpha[l]) + a02[l] * SQ(beta[l]) - a11[l] * alpha[l] * beta[l];
+        b[l] = 2. * a20[l] * alpha[l] * delta[l] - a11[l] * (alpha[l] * gamma[l] + delta[l] * beta[l]) -
+               a10[l] * alpha[l] * beta[l] + 2. * a02[l] * beta[l] * gamma[l] + a01[l] * SQ(beta[l]);
+        c[l] = a20[l] * SQ(delta[l]) + 2. * a20[l] * alpha[l] * omega[l] -
+               a11[l] * (delta[l] * gamma[l] + omega[l] * beta[l]) -
+               a10[l] * (alpha[l] * gamma[l] + delta[l] * beta[l]) + a02[l] * SQ(gamma[l]) +
+               2. * a01[l] * beta[l] * gamma[l] + a00[l] * SQ(beta[l]);
+        d[l] = 2. * a20[l] * delta[l] * omega[l] - a11[l] * omega[l] * gamma[l] -
+               a10[l] * (delta[l] * gamma[l] + omega[l] * beta[l]) + a01[l] * SQ(gamma[l]) +
+               2. * a00[l] * beta[l] * gamma[l];
+        e[l] = a20[l] * SQ(omega[l]) - a10[l] * omega[l] * gamma[l] + a00[l] * SQ(gamma[l]);
+    }
+
+    solveQuartic(a, b, c, d, e, E2);
+
+    bool degenerate[NLANES];
+    for (std::size_t l = 0; l < NLANES; l++) {
+        degenerate[l] = (a20[l] == 0. && b20[l] == 0.);
+
+        for (std::size_t i = 0; i < 4; i++) {
+            const double e2 = E2.roots[i][l];
+            const double denom = beta[l] * e2 + gamma[l];
+
+            E1.roots[i][l] = -(alpha[l] * SQ(e2) + delta[l] * e2 + omega[l]) / denom;
+            degenerate[l] |= (i < E2.size[l] && denom == 0.);
+        }
+
+        E1.size[l] = E2.size[l];
+    }
+
+    for (std::size_t l = 0; l < NLANES; l++) {
+        if (degenerate[l]) {
+            QuarticRoots lane_E1, lane_E2;
+            ::solve2Quads(a20[l], a02[l], a11[l], a10[l], a01[l], a00[l], b20[l], b02[l], b11[l], b10[l],
+                          b01[l], b00[l], lane_E1, lane_E2);
+            E1.set(l, lane_E1);
+            E2.set(l, lane_E2);
+        }
+    }
+}
+
+}
+}
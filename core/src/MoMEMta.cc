@@ -19,9 +19,12 @@
 
 #include <momemta/MoMEMta.h>
 
+#include <atomic>
 #include <cstring>
 #include <cmath>
 #include <cstdint>
+#include <exception>
+#include <thread>
 
 #include <cuba.h>
 
@@ -84,6 +87,7 @@ void validateModules(const std::vector<Configuration::ModuleDecl>& module_decls,
 
 MoMEMta::MoMEMta(const Configuration& configuration_) {
 
+    m_configuration = std::make_shared<const Configuration>(configuration_);
     Configuration configuration = configuration_;
 
     // List of all available type of modules with their definition
@@ -117,20 +121,41 @@ MoMEMta::MoMEMta(const Configuration& configuration_) {
     if (! export_graph_as.empty())
         builder.exportGraph(export_graph_as);
 
+    initialize();
+}
+
+MoMEMta::MoMEMta(const MoMEMta& other):
+        m_configuration(other.m_configuration),
+        m_computation_graph(other.m_computation_graph->clone()) {
+    initialize();
+
+    setProfiling(other.m_profiling);
+}
+
+std::unique_ptr<MoMEMta> MoMEMta::clone() const {
+    return std::unique_ptr<MoMEMta>(new MoMEMta(*this));
+}
+
+void MoMEMta::initialize() {
+
+    const Configuration& configuration = *m_configuration;
+
     // Initialize shared memory pool for modules
     initPool(configuration);
 
     // And initialize the computation graph
-    m_computation_graph->initialize(m_pool);
+    m_computation_graph->initialize(m_pool, configuration.getIntegrands());
 
-    for (const auto& component: integrands) {
+    for (const auto& component: configuration.getIntegrands()) {
         m_integrands.push_back(m_pool->get<double>(component));
         LOG(debug) << "Configuration declared integrand component using: " << component.toString();
     }
     m_n_components = m_integrands.size();
 
+    m_set_batch_point = [this](std::size_t i) { setBatchPoint(i); };
+
     m_n_dimensions = m_computation_graph->getNDimensions();
-    LOG(info) << "Number of expected inputs: " << m_inputs_p4.size();
+    LOG(info) << "Number of expected inputs: " << m_inputs.size();
     LOG(info) << "Number of dimensions for integration: " << m_n_dimensions;
 
     // Resize pool ps-points vector
@@ -145,53 +170,229 @@ MoMEMta::MoMEMta(const Configuration& configuration_) {
 
     // Register logging function
     cubalogging(MoMEMta::cuba_logging);
+
+#ifdef DEBUG_TIMING
+    setProfiling(true);
+#endif
 }
 
 MoMEMta::~MoMEMta() {
     m_computation_graph->finish();
 }
 
+void MoMEMta::setProfiling(bool enabled) {
+    m_profiling = enabled;
+    m_computation_graph->setProfiling(enabled);
+
+    for (auto& worker: m_workers)
+        worker->setProfiling(enabled);
+}
+
+std::vector<momemta::ModuleProfile> MoMEMta::getProfile() const {
+    if (m_workers.empty())
+        return m_computation_graph->getProfiler().profile();
+
+    momemta::Profiler profiler = m_computation_graph->getProfiler();
+    for (const auto& worker: m_workers)
+        profiler.merge(worker->m_computation_graph->getProfiler());
+
+    return profiler.profile();
+}
+
+void MoMEMta::resetProfile() {
+    m_computation_graph->resetProfile();
+
+    for (auto& worker: m_workers)
+        worker->resetProfile();
+}
+
 const Pool& MoMEMta::getPool() const {
     return *m_pool;
 }
         
 
 void MoMEMta::setEvent(const std::vector<momemta::Particle>& particles, const LorentzVector& met) {
-    if (particles.size() != m_inputs_p4.size()) {
-        auto exception = invalid_inputs("Some inputs are missing. " + std::to_string(m_inputs_p4.size()) + " expected, "
+    if (particles.size() != m_inputs.size()) {
+        auto exception = invalid_inputs("Some inputs are missing. " + std::to_string(m_inputs.size()) + " expected, "
                                      + std::to_string(particles.size()) + " provided.");
         LOG(fatal) << exception.what();
         throw exception;
     }
 
-    std::vector<std::string> consumed_inputs;
+    std::vector<bool> consumed_inputs(m_inputs.size(), false);
     for (const auto& p: particles) {
         checkIfPhysical(p.p4);
 
-        if (m_inputs_p4.count(p.name) == 0) {
+        auto it = m_inputs_index.find(p.name);
+        if (it == m_inputs_index.end()) {
             auto exception = invalid_inputs(p.name + " is not a declared input");
             LOG(fatal) << exception.what();
             throw exception;
         }
 
-        if (std::find(consumed_inputs.begin(), consumed_inputs.end(), p.name) != consumed_inputs.end()) {
+        if (consumed_inputs[it->second]) {
             auto exception = invalid_inputs("Duplicated input " + p.name);
             LOG(fatal) << exception.what();
             throw exception;
         }
 
-        *m_inputs_p4[p.name] = p.p4;
-        *m_inputs_type[p.name] = p.type;
+        const InputSlot& input = m_inputs[it->second];
+        *input.p4 = p.p4;
+        *input.type = p.type;
+
+        consumed_inputs[it->second] = true;
+    }
+
+    *m_met = met;
+
+    m_computation_graph->invalidateEvent();
+}
+
+void MoMEMta::bindInputs(const std::vector<std::string>& names) {
+    if (names.size() != m_inputs.size()) {
+        auto exception = invalid_inputs("Some inputs are missing. " + std::to_string(m_inputs.size()) + " expected, "
+                                     + std::to_string(names.size()) + " provided.");
+        LOG(fatal) << exception.what();
+        throw exception;
+    }
+
+    std::vector<bool> bound_inputs(m_inputs.size(), false);
+    std::vector<InputSlot> inputs;
+    for (const auto& name: names) {
+        auto it = m_inputs_index.find(name);
+        if (it == m_inputs_index.end()) {
+            auto exception = invalid_inputs(name + " is not a declared input");
+            LOG(fatal) << exception.what();
+            throw exception;
+        }
+
+        if (bound_inputs[it->second]) {
+            auto exception = invalid_inputs("Duplicated input " + name);
+            LOG(fatal) << exception.what();
+            throw exception;
+        }
+
+        inputs.push_back(m_inputs[it->second]);
+        bound_inputs[it->second] = true;
+    }
+
+    m_bound_inputs = std::move(inputs);
+}
+
+void MoMEMta::setEvent(const LorentzVector* p4s, const int64_t* types, const LorentzVector& met) {
+    if (m_bound_inputs.size() != m_inputs.size()) {
+        auto exception = invalid_inputs("Inputs are not bound. Call bindInputs() first.");
+        LOG(fatal) << exception.what();
+        throw exception;
+    }
 
-        consumed_inputs.push_back(p.name);
+    for (std::size_t i = 0; i < m_bound_inputs.size(); i++) {
+        checkIfPhysical(p4s[i]);
+
+        *m_bound_inputs[i].p4 = p4s[i];
+        *m_bound_inputs[i].type = types ? types[i] : 0;
     }
 
     *m_met = met;
+
+    m_computation_graph->invalidateEvent();
 }
 
 std::vector<std::pair<double, double>> MoMEMta::computeWeights(const std::vector<momemta::Particle>& particles, const LorentzVector& met) {
     setEvent(particles, met);
 
+    int64_t ncores = m_cuba_configuration.get<int64_t>("ncores", 0);
+    int64_t pcores = m_cuba_configuration.get<int64_t>("pcores", 1000000);
+    cubacores(ncores, pcores);
+
+    return integrate();
+}
+
+std::vector<std::vector<std::pair<double, double>>> MoMEMta::computeWeightsBatch(
+        const std::vector<momemta::Event>& events, std::size_t n_threads) {
+
+    if (n_threads == 0)
+        n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    n_threads = std::max<std::size_t>(std::min(n_threads, events.size()), 1);
+
+    // Cuba keeps the grids stored by number in global variables, and every thread would use the same state file
+    if (n_threads > 1 && (m_cuba_configuration.get<int64_t>("grid_number", 0) != 0 ||
+                          !m_cuba_configuration.get<std::string>("grid_file", "").empty())) {
+        auto exception = cuba_configuration_error("The 'grid_number' and 'grid_file' options cannot be used when "
+                                                          "computing weights using several threads");
+        LOG(fatal) << exception.what();
+        throw exception;
+    }
+
+    // Cuba forks are global to the process, and cannot be mixed with threads
+    cubacores(0, 0);
+
+    // Replicas are created from this thread: creating modules is not thread-safe
+    while (m_workers.size() + 1 < n_threads)
+        m_workers.emplace_back(clone());
+
+    LOG(debug) << "Computing weights for " << events.size() << " events using " << n_threads << " threads";
+
+    std::vector<std::vector<std::pair<double, double>>> results(events.size());
+    std::vector<IntegrationStatus> statuses(events.size(), IntegrationStatus::NONE);
+    std::vector<std::exception_ptr> errors(n_threads);
+
+    // Index of the next event to integrate, shared by all the threads
+    std::atomic<std::size_t> next_event(0);
+
+    auto worker = [&](MoMEMta& instance, std::size_t thread_index) {
+        try {
+            std::size_t event_index;
+            while ((event_index = next_event++) < events.size()) {
+                const auto& event = events[event_index];
+                instance.setEvent(event.particles, event.met);
+                results[event_index] = instance.integrate();
+                statuses[event_index] = instance.getIntegrationStatus();
+            }
+        } catch (...) {
+            errors[thread_index] = std::current_exception();
+            // Prevent other threads from starting the integration of new events
+            next_event = events.size();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for (std::size_t i = 1; i < n_threads; i++)
+            threads.emplace_back(worker, std::ref(*m_workers[i - 1]), i);
+    } catch (...) {
+        // Destroying a joinable thread terminates the program: stop and join the threads already started
+        next_event = events.size();
+        for (auto& thread: threads)
+            thread.join();
+
+        throw;
+    }
+
+    // This instance is used by the calling thread
+    worker(*this, 0);
+
+    for (auto& thread: threads)
+        thread.join();
+
+    for (const auto& error: errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    integration_status = IntegrationStatus::SUCCESS;
+    for (const auto& status: statuses) {
+        if (status != IntegrationStatus::SUCCESS) {
+            integration_status = status;
+            break;
+        }
+    }
+
+    return results;
+}
+
+std::vector<std::pair<double, double>> MoMEMta::integrate() {
+
     m_computation_graph->beginIntegration();
 
     std::unique_ptr<double[]> mcResult(new double[m_n_components]);
@@ -225,13 +426,13 @@ std::vector<std::pair<double, double>> MoMEMta::computeWeights(const std::vector
         bool takeOnlyGridFromFile = m_cuba_configuration.get<bool>("takeOnlyGridFromFile", true);
         // Only used by vegas and suave!
         bool smoothing = m_cuba_configuration.get<bool>("smoothing", true);
+        // Maximum number of points given to the integrand in each invocation
+        int64_t n_vec = m_cuba_configuration.get<int64_t>("n_vec", 1);
+        if (n_vec < 1)
+            throw cuba_configuration_error("Invalid value for 'n_vec': at least one point must be evaluated per invocation");
 
         unsigned int flags = cuba::createFlagsBitset(verbosity, subregion, retainStateFile, level, smoothing, takeOnlyGridFromFile);
 
-        int64_t ncores = m_cuba_configuration.get<int64_t>("ncores", 0);
-        int64_t pcores = m_cuba_configuration.get<int64_t>("pcores", 1000000);
-        cubacores(ncores, pcores);
-
         // Output from cuba
         long long int neval = 0;
         int nfail = 0;
@@ -252,7 +453,7 @@ std::vector<std::pair<double, double>> MoMEMta::computeWeights(const std::vector
                     m_n_components,         // (int) dimensions of the integrand
                     reinterpret_cast<integrand_t>(CUBAIntegrandWeighted),  // (integrand_t) integrand (cast to integrand_t)
                     (void *) this,           // (void*) pointer to additional arguments passed to integrand
-                    1,                      // (int) maximum number of points given the integrand in each invocation (=> SIMD) ==> PS points = vector of sets of points (x[ndim][nvec]), integrand returns vector of vector values (f[ncomp][nvec])
+                    n_vec,                  // (int) maximum number of points given the integrand in each invocation (=> SIMD) ==> PS points = vector of sets of points (x[nvec][ndim]), integrand returns vector of vector values (f[nvec][ncomp])
                     relative_accuracy,      // (double) requested relative accuracy  /
                     absolute_accuracy,      // (double) requested absolute accuracy /-> error < max(rel*value,abs)
                     flags,                  // (int) various control flags in binary format, see setFlags function
@@ -283,7 +484,7 @@ std::vector<std::pair<double, double>> MoMEMta::computeWeights(const std::vector
                     m_n_components,
                     reinterpret_cast<integrand_t>(CUBAIntegrandWeighted),
                     (void *) this,
-                    1,
+                    n_vec,
                     relative_accuracy,
                     absolute_accuracy,
                     flags,
@@ -318,7 +519,7 @@ std::vector<std::pair<double, double>> MoMEMta::computeWeights(const std::vector
                     m_n_components,
                     reinterpret_cast<integrand_t>(CUBAIntegrand),
                     (void *) this,
-                    1,
+                    n_vec,
                     relative_accuracy,
                     absolute_accuracy,
                     flags,
@@ -354,7 +555,7 @@ std::vector<std::pair<double, double>> MoMEMta::computeWeights(const std::vector
                     m_n_components,
                     reinterpret_cast<integrand_t>(CUBAIntegrand),
                     (void *) this,
-                    1,
+                    n_vec,
                     relative_accuracy,
                     absolute_accuracy,
                     flags,
@@ -424,6 +625,29 @@ std::vector<double> MoMEMta::evaluateIntegrand(const std::vector<double>& psPoin
     return results;
 }
 
+std::vector<std::vector<double>> MoMEMta::evaluateIntegrandBatch(const std::vector<std::vector<double>>& psPoints) {
+
+    std::vector<double> points(psPoints.size() * m_n_dimensions);
+    for (size_t p = 0; p < psPoints.size(); p++) {
+        if (psPoints[p].size() != m_n_dimensions) {
+            throw invalid_inputs("Dimensionality of the phase-space point is incorrect.");
+        }
+
+        std::copy(psPoints[p].begin(), psPoints[p].end(), points.begin() + p * m_n_dimensions);
+    }
+
+    std::vector<double> results(psPoints.size() * m_n_components);
+    if (!psPoints.empty())
+        integrandBatch(psPoints.size(), points.data(), results.data());
+
+    std::vector<std::vector<double>> weights;
+    for (size_t p = 0; p < psPoints.size(); p++) {
+        weights.emplace_back(results.begin() + p * m_n_components, results.begin() + (p + 1) * m_n_components);
+    }
+
+    return weights;
+}
+
 int MoMEMta::integrand(const double* psPoints, double* results, const double* weights) {
 
     // Store phase-space points into the pool
@@ -454,22 +678,72 @@ int MoMEMta::integrand(const double* psPoints, double* results, const double* we
     return return_value;
 }
 
+int MoMEMta::integrandBatch(std::size_t n, const double* psPoints, double* results, const double* weights) {
+
+    m_batch_ps_points = psPoints;
+    m_batch_ps_weights = weights;
+    m_batch_statuses.resize(n);
+
+    auto status = m_computation_graph->executeBatch(n, m_set_batch_point, m_batch_statuses.data());
+
+    if (status == Module::Status::ABORT) {
+        std::fill(results, results + n * m_n_components, 0.);
+        return CUBA_ABORT;
+    }
+
+    for (size_t p = 0; p < n; p++) {
+        double* point_results = results + p * m_n_components;
+        if (m_batch_statuses[p] != Module::Status::OK) {
+            for (size_t i = 0; i < m_n_components; i++)
+                point_results[i] = 0;
+
+            continue;
+        }
+
+        m_computation_graph->loadBatchOutputs(p);
+        for (size_t i = 0; i < m_n_components; i++) {
+            point_results[i] = *(m_integrands[i]);
+            if (!std::isfinite(point_results[i]))
+                throw integrands_nonfinite_error("Integrand component " + std::to_string(i) + " is infinite or NaN!");
+        }
+    }
+
+    return CUBA_OK;
+}
+
+void MoMEMta::setBatchPoint(std::size_t i) {
+    std::memcpy(m_ps_points->data(), m_batch_ps_points + i * m_n_dimensions, sizeof(double) * m_n_dimensions);
+
+    if (m_batch_ps_weights != nullptr)
+        *m_ps_weight = m_batch_ps_weights[i];
+}
+
 int MoMEMta::CUBAIntegrand(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core) {
+    UNUSED(core);
     UNUSED(nDim);
     UNUSED(nComp);
-    UNUSED(nVec);
-    UNUSED(core);
 
-    return static_cast<MoMEMta*>(inputs)->integrand(psPoint, value);
+    MoMEMta* momemta = static_cast<MoMEMta*>(inputs);
+
+    // Cuba hands over up to `nVec` points at once: x[nVec][nDim] and f[nVec][nComp]
+    if (*nVec == 1)
+        return momemta->integrand(psPoint, value);
+
+    return momemta->integrandBatch(*nVec, psPoint, value);
 }
 
 int MoMEMta::CUBAIntegrandWeighted(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core, const double *weight) {
+    UNUSED(core);
     UNUSED(nDim);
     UNUSED(nComp);
-    UNUSED(nVec);
-    UNUSED(core);
 
-    return static_cast<MoMEMta*>(inputs)->integrand(psPoint, value, weight);
+    MoMEMta* momemta = static_cast<MoMEMta*>(inputs);
+
+    // Cuba hands over up to `nVec` points at once: x[nVec][nDim], f[nVec][nComp] and weight[nVec]
+    if (*nVec == 1)
+        return momemta->integrand(psPoint, value, weight);
+
+    return momemta->integrandBatch(*nVec, psPoint, value, weight);
 }
 
 void MoMEMta::cuba_logging(const char* s) {
@@ -507,8 +781,8 @@ void MoMEMta::initPool(const Configuration& configuration) {
     auto inputs = configuration.getInputs();
     for (const auto& input: inputs) {
         LOG(debug) << "Input declared: " << input;
-        m_inputs_p4.emplace(input, m_pool->put<LorentzVector>({input, "p4"}));
-        m_inputs_type.emplace(input, m_pool->put<int64_t>({input, "type"}));
+        m_inputs_index.emplace(input, m_inputs.size());
+        m_inputs.push_back({m_pool->put<LorentzVector>({input, "p4"}), m_pool->put<int64_t>({input, "type"})});
     }
 
     // Create input for met
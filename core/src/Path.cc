@@ -29,10 +29,23 @@ ExecutionPath::ExecutionPath() {
     id = boost::uuids::basic_random_generator<std::mt19937>(random_engine)();
 }
 
-Path::Path(const std::vector<std::shared_ptr<Module>>& modules) {
+Path::Path(const std::vector<std::shared_ptr<Module>>& modules):
+        Path(modules, std::vector<unsigned int>(modules.size(), momemta::HOOK_ALL)) {
+}
+
+Path::Path(const std::vector<std::shared_ptr<Module>>& modules, const std::vector<unsigned int>& hooks,
+           std::shared_ptr<momemta::Profiler> profiler) {
     modules_ = modules;
+    for (std::size_t i = 0; i < modules_.size(); i++)
+        plan_.add(modules_[i].get(), hooks[i]);
+
+    plan_.setProfiler(profiler);
 }
 
 const std::vector<ModulePtr>& Path::modules() const {
     return modules_;
 }
+
+const momemta::ExecutionPlan& Path::plan() const {
+    return plan_;
+}
@@ -42,7 +42,7 @@ momemta::any Pool::reserve(const InputTag& tag) {
         // Reserve a slot, but mark it as invalid.
         // Once a module inform the pool it produces such a tag, the slot will
         // be flagged as valid.
-        PoolContent content { momemta::any(), false };
+        PoolContent content { momemta::any(), false, nullptr };
         it = m_storage.emplace(tag, content).first;
     }
 
@@ -70,6 +70,20 @@ bool Pool::exists(const InputTag& tag) const {
     return it != m_storage.end();
 }
 
+momemta::BlockCopies Pool::copies(const InputTag& tag) const {
+    auto it = m_storage.find(tag);
+    if (it == m_storage.end())
+        throw tag_not_found_error("No such tag in pool: " + tag.toString());
+
+    const PoolContent& content = it->second;
+    if (!content.ops || !content.ops->data) {
+        LOG(fatal) << "Memory block '" << tag.toString() << "' cannot be copied for each point of a batch.";
+        throw std::invalid_argument("Memory block '" + tag.toString() + "' cannot be copied");
+    }
+
+    return momemta::BlockCopies(content.ptr, content.ops);
+}
+
 class invalid_state: public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
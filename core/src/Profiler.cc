@@ -0,0 +1,135 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Profiler.h>
+
+#include <cmath>
+
+namespace momemta {
+
+constexpr std::size_t Profiler::N_BINS;
+
+std::size_t Profiler::add(const Module* module, const std::string& name, const std::string& type) {
+    Entry entry;
+    entry.name = name;
+    entry.type = type;
+    m_entries.push_back(entry);
+
+    m_indices[module] = m_entries.size() - 1;
+    return m_entries.size() - 1;
+}
+
+std::size_t Profiler::index(const Module* module) const {
+    return m_indices.at(module);
+}
+
+void Profiler::clear() {
+    m_entries.clear();
+    m_indices.clear();
+}
+
+void Profiler::reset() {
+    for (auto& entry: m_entries) {
+        const std::string name = entry.name;
+        const std::string type = entry.type;
+        entry = Entry();
+        entry.name = name;
+        entry.type = type;
+    }
+}
+
+void Profiler::merge(const Profiler& other) {
+    for (const auto& other_entry: other.m_entries) {
+        for (auto& entry: m_entries) {
+            if (entry.name != other_entry.name)
+                continue;
+
+            entry.calls += other_entry.calls;
+            entry.total += other_entry.total;
+            for (std::size_t i = 0; i < entry.statuses.size(); i++)
+                entry.statuses[i] += other_entry.statuses[i];
+            for (std::size_t i = 0; i < N_BINS; i++)
+                entry.histogram[i] += other_entry.histogram[i];
+
+            break;
+        }
+    }
+}
+
+std::vector<ModuleProfile> Profiler::profile() const {
+    std::vector<ModuleProfile> result;
+    for (const auto& entry: m_entries) {
+        ModuleProfile profile;
+        profile.name = entry.name;
+        profile.type = entry.type;
+        profile.calls = entry.calls;
+        profile.ok = entry.statuses[static_cast<std::size_t>(Module::Status::OK)];
+        profile.next = entry.statuses[static_cast<std::size_t>(Module::Status::NEXT)];
+        profile.abort = entry.statuses[static_cast<std::size_t>(Module::Status::ABORT)];
+        profile.total_time = std::chrono::duration_cast<std::chrono::duration<double>>(entry.total).count();
+        profile.median_time = quantile(entry, 0.5);
+        profile.p90_time = quantile(entry, 0.9);
+        profile.p99_time = quantile(entry, 0.99);
+
+        result.push_back(profile);
+    }
+
+    return result;
+}
+
+std::size_t Profiler::bin(std::int64_t ns) {
+    if (ns < 4)
+        return (ns < 0) ? 0 : static_cast<std::size_t>(ns);
+
+    // Position of the most significant bit, and the two bits following it
+    std::size_t msb = 63 - __builtin_clzll(static_cast<unsigned long long>(ns));
+    std::size_t sub = (ns >> (msb - 2)) & 3;
+
+    std::size_t index = 4 * (msb - 1) + sub;
+    return (index < N_BINS) ? index : N_BINS - 1;
+}
+
+double Profiler::quantile(const Entry& entry, double q) {
+    if (entry.calls == 0)
+        return 0;
+
+    // Smallest bin such that a fraction q of the calls are in this bin or before
+    const double target = q * entry.calls;
+    std::uint64_t count = 0;
+    std::size_t index = 0;
+    for (; index < N_BINS; index++) {
+        count += entry.histogram[index];
+        if (count >= target && count > 0)
+            break;
+    }
+
+    // Center of the bin
+    double ns;
+    if (index < 4) {
+        ns = index;
+    } else {
+        std::size_t msb = index / 4 + 1;
+        std::size_t sub = index % 4;
+        double width = std::ldexp(1., msb - 2);
+        ns = (4 + sub) * width + width / 2;
+    }
+
+    return ns * 1e-9;
+}
+
+}
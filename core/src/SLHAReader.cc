@@ -1,8 +1,12 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <regex>
 
+#include <sys/stat.h>
+
 #include <momemta/SLHAReader.h>
 
 namespace SLHA {
@@ -55,6 +59,33 @@ Reader::Reader(const std::string& file_name /* = ""*/) {
 }
 
 void Reader::read_slha_file(const std::string& file_name) {
+    // Cards are parsed only once per process, and re-parsed only if modified
+    static std::mutex s_mutex;
+    static std::map<std::string, std::pair<time_t, std::shared_ptr<const Reader>>> s_cards;
+
+    std::shared_ptr<const Reader> card;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+
+        struct stat file_stat;
+        time_t modification_time = (stat(file_name.c_str(), &file_stat) == 0) ? file_stat.st_mtime : 0;
+
+        auto it = s_cards.find(file_name);
+        if (it != s_cards.end() && it->second.first == modification_time) {
+            card = it->second.second;
+        } else {
+            std::shared_ptr<Reader> reader = std::make_shared<Reader>();
+            reader->parse_slha_file(file_name);
+            card = reader;
+            s_cards[file_name] = std::make_pair(modification_time, card);
+        }
+    }
+
+    for (const auto& block: card->_blocks)
+        _blocks[block.first] = block.second;
+}
+
+void Reader::parse_slha_file(const std::string& file_name) {
     std::ifstream param_card(file_name.c_str(), std::ifstream::in);
     if (!param_card.is_open())
         throw invalid_card_error("Error while opening param card");
@@ -27,7 +27,7 @@ namespace logger {
 static logger_ptr init_logger() {
     bool in_terminal = isatty(fileno(stdout)) == 1;
 
-    auto sink = sinks::stdout_sink_st::instance();
+    auto sink = sinks::stdout_sink_mt::instance();
 
     auto l = std::make_shared<logger>(sink);
     l->flush_on(logging::level::trace);
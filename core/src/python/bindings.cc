@@ -101,6 +101,65 @@ bp::list MoMEMta_computeWeights(MoMEMta& m, bp::list particles) {
     return MoMEMta_computeWeights_MET(m, particles, bp::list());
 }
 
+/**
+ * Each event is either a list of particles, or a tuple `(particles, met)`
+ */
+bp::list MoMEMta_computeWeightsBatch_threads(MoMEMta& m, bp::list events_, std::size_t n_threads) {
+    std::vector<Event> events;
+    for (ssize_t i = 0; i < bp::len(events_); i++) {
+        bp::object event_ = events_[i];
+
+        bp::object particles_ = event_;
+        bp::object met_;
+        bp::extract<bp::tuple> tupleExtractor(event_);
+        if (tupleExtractor.check()) {
+            bp::tuple t = tupleExtractor();
+            particles_ = t[0];
+            if (bp::len(t) > 1)
+                met_ = t[1];
+        }
+
+        Event event;
+        for (ssize_t j = 0; j < bp::len(particles_); j++) {
+            event.particles.push_back(bp::extract<Particle>(particles_[j]));
+        }
+
+        bp::extract<LorentzVector> lorentzVectorExtractor(met_);
+        if (lorentzVectorExtractor.check())
+            event.met = lorentzVectorExtractor();
+
+        events.push_back(event);
+    }
+
+    std::vector<std::vector<std::pair<double, double>>> weights;
+    {
+        // Release the GIL while integrating
+        PyThreadState* state = PyEval_SaveThread();
+        try {
+            weights = m.computeWeightsBatch(events, n_threads);
+        } catch (...) {
+            PyEval_RestoreThread(state);
+            throw;
+        }
+        PyEval_RestoreThread(state);
+    }
+
+    bp::list result;
+    for (const auto& event_weights: weights) {
+        bp::list event_result;
+        for (const auto& weight: event_weights) {
+            event_result.append(bp::make_tuple(weight.first, weight.second));
+        }
+        result.append(event_result);
+    }
+
+    return result;
+}
+
+bp::list MoMEMta_computeWeightsBatch(MoMEMta& m, bp::list events) {
+    return MoMEMta_computeWeightsBatch_threads(m, events, 0);
+}
+
 bp::list MoMEMta_getSolutions_MET(MoMEMta& m, const std::string& blockName, bp::list particles_, bp::list met_) {
 
     std::vector<Particle> particles;
@@ -137,6 +196,14 @@ bp::list MoMEMta_getSolutions_MET(MoMEMta& m, const std::string& blockName, bp::
     
 }
 
+bp::list MoMEMta_getProfile(const MoMEMta& m) {
+    bp::list result;
+    for (const auto& module: m.getProfile())
+        result.append(module);
+
+    return result;
+}
+
 bp::list MoMEMta_getSolutions(MoMEMta& m, const std::string& blockName, bp::list particles) {
     return MoMEMta_getSolutions_MET(m, blockName, particles, bp::list());
 }
@@ -286,7 +353,19 @@ BOOST_PYTHON_MODULE(momemta) {
             .add_property("p4", make_getter(&Particle::p4, return_value_policy<return_by_value>()), &Particle::p4)
             .def_readwrite("type", &Particle::type);
 
-    class_<MoMEMta>("MoMEMta", init<Configuration>())
+    class_<ModuleProfile>("ModuleProfile")
+            .def_readonly("name", &ModuleProfile::name)
+            .def_readonly("type", &ModuleProfile::type)
+            .def_readonly("calls", &ModuleProfile::calls)
+            .def_readonly("ok", &ModuleProfile::ok)
+            .def_readonly("next", &ModuleProfile::next)
+            .def_readonly("abort", &ModuleProfile::abort)
+            .def_readonly("total_time", &ModuleProfile::total_time)
+            .def_readonly("median_time", &ModuleProfile::median_time)
+            .def_readonly("p90_time", &ModuleProfile::p90_time)
+            .def_readonly("p99_time", &ModuleProfile::p99_time);
+
+    class_<MoMEMta, boost::noncopyable>("MoMEMta", init<Configuration>())
             .def("getIntegrationStatus", &MoMEMta::getIntegrationStatus)
             //.def("getPool", &MoMEMta::getPool, return_value_policy<copy_const_reference>())
             .def("getSolutions", MoMEMta_getSolutions)
@@ -294,8 +373,14 @@ BOOST_PYTHON_MODULE(momemta) {
             .def("computeWeights", MoMEMta_computeWeights)
             .def("computeWeights", MoMEMta_computeWeights_MET)
             .def("computeWeights", &MoMEMta::computeWeights, MoMEMta_computeWeights_overloads())
+            .def("computeWeightsBatch", MoMEMta_computeWeightsBatch)
+            .def("computeWeightsBatch", MoMEMta_computeWeightsBatch_threads)
             .def("setEvent", MoMEMta_setEvent)
             .def("setEvent", MoMEMta_setEvent_MET)
-            .def("setEvent", &MoMEMta::setEvent, MoMEMta_setEvent_overloads())
-            .def("evaluateIntegrand", MoMEMta_evaluateIntegrand);
+            .def("setEvent", static_cast<void (MoMEMta::*)(const std::vector<Particle>&, const LorentzVector&)>(&MoMEMta::setEvent),
+                    MoMEMta_setEvent_overloads())
+            .def("evaluateIntegrand", MoMEMta_evaluateIntegrand)
+            .def("setProfiling", &MoMEMta::setProfiling)
+            .def("getProfile", MoMEMta_getProfile)
+            .def("resetProfile", &MoMEMta::resetProfile);
 }
@@ -255,6 +255,16 @@ ModuleDefBuilder& ModuleDefBuilder::Sticky() {
     return *this;
 }
 
+ModuleDefBuilder& ModuleDefBuilder::Filter() {
+    reg_data.module_def.filter = true;
+    return *this;
+}
+
+ModuleDefBuilder& ModuleDefBuilder::Cost(double cost) {
+    reg_data.module_def.cost = cost;
+    return *this;
+}
+
 std::string ModuleDefBuilder::name() const {
     return reg_data.module_def.name;
 }
@@ -18,7 +18,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <stdexcept>
 #include <vector>
 
 /// Compute \f$ x^2 \f$
@@ -70,6 +74,77 @@ inline double cosXpm2PI3(const double x, const double pm) {
     return -0.5 * (std::cos(x) + pm * std::sin(x) * std::sqrt(3.));
 }
 
+/**
+ * \brief Real roots of a polynomial equation, stored inline
+ *
+ * Behaves like a `std::vector<double>` with a fixed capacity of \p N roots. Used by the
+ * allocation-free versions of the solvers below, so that solving an equation never allocates memory.
+ */
+template <std::size_t N>
+class FixedRoots {
+public:
+    /// Maximum number of roots
+    static constexpr std::size_t MAX_SIZE = N;
+
+    using value_type = double;
+    using iterator = double*;
+    using const_iterator = const double*;
+
+    void push_back(double root) {
+        if (m_size == N)
+            throw std::length_error("Too many roots");
+
+        m_roots[m_size++] = root;
+    }
+
+    iterator erase(iterator position) {
+        std::copy(position + 1, end(), position);
+        m_size--;
+
+        return position;
+    }
+
+    void clear() {
+        m_size = 0;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    double& operator[](std::size_t index) {
+        return m_roots[index];
+    }
+
+    double operator[](std::size_t index) const {
+        return m_roots[index];
+    }
+
+    double at(std::size_t index) const {
+        if (index >= m_size)
+            throw std::out_of_range("Invalid root index");
+
+        return m_roots[index];
+    }
+
+    iterator begin() { return m_roots.data(); }
+    iterator end() { return m_roots.data() + m_size; }
+    const_iterator begin() const { return m_roots.data(); }
+    const_iterator end() const { return m_roots.data() + m_size; }
+
+private:
+    std::array<double, N> m_roots;
+    std::size_t m_size = 0;
+};
+
+using QuadraticRoots = FixedRoots<2>; ///< Roots of a quadratic equation
+using CubicRoots = FixedRoots<3>; ///< Roots of a cubic equation
+using QuarticRoots = FixedRoots<4>; ///< Roots of a quartic equation, or solutions of a system of two conics
+
 /**
  * \brief Finds the real solutions to \f$ a*x^2 + b*x + c = 0 \f$
  *
@@ -81,13 +156,20 @@ inline double cosXpm2PI3(const double x, const double pm) {
  *
  * \param a, b, c Coefficient of quadratic equation
  * \param[out] roots Roots of equation
- * \param verbose If true, print the solution of the equation
+ * \param verbose If true, print the solution of the equation, or why it could not be solved
  *
  * \return True if a solution has been found, false otherwise
  */
 bool solveQuadratic(const double a, const double b, const double c, std::vector<double>& roots,
                     bool verbose = false);
 
+/**
+ * \brief Allocation-free version of solveQuadratic()
+ *
+ * \p roots is cleared before solving. Nothing is printed.
+ */
+bool solveQuadratic(const double a, const double b, const double c, QuadraticRoots& roots);
+
 /**
  * \brief Finds the real solutions to \f$ a*x^3 + b*x^2 + c*x + d = 0 \f$
  *
@@ -95,19 +177,26 @@ bool solveQuadratic(const double a, const double b, const double c, std::vector<
  *
  * Appends the solutions to \p roots, making no attempt to check whether the vector is empty.
  *
- * \note Multiple roots are present multiple times.
+ * \note Multiple roots are present multiple times. When the equation has a single real root, it is only present once.
  *
  * \note Inspired by "Numerical Recipes" (Press, Teukolsky, Vetterling, Flannery), 2007 Cambridge University Press
  *
  * \param a, b, c, d Coefficient of the equation
  * \param[out] roots Roots of equation
- * \param verbose If true, print the solution of the equation
+ * \param verbose If true, print the solution of the equation, or why it could not be solved
  *
  * \return True if a solution has been found, false otherwise
  */
 bool solveCubic(const double a, const double b, const double c, const double d,
                 std::vector<double>& roots, bool verbose = false);
 
+/**
+ * \brief Allocation-free version of solveCubic()
+ *
+ * \p roots is cleared before solving. Nothing is printed.
+ */
+bool solveCubic(const double a, const double b, const double c, const double d, CubicRoots& roots);
+
 // Finds the real solutions to a*x^4 + b*x^3 + c*x^2 + d*x + e = 0
 // Handles special case a=0.
 // Appends the solutions to the std::vector roots, making no attempt to check whether the vector is
@@ -140,13 +229,21 @@ bool solveCubic(const double a, const double b, const double c, const double d,
  *
  * \param a, b, c, d, e Coefficient of the equation
  * \param[out] roots Roots of equation
- * \param verbose If true, print the solution of the equation
+ * \param verbose If true, print the solution of the equation, or why it could not be solved
  *
  * \return True if a solution has been found, false otherwise
  */
 bool solveQuartic(const double a, const double b, const double c, const double d, const double e,
                   std::vector<double>& roots, bool verbose = false);
 
+/**
+ * \brief Allocation-free version of solveQuartic()
+ *
+ * \p roots is cleared before solving. Nothing is printed.
+ */
+bool solveQuartic(const double a, const double b, const double c, const double d, const double e,
+                  QuarticRoots& roots);
+
 /**
  * \brief Solve a system of two quadratic equations
  *
@@ -177,6 +274,16 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
                  const double b11, const double b10, const double b01, const double b00,
                  std::vector<double>& E1, std::vector<double>& E2, bool verbose = false);
 
+/**
+ * \brief Allocation-free version of solve2Quads()
+ *
+ * \p E1 and \p E2 are cleared before solving. Nothing is printed.
+ */
+bool solve2Quads(const double a20, const double a02, const double a11, const double a10,
+                 const double a01, const double a00, const double b20, const double b02,
+                 const double b11, const double b10, const double b01, const double b00,
+                 QuarticRoots& E1, QuarticRoots& E2);
+
 /**
  * \brief Solve a system of two degenerated quadratic equations
  *
@@ -198,6 +305,15 @@ bool solve2QuadsDeg(const double a11, const double a10, const double a01, const
                     const double b11, const double b10, const double b01, const double b00,
                     std::vector<double>& E1, std::vector<double>& E2, bool verbose = false);
 
+/**
+ * \brief Allocation-free version of solve2QuadsDeg()
+ *
+ * \p E1 and \p E2 are cleared before solving. Nothing is printed.
+ */
+bool solve2QuadsDeg(const double a11, const double a10, const double a01, const double a00,
+                    const double b11, const double b10, const double b01, const double b00,
+                    QuadraticRoots& E1, QuadraticRoots& E2);
+
 /**
  * \brief Solve a system of two linear equations
  *
@@ -216,6 +332,102 @@ bool solve2Linear(const double a10, const double a01, const double a00, const do
                   const double b01, const double b00, std::vector<double>& E1,
                   std::vector<double>& E2, bool verbose = false);
 
+/**
+ * \brief Allocation-free version of solve2Linear()
+ *
+ * \p E1 and \p E2 are cleared before solving. Nothing is printed.
+ */
+bool solve2Linear(const double a10, const double a01, const double a00, const double b10,
+                  const double b01, const double b00, FixedRoots<1>& E1, FixedRoots<1>& E2);
+
+/**
+ * \brief Refine a root of \f$ a*x^4 + b*x^3 + c*x^2 + d*x + e = 0 \f$ using Newton's method
+ *
+ * The closed-form solution of solveQuartic() is affected by cancellations, and its roots can be off by much more
+ * than the machine precision. A few Newton iterations on the original polynomial bring them back to full precision.
+ *
+ * The iterations stop early if a step does not decrease the absolute value of the polynomial, so that the returned
+ * root is never worse than \p x.
+ *
+ * \param a, b, c, d, e Coefficient of the equation
+ * \param x Root to refine
+ * \param iterations Maximum number of iterations
+ * \return The refined root
+ */
+double polishQuarticRoot(const double a, const double b, const double c, const double d, const double e, double x,
+                         const unsigned int iterations);
+
+/**
+ * \brief Refine a solution of the system of two quadratic equations solved by solve2Quads() using Newton's method
+ *
+ * Same as polishQuarticRoot(), but the iterations are done on the original system of equations, so that the errors
+ * made when eliminating \f$ E_1 \f$ to get a quartic in \f$ E_2 \f$ are corrected as well. The iterations stop
+ * early if a step does not decrease the sum of the squares of the equations.
+ *
+ * \param a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00 Coefficients of the system
+ * \param[in,out] E1, E2 Solution to refine
+ * \param iterations Maximum number of iterations
+ */
+void polish2QuadsSolution(const double a20, const double a02, const double a11, const double a10, const double a01,
+                          const double a00, const double b20, const double b02, const double b11, const double b10,
+                          const double b01, const double b00, double& E1, double& E2, const unsigned int iterations);
+
+/// Default relative tolerance used to identify identical roots
+constexpr double ROOT_TOLERANCE = 1e-7;
+
+/**
+ * \brief Check if two roots are identical, up to a relative \p tolerance
+ */
+inline bool isSameRoot(const double x, const double y, const double tolerance = ROOT_TOLERANCE) {
+    return std::abs(x - y) <= tolerance * std::max(std::abs(x), std::abs(y));
+}
+
+/**
+ * \brief Remove the roots appearing several times
+ *
+ * The solvers return multiple roots several times, and nearly degenerate equations give roots differing only
+ * by rounding errors. A multiple root is a single point of the phase-space, though, and must only give one
+ * solution. The first occurrence of each root is kept, and the order of the roots is preserved.
+ *
+ * \param[in,out] roots Roots of an equation, as returned by one of the solvers above
+ * \param tolerance Relative tolerance used to identify identical roots
+ */
+template <typename Roots>
+void removeDuplicateRoots(Roots& roots, const double tolerance = ROOT_TOLERANCE) {
+    for (std::size_t i = 1; i < roots.size();) {
+        bool duplicate = false;
+        for (std::size_t j = 0; j < i && !duplicate; j++)
+            duplicate = isSameRoot(roots[i], roots[j], tolerance);
+
+        if (duplicate)
+            roots.erase(roots.begin() + i);
+        else
+            i++;
+    }
+}
+
+/**
+ * \brief Remove the solutions of a system of equations appearing several times
+ *
+ * Same as removeDuplicateRoots(), for the solutions \f$ (E_1, E_2) \f$ of a system of two equations, as returned
+ * by solve2Quads(). Two solutions are identical if both their coordinates are.
+ */
+template <typename Roots>
+void removeDuplicateSolutions(Roots& E1, Roots& E2, const double tolerance = ROOT_TOLERANCE) {
+    for (std::size_t i = 1; i < E1.size();) {
+        bool duplicate = false;
+        for (std::size_t j = 0; j < i && !duplicate; j++)
+            duplicate = isSameRoot(E1[i], E1[j], tolerance) && isSameRoot(E2[i], E2[j], tolerance);
+
+        if (duplicate) {
+            E1.erase(E1.begin() + i);
+            E2.erase(E2.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
 /**
  * \brief A relativist Breit-Wigner distribution
  */
@@ -0,0 +1,102 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <momemta/Math.h>
+
+/**
+ * \file
+ * \brief Batched versions of the polynomial solvers
+ *
+ * Each function solves #momemta::batch::NLANES independent equations (or systems) at once, one per
+ * lane. Coefficients are passed as one array per coefficient, holding the value for each lane, and
+ * the roots are returned the same way (structure-of-arrays).
+ *
+ * The generic case is handled without branches: every lane goes through the same arithmetic, and the
+ * different cases of the scalar algorithms are resolved by selecting between their results. The loops
+ * have a fixed trip count, so that the compiler can map them onto SIMD registers. The special cases
+ * (vanishing leading coefficient, biquadratic equations, degenerate conics, ...) are detected
+ * afterwards, and only the lanes concerned are solved again using the scalar functions.
+ *
+ * The roots are the same as the ones returned by the scalar functions, in the same order, up to
+ * rounding.
+ */
+
+namespace momemta {
+namespace batch {
+
+/// Number of equations solved by each call. 4 doubles fill an AVX2 register.
+constexpr std::size_t NLANES = 4;
+
+/// Up to \p N real roots for each lane
+template <std::size_t N>
+struct alignas(32) LaneRoots {
+    double roots[N][NLANES]; ///< `roots[i][lane]` is the i-th root of the equation in lane `lane`
+    std::size_t size[NLANES]; ///< Number of roots found for each lane
+
+    /// Roots of a single lane
+    FixedRoots<N> get(std::size_t lane) const {
+        FixedRoots<N> result;
+        for (std::size_t i = 0; i < size[lane]; i++)
+            result.push_back(roots[i][lane]);
+
+        return result;
+    }
+
+    /// Replace the roots of a single lane
+    void set(std::size_t lane, const FixedRoots<N>& values) {
+        size[lane] = values.size();
+        for (std::size_t i = 0; i < values.size(); i++)
+            roots[i][lane] = values[i];
+    }
+};
+
+/**
+ * \brief Batched version of ::solveQuadratic
+ */
+void solveQuadratic(const double a[NLANES], const double b[NLANES], const double c[NLANES],
+                    LaneRoots<2>& roots);
+
+/**
+ * \brief Batched version of ::solveCubic
+ */
+void solveCubic(const double a[NLANES], const double b[NLANES], const double c[NLANES],
+                const double d[NLANES], LaneRoots<3>& roots);
+
+/**
+ * \brief Batched version of ::solveQuartic
+ */
+void solveQuartic(const double a[NLANES], const double b[NLANES], const double c[NLANES],
+                  const double d[NLANES], const double e[NLANES], LaneRoots<4>& roots);
+
+/**
+ * \brief Batched version of ::solve2Quads
+ *
+ * The solutions for lane `l` are the pairs `(E1.roots[i][l], E2.roots[i][l])`, with `i < E1.size[l]`.
+ */
+void solve2Quads(const double a20[NLANES], const double a02[NLANES], const double a11[NLANES],
+                 const double a10[NLANES], const double a01[NLANES], const double a00[NLANES],
+                 const double b20[NLANES], const double b02[NLANES], const double b11[NLANES],
+                 const double b10[NLANES], const double b01[NLANES], const double b00[NLANES],
+                 LaneRoots<4>& E1, LaneRoots<4>& E2);
+
+}
+}
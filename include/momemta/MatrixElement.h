@@ -21,7 +21,9 @@
 #ifndef MOMEMTA_MATRIXELEMENT_H
 #define MOMEMTA_MATRIXELEMENT_H
 
+#include <cstddef>
 #include <map>
+#include <stdexcept>
 #include <utility>
 #include <memory>
 #include <string>
@@ -29,6 +31,7 @@
 
 #include <momemta/MEParameters.h>
 #include <momemta/ParameterSet.h>
+#include <momemta/Unused.h>
 
 namespace momemta {
     
@@ -36,6 +39,40 @@ namespace momemta {
         public:
             using Result = std::map<std::pair<int, int>, double>;
 
+            /// For each sub-process of the matrix element, flags of the helicity combinations not known to vanish
+            using HelicityTable = std::vector<std::vector<bool>>;
+
+            /// Identifier of a final state of the matrix element, see resolveFinalState()
+            using FinalStateHandle = int;
+
+            /// Maximum number of initial states in a FlatResult
+            static constexpr std::size_t MAX_INITIAL_STATES = 32;
+
+            /**
+             * \brief Result of computeFlat(): the matrix element for each initial state (pair of parton PDG ids)
+             *
+             * The storage has a fixed size, so that the same result can be reused for each evaluation without
+             * allocating memory.
+             */
+            struct FlatResult {
+                std::size_t size = 0;
+                std::pair<int, int> initialStates[MAX_INITIAL_STATES];
+                double values[MAX_INITIAL_STATES];
+
+                void clear() {
+                    size = 0;
+                }
+
+                void push_back(const std::pair<int, int>& initialState, double value) {
+                    if (size == MAX_INITIAL_STATES)
+                        throw std::length_error("Too many initial states in matrix element result");
+
+                    initialStates[size] = initialState;
+                    values[size] = value;
+                    size++;
+                }
+            };
+
             MatrixElement() = default;
             virtual ~MatrixElement() {};
 
@@ -46,7 +83,145 @@ namespace momemta {
                     const std::vector<std::pair<int, std::vector<double>>>& finalState
                     ) = 0;
 
+            /**
+             * \brief Find a final state of the matrix element
+             *
+             * Resolve the final state once, and use the handle for all the following calls to computeFlat().
+             *
+             * \param pdgIds PDG ids of the final-state particles, in the order expected by the matrix element
+             *
+             * \return A handle on the final state, or -1 if the matrix element does not define it
+             */
+            virtual FinalStateHandle resolveFinalState(const std::vector<int>& pdgIds) {
+                m_final_states.push_back(pdgIds);
+                return m_final_states.size() - 1;
+            }
+
+            /**
+             * \brief Allocation-free version of compute()
+             *
+             * \param handle Final state, as returned by resolveFinalState()
+             * \param initialMomenta 4-momenta \f$(E, p_x, p_y, p_z)\f$ of the two initial partons
+             * \param finalMomenta 4-momenta \f$(E, p_x, p_y, p_z)\f$ of the final-state particles, in the same order as
+             *      given to resolveFinalState()
+             * \param result Filled with the matrix element for each initial state
+             *
+             * The default implementation calls compute(). Matrix elements override it to avoid any allocation.
+             */
+            virtual void computeFlat(FinalStateHandle handle, const double* const initialMomenta[2],
+                    const double* const finalMomenta[], FlatResult& result) {
+                toFlatResult(compute(toInitialState(initialMomenta), toFinalState(handle, finalMomenta)), result);
+            }
+
+            /// Allocation-free version of computeSampledHelicity(), see computeFlat()
+            virtual void computeSampledHelicityFlat(FinalStateHandle handle, const double* const initialMomenta[2],
+                    const double* const finalMomenta[], double random, FlatResult& result) {
+                toFlatResult(computeSampledHelicity(toInitialState(initialMomenta),
+                        toFinalState(handle, finalMomenta), random), result);
+            }
+
+            /**
+             * \brief Evaluate the matrix element for a single helicity combination
+             *
+             * The helicity combination is chosen among the non-vanishing ones using \p random, uniformly
+             * distributed in \f$[0, 1[\f$, and the result is multiplied by the number of non-vanishing combinations.
+             * On average over \p random, this gives the same result as compute(), for a fraction of the cost.
+             *
+             * Combinations are only sampled once the non-vanishing ones are known, so that each combination keeps
+             * the same weight: until a first evaluation has summed over all the combinations, or until they are
+             * restored with setGoodHelicities(), the sum over all the combinations is returned instead.
+             *
+             * The default implementation ignores \p random and sums over all the helicity combinations.
+             */
+            virtual Result computeSampledHelicity(
+                    const std::pair<std::vector<double>, std::vector<double>>& initialMomenta,
+                    const std::vector<std::pair<int, std::vector<double>>>& finalState,
+                    double random
+                    ) {
+                UNUSED(random);
+                return compute(initialMomenta, finalState);
+            }
+
+            /**
+             * \brief Helicity combinations not known to vanish
+             *
+             * Vanishing helicity combinations are discovered by the first evaluation summing over all the
+             * combinations, and skipped afterwards. The table can be given back to setGoodHelicities(), for instance
+             * to reuse it for another event or in another job.
+             *
+             * The default implementation returns an empty table.
+             */
+            virtual HelicityTable getGoodHelicities() const {
+                return {};
+            }
+
+            /**
+             * \brief Restore helicity combinations returned by getGoodHelicities()
+             *
+             * \return false if the table does not match this matrix element, in which case it is ignored
+             */
+            virtual bool setGoodHelicities(const HelicityTable& table) {
+                UNUSED(table);
+                return false;
+            }
+
+            /**
+             * \brief Evaluate the matrix element for several phase-space points at once
+             *
+             * \p initialMomenta and \p finalStates must have the same size, one entry per point.
+             * The default implementation calls compute() for each point; matrix elements able to
+             * vectorize their evaluation across points override it.
+             *
+             * \return The result of each point, in the same order as the inputs
+             */
+            virtual std::vector<Result> computeBatch(
+                    const std::vector<std::pair<std::vector<double>, std::vector<double>>>& initialMomenta,
+                    const std::vector<std::vector<std::pair<int, std::vector<double>>>>& finalStates
+                    ) {
+                std::vector<Result> results;
+                results.reserve(initialMomenta.size());
+                for (std::size_t i = 0; i < initialMomenta.size(); i++)
+                    results.push_back(compute(initialMomenta[i], finalStates.at(i)));
+
+                return results;
+            }
+
             virtual std::shared_ptr<MEParameters> getParameters() = 0;
+
+        protected:
+            static void toFlatResult(const Result& result, FlatResult& flat) {
+                flat.clear();
+                for (const auto& r: result)
+                    flat.push_back(r.first, r.second);
+            }
+
+            static Result toResult(const FlatResult& flat) {
+                Result result;
+                for (std::size_t i = 0; i < flat.size; i++)
+                    result[flat.initialStates[i]] = flat.values[i];
+
+                return result;
+            }
+
+        private:
+            static std::pair<std::vector<double>, std::vector<double>> toInitialState(
+                    const double* const initialMomenta[2]) {
+                return {{initialMomenta[0], initialMomenta[0] + 4}, {initialMomenta[1], initialMomenta[1] + 4}};
+            }
+
+            std::vector<std::pair<int, std::vector<double>>> toFinalState(FinalStateHandle handle,
+                    const double* const finalMomenta[]) const {
+                const auto& pdgIds = m_final_states.at(handle);
+
+                std::vector<std::pair<int, std::vector<double>>> finalState;
+                for (std::size_t i = 0; i < pdgIds.size(); i++)
+                    finalState.emplace_back(pdgIds[i], std::vector<double>(finalMomenta[i], finalMomenta[i] + 4));
+
+                return finalState;
+            }
+
+            // Final states resolved by the default implementation of resolveFinalState()
+            std::vector<std::vector<int>> m_final_states;
     };
 
 }
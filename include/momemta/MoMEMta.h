@@ -19,13 +19,16 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
+#include <momemta/Event.h>
 #include <momemta/Module.h>
 #include <momemta/ParameterSet.h>
 #include <momemta/Particle.h>
 #include <momemta/Pool.h>
+#include <momemta/Profile.h>
 #include <momemta/Types.h>
 
 class Configuration;
@@ -63,6 +66,17 @@ class MoMEMta {
         /// Destructor
         virtual ~MoMEMta();
 
+        /** \brief Create a new instance of MoMEMta, using the same configuration as this one
+         *
+         * The new instance has its own computation graph and memory pool, but the configuration is not parsed again,
+         * and read-only resources loaded by the modules (parameter cards, PDF sets, transfer-function histograms)
+         * are shared with this instance. Creating a clone is thus much cheaper than creating a new instance from the
+         * configuration.
+         *
+         * \return A new, independent instance of MoMEMta
+         */
+        std::unique_ptr<MoMEMta> clone() const;
+
         /** \brief Compute the weights in the current configuration.
          *
          * This function is traditionally called from the main event loop.
@@ -75,6 +89,33 @@ class MoMEMta {
         std::vector<std::pair<double, double>> computeWeights(const std::vector<momemta::Particle>& particles,
                                                               const LorentzVector& met=LorentzVector());
 
+        /** \brief Compute the weights of a set of events in the current configuration, in parallel.
+         *
+         * Events are distributed over \p n_threads threads. Each thread integrates whole events using its own
+         * replica of this instance (computation graph and memory pool); replicas are created on the first call and
+         * re-used by subsequent calls. The threads themselves are started by each call, and joined before it returns.
+         *
+         * Cuba's own fork-based parallelization (`ncores` and `pcores` options) is disabled while integrating the
+         * events.
+         *
+         * The Vegas grids are shared by the whole process: the `grid_number` and `grid_file` cuba options cannot be
+         * used with more than one thread, and an exception is thrown if they are set.
+         *
+         * \param events List of events for which to compute the weights.
+         * \param n_threads Number of threads to use. If 0, use as many threads as hardware threads available.
+         *
+         * \return One vector of weights per event, in the same order as \p events. See computeWeights() for the
+         * content of each vector.
+         *
+         * \warning All the modules, and in particular the matrix elements, must be re-entrant: different instances
+         * are used concurrently from different threads.
+         *
+         * \note After this call, getIntegrationStatus() returns IntegrationStatus::SUCCESS if the integration of
+         * all the events was successful, or the status of the first event whose integration was not.
+         */
+        std::vector<std::vector<std::pair<double, double>>> computeWeightsBatch(
+                const std::vector<momemta::Event>& events, std::size_t n_threads = 0);
+
         /** \brief Set the event particles' momenta
          *
          * In public interface mostly for debugging purposes -- for regular usage see the computeWeights() function.
@@ -83,7 +124,27 @@ class MoMEMta {
          * \param met Missing transverse energy of the event. This parameter is optional.
          */
         void setEvent(const std::vector<momemta::Particle>& particles, const LorentzVector& met=LorentzVector());
-        
+
+        /** \brief Fix the order of the inputs given to setEvent(const LorentzVector*, const int64_t*, const LorentzVector&)
+         *
+         * Input names are resolved once by this call, so that events can then be set from plain arrays without any
+         * string lookup. The binding is kept until the next call.
+         *
+         * \param names Names of all the declared inputs, in the order in which they will be given to setEvent().
+         */
+        void bindInputs(const std::vector<std::string>& names);
+
+        /** \brief Set the event particles' momenta, in the order fixed by bindInputs()
+         *
+         * Same as setEvent(const std::vector<momemta::Particle>&, const LorentzVector&), without any string handling.
+         *
+         * \param p4s 4-momenta of the particles, one per input given to bindInputs(), in the same order.
+         * \param types Types of the particles, in the same order. If null, all the types are set to 0.
+         * \param met Missing transverse energy of the event. This parameter is optional.
+         */
+        void setEvent(const LorentzVector* p4s, const int64_t* types, const LorentzVector& met=LorentzVector());
+
+
         /** \brief Evaluate the integrand on a single phase-space point.
          *
          * Mostly for debugging purposes -- for regular usage see the computeWeights function.
@@ -95,6 +156,19 @@ class MoMEMta {
          * \return The (possibly multi-dimensional) integrand.
          */
         std::vector<double> evaluateIntegrand(const std::vector<double>& psPoints);
+
+        /** \brief Evaluate the integrand on several phase-space points at once.
+         *
+         * Each module is executed for all the points before the next one, as done during the integration when the
+         * `n_vec` cuba option is larger than 1. The results are the same as calling evaluateIntegrand() for each point.
+         *
+         * Warning: return value is undefined until setEvent() has been called.
+         *
+         * \param psPoints Phase-space points the integrand will be computed on, see evaluateIntegrand().
+         *
+         * \return The (possibly multi-dimensional) integrand for each point.
+         */
+        std::vector<std::vector<double>> evaluateIntegrandBatch(const std::vector<std::vector<double>>& psPoints);
         
         /** \brief Return the status of the integration
          *
@@ -111,7 +185,34 @@ class MoMEMta {
          */
         const Pool& getPool() const;
 
+        /** \brief Enable or disable the profiling of the modules
+         *
+         * While enabled, the number of calls to Module::work(), the status they returned and their duration are
+         * recorded for each module, including the modules executed by Loopers. When disabled, nothing is recorded
+         * and the only overhead is a single test for each execution of the computation graph.
+         *
+         * Profiling is enabled from the start if MoMEMta is built with the `DEBUG_TIMING` option.
+         *
+         * \param enabled If true, start recording. If false, stop recording, keeping the statistics collected so far.
+         */
+        void setProfiling(bool enabled);
+
+        /** \brief Return the execution statistics of the modules
+         *
+         * Statistics are accumulated since the creation of this instance, or the last call to resetProfile(). The
+         * statistics of the replicas used by computeWeightsBatch() are included.
+         *
+         * \return The statistics of each module of the computation graph
+         */
+        std::vector<momemta::ModuleProfile> getProfile() const;
+
+        /// Reset the statistics returned by getProfile()
+        void resetProfile();
+
     private:
+        /// Create a clone of \p other. See clone()
+        MoMEMta(const MoMEMta& other);
+
         class integrands_output_error: public std::runtime_error {
             using std::runtime_error::runtime_error;
         };
@@ -146,12 +247,37 @@ class MoMEMta {
          */
         void initPool(const Configuration& configuration);
 
+        /**
+         * Create the modules of the computation graph, and prepare this instance for integration
+         */
+        void initialize();
+
+        /**
+         * \brief Integrate over the phase-space for the current event
+         *
+         * \return A vector of weights. See computeWeights() for the content.
+         */
+        std::vector<std::pair<double, double>> integrate();
+
         int integrand(const double* psPoints, double* results, const double* weights=nullptr);
 
+        /**
+         * \brief Evaluate the integrand for \p n points at once
+         *
+         * \param psPoints Phase-space points, `x[n][m_n_dimensions]`
+         * \param results Filled with the integrands, `f[n][m_n_components]`
+         * \param weights Phase-space weight of each point, if any
+         */
+        int integrandBatch(std::size_t n, const double* psPoints, double* results, const double* weights=nullptr);
+        /// Store point \p i of the batch being evaluated by integrandBatch() into the pool
+        void setBatchPoint(std::size_t i);
+
         static int CUBAIntegrand(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core);
         static int CUBAIntegrandWeighted(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core, const double *weight);
         static void cuba_logging(const char*);
 
+        std::shared_ptr<const Configuration> m_configuration;
+
         PoolPtr m_pool;
         std::shared_ptr<momemta::ComputationGraph> m_computation_graph;
 
@@ -164,12 +290,32 @@ class MoMEMta {
 
         IntegrationStatus integration_status = IntegrationStatus::NONE;
 
+        bool m_profiling = false;
+
         // Pool inputs
         std::shared_ptr<std::vector<double>> m_ps_points;
         std::shared_ptr<double> m_ps_weight;
 
-        std::unordered_map<std::string, std::shared_ptr<LorentzVector>> m_inputs_p4;
-        std::unordered_map<std::string, std::shared_ptr<int64_t>> m_inputs_type;
+        // Batch of points being evaluated by integrandBatch()
+        const double* m_batch_ps_points = nullptr;
+        const double* m_batch_ps_weights = nullptr;
+        std::function<void(std::size_t)> m_set_batch_point;
+        std::vector<Module::Status> m_batch_statuses;
+
+        /// Pool blocks of a declared input
+        struct InputSlot {
+            std::shared_ptr<LorentzVector> p4;
+            std::shared_ptr<int64_t> type;
+        };
+
+        /// Inputs in the order of the configuration, and the index of each of them
+        std::vector<InputSlot> m_inputs;
+        std::unordered_map<std::string, std::size_t> m_inputs_index;
+        /// Inputs in the order fixed by bindInputs()
+        std::vector<InputSlot> m_bound_inputs;
         std::shared_ptr<LorentzVector> m_met;
         std::vector<Value<double>> m_integrands;
+
+        /// Replicas of this instance used by computeWeightsBatch(), one for each additional thread
+        std::vector<std::unique_ptr<MoMEMta>> m_workers;
 };
@@ -96,6 +96,60 @@ class Module {
          */
         virtual Status work() { return Status::OK; };
 
+        /**
+         * \brief A batch of phase-space points, executed by work_batch()
+         *
+         * When the computation graph is executed for a batch of points, each module is executed for all the points
+         * of the batch before the next module. The inputs and outputs of the module only hold the values of a single
+         * point at a time: load() makes the inputs of the module available for a given point, and store() saves its
+         * outputs for this point.
+         */
+        class Batch {
+            public:
+                virtual ~Batch() = default;
+
+                /// \return The number of points of the batch
+                virtual std::size_t size() const = 0;
+
+                /**
+                 * \brief Status of the evaluation of point \p i
+                 *
+                 * Points for which a module did not return Status::OK must be skipped: the following modules are
+                 * not executed for them.
+                 */
+                virtual Status& status(std::size_t i) = 0;
+
+                /// Set the inputs of the module to the values of point \p i. Module::beginPoint() is called if needed.
+                virtual void load(std::size_t i) = 0;
+
+                /// Save the outputs of the module for point \p i. Module::endPoint() is called if needed.
+                virtual void store(std::size_t i) = 0;
+        };
+
+        /**
+         * \brief Batched version of work()
+         *
+         * This method is called instead of work() when the phase-space points are evaluated in batches (see the
+         * `n_vec` cuba option). The default implementation calls work() for each point of the batch.
+         *
+         * Override this function if the evaluation of several points at once can be made faster than evaluating them
+         * one by one, for instance using SIMD instructions: load the inputs of each point, evaluate all the points
+         * at once, and store the outputs of each point. The status of each point must be updated.
+         *
+         * \note Modules inside the path of a Looper are executed one point at a time by the Looper, using work():
+         * this function is only called for modules at the top level of the computation graph.
+         */
+        virtual void work_batch(Batch& batch) {
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                if (batch.status(i) != Status::OK)
+                    continue;
+
+                batch.load(i);
+                batch.status(i) = work();
+                batch.store(i);
+            }
+        }
+
         /**
          * \brief Called once at the end of a loop
          *
@@ -55,6 +55,16 @@ struct ArgDef {
     std::vector<AttrDef> nested_attributes;
 };
 
+/// Optional hooks of a module, called around each point or loop. Used as a bit mask in ModuleDef::hooks
+enum ModuleHook: unsigned int {
+    HOOK_NONE = 0,
+    HOOK_BEGIN_POINT = 1 << 0, ///< Module::beginPoint()
+    HOOK_BEGIN_LOOP = 1 << 1, ///< Module::beginLoop()
+    HOOK_END_LOOP = 1 << 2, ///< Module::endLoop()
+    HOOK_END_POINT = 1 << 3, ///< Module::endPoint()
+    HOOK_ALL = HOOK_BEGIN_POINT | HOOK_BEGIN_LOOP | HOOK_END_LOOP | HOOK_END_POINT
+};
+
 /**
  * Defines a module, listing its attributes, inputs and outputs
  */
@@ -70,6 +80,19 @@ struct ModuleDef {
 
     /// A sticky module is a module which can't be removed from the graph, even if it's output is not used
     bool sticky = false;
+
+    /// A filter may stop the execution of the current point, or solution, by returning Module::Status::NEXT
+    bool filter = false;
+
+    /// Relative cost of one execution of this module, a simple module having a cost of 1
+    double cost = 1;
+
+    /**
+     * Hooks called around each point or loop implemented by the module (see ModuleHook). A module implementing any of
+     * them usually keeps a state between two calls to Module::work(), and must be executed exactly as often as
+     * configured.
+     */
+    unsigned int hooks = HOOK_NONE;
 };
 
 using ModuleList = std::vector<ModuleDef>;
@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <momemta/ModuleDef.h>
@@ -49,9 +50,21 @@ class ModuleDefBuilder {
 public:
     explicit ModuleDefBuilder(const std::string& name);
 
+    /// Inspect the implementation of the module, and record which per-point or per-loop hooks it overrides
     template <typename ModuleType>
     ModuleDefBuilder& Type() {
-        // Currently not used
+        // `&ModuleType::hook` is a pointer to a member of Module, unless ModuleType (or one of its bases) overrides it
+        typedef void (Module::*Hook)();
+        auto& hooks = reg_data.module_def.hooks;
+        hooks = HOOK_NONE;
+        if (!std::is_same<decltype(&ModuleType::beginPoint), Hook>::value)
+            hooks |= HOOK_BEGIN_POINT;
+        if (!std::is_same<decltype(&ModuleType::beginLoop), Hook>::value)
+            hooks |= HOOK_BEGIN_LOOP;
+        if (!std::is_same<decltype(&ModuleType::endLoop), Hook>::value)
+            hooks |= HOOK_END_LOOP;
+        if (!std::is_same<decltype(&ModuleType::endPoint), Hook>::value)
+            hooks |= HOOK_END_POINT;
         return *this;
     }
 
@@ -130,6 +143,23 @@ public:
      */
     ModuleDefBuilder& Sticky();
 
+    /**
+     * \brief Flag this module as a filter
+     *
+     * A filter is a module which may stop the execution of the current point, or solution, by returning
+     * Module::Status::NEXT (for instance a Block without any solution). Filters are executed as early as possible,
+     * so that the modules not needed by them are not executed when the point is rejected.
+     */
+    ModuleDefBuilder& Filter();
+
+    /**
+     * \brief Set the relative cost of one execution of this module
+     *
+     * A simple module has a cost of 1. The cost is used to decide which filter to execute first: the one needing the
+     * cheapest set of modules is executed first.
+     */
+    ModuleDefBuilder& Cost(double cost);
+
     ModuleRegistrationData Build() const;
 
     std::string name() const;
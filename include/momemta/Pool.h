@@ -21,25 +21,117 @@
 
 #include <assert.h>
 #include <memory>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include <momemta/any.h>
 #include <momemta/impl/InputTag_fwd.h>
+#include <momemta/impl/PoolArena.h>
 #include <momemta/Value.h>
 
 // A simple memory pool
 
+class Pool;
+
+namespace momemta {
+
+/**
+ * \brief Type-erased operations on the content of a memory block, see BlockCopies
+ *
+ * Operations are null if the type of the block cannot be copied.
+ */
+struct BlockOps {
+    /// Address of the content of a block, from the momemta::any holding it
+    void* (*data)(const momemta::any& block);
+    /// Allocate a copy of a content
+    std::shared_ptr<void> (*clone)(const void* from);
+    /// Copy a content into another one
+    void (*assign)(const void* from, void* to);
+
+    template <typename T> static const BlockOps* get() {
+        static const BlockOps ops = make<T>(std::is_copy_assignable<T>());
+        return &ops;
+    }
+
+private:
+    template <typename T> static BlockOps make(std::true_type) {
+        return {
+            [](const momemta::any& block) -> void* {
+                return momemta::any_cast<const std::shared_ptr<T>&>(block).get();
+            },
+            [](const void* from) -> std::shared_ptr<void> {
+                return std::make_shared<T>(*static_cast<const T*>(from));
+            },
+            [](const void* from, void* to) {
+                *static_cast<T*>(to) = *static_cast<const T*>(from);
+            }
+        };
+    }
+
+    template <typename T> static BlockOps make(std::false_type) {
+        return { nullptr, nullptr, nullptr };
+    }
+};
+
+/**
+ * \brief Copies of the content of a memory block, one per phase-space point of a batch
+ *
+ * When the modules are executed for a batch of points (see Module::work_batch()), the outputs of a module are saved
+ * after its execution for each point, and restored before executing the modules using them for the same point.
+ *
+ * Use Pool::copies() to create an instance.
+ */
+class BlockCopies {
+public:
+    /// Make sure a copy exists for each of the first \p n points. Memory is only allocated the first time.
+    void reserve(std::size_t n) {
+        while (m_copies.size() < n)
+            m_copies.push_back(m_ops->clone(m_data));
+    }
+
+    /// Save the current content of the block as the one of point \p i
+    void save(std::size_t i) {
+        m_ops->assign(m_data, m_copies[i].get());
+    }
+
+    /// Restore the content of the block saved for point \p i
+    void restore(std::size_t i) {
+        m_ops->assign(m_copies[i].get(), m_data);
+    }
+
+private:
+    friend class ::Pool;
+
+    BlockCopies(const momemta::any& block, const BlockOps* ops):
+            m_block(block), m_ops(ops), m_data(ops->data(block)) {}
+
+    momemta::any m_block; ///< Keeps the memory block alive
+    const BlockOps* m_ops;
+    void* m_data;
+    std::vector<std::shared_ptr<void>> m_copies;
+};
+
+}
+
 /**
  * A simple container for the memory block inside the global memory pool
  */
 struct PoolContent {
     momemta::any ptr; /// Pointer to the memory allocated for this block
     bool valid; /// The state of the memory block. If false, it means that a module requested this block in read-mode, but no module actually provides the block.
+    const momemta::BlockOps* ops; /// Operations on the content of the block, null if the block is not allocated yet
 };
 
+/**
+ * \brief The memory pool shared by all the modules
+ *
+ * All the blocks are allocated in a momemta::PoolArena, and never move afterwards: a Value reads its block directly,
+ * without going through the pool.
+ */
 class Pool {
     public:
-        Pool() = default;
+        Pool(): m_arena(std::make_shared<momemta::PoolArena>()) {}
 
         /**
          * \brief Allocate a new block in the memory pool.
@@ -64,13 +156,20 @@ class Pool {
          */
         bool exists(const InputTag& tag) const;
 
+        /**
+         * \brief Create per-point copies of a memory block
+         *
+         * \param tag The input tag describing the memory block. The index of the tag, if any, is ignored: the whole
+         *      block is copied.
+         *
+         * \return An empty set of copies of the block. Use BlockCopies::reserve() to allocate them.
+         */
+        momemta::BlockCopies copies(const InputTag& tag) const;
+
     private:
         friend class MoMEMta;
         friend class Module;
 
-        template <typename U>
-        friend class ValueProxy;
-
         using PoolStorage = std::unordered_map<InputTag, PoolContent>;
 
         friend struct InputTag;
@@ -82,6 +181,9 @@ class Pool {
 
         template<typename T> std::shared_ptr<const T> raw_get(const InputTag& tag) const;
 
+        /// Allocate a new block in the arena
+        template<typename T, typename... Args> std::shared_ptr<T> allocate(Args&&... args) const;
+
         template<typename T, typename... Args> PoolStorage::iterator create(const InputTag& tag,
                 bool valid, Args&&... args) const;
 
@@ -116,6 +218,7 @@ private:
         bool m_frozen = false; /// If true, no modification of the pool is allowed
 
         mutable PoolStorage m_storage;
+        std::shared_ptr<momemta::PoolArena> m_arena; /// Memory of all the blocks
 };
 
 using PoolPtr = std::shared_ptr<Pool>;
@@ -0,0 +1,47 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace momemta {
+
+/**
+ * \brief Execution statistics of a module, collected when profiling is enabled (see MoMEMta::setProfiling())
+ *
+ * Only the calls to Module::work() are recorded. Times are in seconds. The time of a Looper includes the time of the
+ * modules of its execution path, which also have their own statistics.
+ */
+struct ModuleProfile {
+    std::string name; ///< Name of the module
+    std::string type; ///< Type of the module
+
+    std::size_t calls = 0; ///< Number of calls
+    std::size_t ok = 0; ///< Number of calls returning Module::Status::OK
+    std::size_t next = 0; ///< Number of calls returning Module::Status::NEXT
+    std::size_t abort = 0; ///< Number of calls returning Module::Status::ABORT
+
+    double total_time = 0; ///< Time spent in all the calls
+    double median_time = 0; ///< Median time of a call, estimated within 12.5%
+    double p90_time = 0; ///< 90th percentile of the time of a call, estimated within 12.5%
+    double p99_time = 0; ///< 99th percentile of the time of a call, estimated within 12.5%
+};
+
+}
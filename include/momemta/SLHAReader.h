@@ -37,6 +37,8 @@ class Reader {
     void set_block_entry(const std::string& block_name, int index, double value);
 
   private:
+    void parse_slha_file(const std::string& file_name);
+
     std::map<std::string, Block> _blocks;
 };
 }
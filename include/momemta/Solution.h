@@ -20,13 +20,82 @@
 
 #include <momemta/Types.h>
 
+#include <array>
+#include <cstddef>
+#include <initializer_list>
 #include <ostream>
+#include <stdexcept>
 #include <vector>
 
+/** \brief Particles of a Solution, stored inline
+ *
+ * Behaves like a `std::vector<LorentzVector>` with a fixed capacity of #MAX_SIZE particles, so that creating a
+ * solution never allocates memory.
+ */
+class SolutionValues {
+public:
+    /// Maximum number of particles in a solution
+    static constexpr std::size_t MAX_SIZE = 4;
+
+    using value_type = LorentzVector;
+    using iterator = LorentzVector*;
+    using const_iterator = const LorentzVector*;
+
+    SolutionValues() = default;
+
+    SolutionValues(std::initializer_list<LorentzVector> values) {
+        for (const auto& value: values)
+            push_back(value);
+    }
+
+    void push_back(const LorentzVector& value) {
+        if (m_size == MAX_SIZE)
+            throw std::length_error("Too many particles in solution");
+
+        m_values[m_size++] = value;
+    }
+
+    void clear() {
+        m_size = 0;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    LorentzVector& operator[](std::size_t index) {
+        return m_values[index];
+    }
+
+    const LorentzVector& operator[](std::size_t index) const {
+        return m_values[index];
+    }
+
+    const LorentzVector& at(std::size_t index) const {
+        if (index >= m_size)
+            throw std::out_of_range("Invalid particle index in solution");
+
+        return m_values[index];
+    }
+
+    iterator begin() { return m_values.data(); }
+    iterator end() { return m_values.data() + m_size; }
+    const_iterator begin() const { return m_values.data(); }
+    const_iterator end() const { return m_values.data() + m_size; }
+
+private:
+    std::array<LorentzVector, MAX_SIZE> m_values;
+    std::size_t m_size = 0;
+};
+
 /** \brief Generic solution structure representing a set of particles, along with its jacobian
  */
 struct Solution {
-    std::vector<LorentzVector> values; ///< Values
+    SolutionValues values; ///< Values
     double jacobian; ///< Jacobian associated with the solution
     mutable bool valid; ///< Is the solution valid?
 
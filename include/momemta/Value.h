@@ -18,13 +18,22 @@
 
 #pragma once
 
-#include <momemta/impl/ValueProxy_fwd.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class Pool;
 
 /**
  * \brief A class representing a value produced by a module
  *
  * This class act as a proxy between the user and the value, providing a unique interface
  * to access values produced by a module, indexed or not.
+ *
+ * Memory blocks never move once allocated by the Pool, so the address of the value is resolved
+ * once, when the Value is created. Accessing a non-indexed value is a single pointer dereference.
+ * An indexed value goes through the vector holding it, since the vector may be resized by the module
+ * producing it.
  */
 template <typename T>
 class Value {
@@ -35,33 +44,30 @@ public:
     Value(Value&&) = default;
     Value<T>& operator=(const Value<T>&) = default;
 
-    const T& operator*() {
-        return proxy->operator*();
-    }
-
     const T& operator*() const {
-        return proxy->operator*();
-    }
-
-    const T* operator->() {
-        return proxy->operator->();
+        return *get();
     }
 
     const T* operator->() const {
-        return proxy->operator->();
+        return get();
     }
 
-    const T* get() {
-        return proxy->get();
+    const T* get() const {
+        return m_vector ? &(*m_vector)[m_index] : m_value;
     }
 
 private:
     friend class Pool;
 
     // Only Pool can create a Value
-    Value(std::shared_ptr<ValueProxy<const T>> impl) {
-        proxy = impl;
-    }
+    Value(std::shared_ptr<const void> block, const T* value):
+        m_block(std::move(block)), m_value(value) {}
+
+    Value(std::shared_ptr<const void> block, const std::vector<T>* vector, std::size_t index):
+        m_block(std::move(block)), m_vector(vector), m_index(index) {}
 
-    std::shared_ptr<ValueProxy<const T>> proxy;
-};
\ No newline at end of file
+    std::shared_ptr<const void> m_block; /// Keeps the memory block alive
+    const T* m_value = nullptr;
+    const std::vector<T>* m_vector = nullptr;
+    std::size_t m_index = 0;
+};
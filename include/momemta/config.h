@@ -0,0 +1,3 @@
+// This file is auto-generated by CMake. Do not edit
+
+/* #undef DEBUG_TIMING */
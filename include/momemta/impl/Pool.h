@@ -29,7 +29,6 @@
 #include <momemta/Logging.h>
 #include <momemta/Utils.h>
 #include <momemta/Value.h>
-#include <momemta/impl/ValueProxy.h>
 
 // A simple memory pool
 
@@ -44,9 +43,13 @@ template <typename T> Value<T> Pool::get(const InputTag& tag) const {
         }
     }
 
-    Value<T> value(ValueProxy<const T>::create(this, tag));
+    if (tag.isIndexed()) {
+        auto block = raw_get<std::vector<T>>(tag);
+        return Value<T>(block, block.get(), tag.index);
+    }
 
-    return value;
+    auto block = raw_get<T>(tag);
+    return Value<T>(block, block.get());
 }
 
 template <typename T> std::shared_ptr<const T> Pool::raw_get(const InputTag& tag) const {
@@ -86,8 +89,9 @@ template <typename T, typename... Args> std::shared_ptr<T> Pool::put(const Input
 
         // If the block is empty, it's a delayed instantiation. Simply flag the block as valid, and allocate memory for it
         if (it->second.ptr.empty()) {
-            auto ptr = std::make_shared<T>(std::forward<Args>(args)...);
+            auto ptr = allocate<T>(std::forward<Args>(args)...);
             it->second.ptr = momemta::any(ptr);
+            it->second.ops = momemta::BlockOps::get<T>();
         }
 
     } else {
@@ -100,8 +104,12 @@ template <typename T, typename... Args> std::shared_ptr<T> Pool::put(const Input
 template <typename T, typename... Args> Pool::PoolStorage::iterator Pool::create(
         const InputTag& tag, bool valid/* = true*/, Args&&... args) const {
 
-    auto ptr = std::make_shared<T>(std::forward<Args>(args)...);
-    PoolContent content = {momemta::any(ptr), valid};
+    auto ptr = allocate<T>(std::forward<Args>(args)...);
+    PoolContent content = {momemta::any(ptr), valid, momemta::BlockOps::get<T>()};
 
     return m_storage.emplace(tag, content).first;
 }
+
+template <typename T, typename... Args> std::shared_ptr<T> Pool::allocate(Args&&... args) const {
+    return std::allocate_shared<T>(momemta::PoolAllocator<T>(m_arena), std::forward<Args>(args)...);
+}
@@ -0,0 +1,121 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace momemta {
+
+/**
+ * \brief Contiguous storage for the blocks of a memory pool
+ *
+ * Memory is handed out from large chunks, each allocation starting on a new cache line. Blocks produced by modules
+ * running one after the other thus end up next to each other in memory, instead of being scattered over the heap.
+ *
+ * Individual allocations are never released: the memory is freed all at once when the arena is destroyed. This
+ * is fine for a Pool, whose blocks all live as long as the computation graph.
+ */
+class PoolArena {
+public:
+    /// Size of a cache line. Every allocation is aligned on, and padded to, a multiple of this size.
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    /// Default size of the chunks of memory
+    static constexpr std::size_t CHUNK_SIZE = 16 * 1024;
+
+    PoolArena() = default;
+    PoolArena(const PoolArena&) = delete;
+    PoolArena& operator=(const PoolArena&) = delete;
+
+    void* allocate(std::size_t size) {
+        size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+        if (size > m_remaining) {
+            std::size_t chunk_size = (size > CHUNK_SIZE) ? size : CHUNK_SIZE;
+
+            // Over-allocate to be able to align the start of the chunk
+            std::unique_ptr<char[]> chunk(new char[chunk_size + ALIGNMENT]);
+            std::uintptr_t address = reinterpret_cast<std::uintptr_t>(chunk.get());
+            std::uintptr_t aligned = (address + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+            m_current = chunk.get() + (aligned - address);
+            m_remaining = chunk_size;
+            m_chunks.push_back(std::move(chunk));
+        }
+
+        void* result = m_current;
+        m_current += size;
+        m_remaining -= size;
+
+        return result;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_current = nullptr;
+    std::size_t m_remaining = 0;
+};
+
+/**
+ * \brief Allocator handing out memory from a PoolArena
+ *
+ * Used with `std::allocate_shared`, both the block and its reference counts are stored in the arena. Each allocator
+ * keeps the arena alive, so that blocks outliving the Pool remain valid.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator(std::shared_ptr<PoolArena> arena): m_arena(std::move(arena)) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other): m_arena(other.m_arena) {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= PoolArena::ALIGNMENT, "Type is over-aligned for the pool arena");
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T*, std::size_t) {
+        // Memory is released with the arena
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const {
+        return m_arena == other.m_arena;
+    }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const {
+        return m_arena != other.m_arena;
+    }
+
+private:
+    template <typename U>
+    friend class PoolAllocator;
+
+    std::shared_ptr<PoolArena> m_arena;
+};
+
+}
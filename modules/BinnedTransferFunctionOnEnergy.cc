@@ -23,6 +23,9 @@
 #include <momemta/Math.h>
 
 
+#include <FourVector.h>
+#include <SharedResources.h>
+
 #include <TFile.h>
 #include <TH2.h>
 #include <TAxis.h>
@@ -40,25 +43,33 @@ class BinnedTransferFunctionOnEnergyBase: public Module {
 
         BinnedTransferFunctionOnEnergyBase(PoolPtr pool, const ParameterSet& parameters): Module(pool, parameters.getModuleName()) {
             m_reco_input = get<LorentzVector>(parameters.get<InputTag>("reco_particle"));
+            m_reco = momemta::CachedKinematics(m_reco_input);
 
             std::string file_path = parameters.get<std::string>("file");
             std::string th2_name = parameters.get<std::string>("th2_name");
 
-            std::unique_ptr<TFile> file(TFile::Open(file_path.c_str()));
-            if(!file->IsOpen() || file->IsZombie())
-                throw file_not_found_error("Could not open file " + file_path);
+            // The histogram is only read: share it between all the instances using the same one
+            m_th2 = momemta::SharedResources<TH2>::get(file_path + ":" + th2_name, [&file_path, &th2_name]() {
+                std::unique_ptr<TFile> file(TFile::Open(file_path.c_str()));
+                if(!file->IsOpen() || file->IsZombie())
+                    throw file_not_found_error("Could not open file " + file_path);
+
+                std::shared_ptr<TH2> th2(static_cast<TH2*>(file->Get(th2_name.c_str())));
+                if(!th2->InheritsFrom("TH2") || !th2.get())
+                    throw th2_not_found_error("Could not retrieve object " + th2_name + " deriving from class TH2 in file " + file_path + ".");
+                th2->SetDirectory(0);
+
+                file->Close();
 
-            m_th2 = std::unique_ptr<TH2>(static_cast<TH2*>(file->Get(th2_name.c_str())));
-            if(!m_th2->InheritsFrom("TH2") || !m_th2.get())
-                throw th2_not_found_error("Could not retrieve object " + th2_name + " deriving from class TH2 in file " + file_path + ".");
-            m_th2->SetDirectory(0);
+                return th2;
+            });
 
-            TAxis* yAxis = m_th2->GetYaxis();
+            const TAxis* yAxis = m_th2->GetYaxis();
             m_deltaMin = yAxis->GetXmin();
             m_deltaMax = yAxis->GetXmax();
             m_deltaRange = m_deltaMax - m_deltaMin;
 
-            TAxis* xAxis = m_th2->GetXaxis();
+            const TAxis* xAxis = m_th2->GetXaxis();
             double E_cut = parameters.get<double>("min_E", 0.);
             m_EgenMin = std::max(xAxis->GetXmin(), E_cut);
             m_EgenMax = xAxis->GetXmax();
@@ -72,13 +83,10 @@ class BinnedTransferFunctionOnEnergyBase: public Module {
             LOG(debug) << "\tDelta range is " << m_deltaMin << " to " << m_deltaMax << ".";
             LOG(debug) << "\tEnergy range is " << m_EgenMin << " to " << m_EgenMax << ".";
             LOG(debug) << "\tWill use values at Egen = " << m_fallBackEgenMax << " for out-of-range values.";
-
-            file->Close();
-            file.reset();
         };
 
     protected:
-        std::unique_ptr<TH2> m_th2;
+        std::shared_ptr<const TH2> m_th2;
 
         double m_deltaMin, m_deltaMax, m_deltaRange;
         double m_EgenMin, m_EgenMax;
@@ -86,6 +94,7 @@ class BinnedTransferFunctionOnEnergyBase: public Module {
 
         // Input
         Value<LorentzVector> m_reco_input;
+        momemta::CachedKinematics m_reco;
 
     private:
         class file_not_found_error: public std::runtime_error{
@@ -148,19 +157,21 @@ class BinnedTransferFunctionOnEnergy: public BinnedTransferFunctionOnEnergyBase
         }
 
         virtual Status work() override {
-            const double rec_E = m_reco_input->E();
-            const double rec_M = m_reco_input->M();
+            const momemta::Kinematics& reco = m_reco.get();
+
+            const double rec_E = reco.E;
+            const double rec_M = reco.M;
             const double range = GetDeltaRange(rec_E, rec_M);
             const double gen_E = rec_E - GetDeltaMax(rec_E, rec_M) + range * (*m_ps_point);
             const double delta = rec_E - gen_E;
 
             // To change the particle's energy without changing its direction and mass
             // Forcing positive value of (gen_E - rec_M) due to numeric precision issue
-            double gen_pt = std::sqrt(std::max(gen_E - rec_M, 0.) * (gen_E + rec_M)) / std::cosh(m_reco_input->Eta());
+            double gen_pt = std::sqrt(std::max(gen_E - rec_M, 0.) * (gen_E + rec_M)) / reco.cosh_eta;
             output->SetCoordinates(
-                    gen_pt * std::cos(m_reco_input->Phi()),
-                    gen_pt * std::sin(m_reco_input->Phi()),
-                    gen_pt * std::sinh(m_reco_input->Eta()),
+                    gen_pt * reco.cos_phi,
+                    gen_pt * reco.sin_phi,
+                    gen_pt * reco.sinh_eta,
                     gen_E);
 
             // The bin number is a ROOT "global bin number" using a 1D representation of the TH2
@@ -274,7 +285,8 @@ REGISTER_MODULE(BinnedTransferFunctionOnEnergy)
         .Output("TF_times_jacobian")
         .Attr("file:string")
         .Attr("th2_name:string")
-        .Attr("min_E:double=0");
+        .Attr("min_E:double=0")
+        .Cost(2);
 
 REGISTER_MODULE(BinnedTransferFunctionOnEnergyEvaluator)
         .Input("reco_particle")
@@ -282,4 +294,5 @@ REGISTER_MODULE(BinnedTransferFunctionOnEnergyEvaluator)
         .Output("TF")
         .Attr("file:string")
         .Attr("th2_name:string")
-        .Attr("min_E:double=0");
+        .Attr("min_E:double=0")
+        .Cost(2);
@@ -22,6 +22,9 @@
 #include <momemta/Types.h>
 #include <momemta/Math.h>
 
+#include <FourVector.h>
+#include <SharedResources.h>
+
 #include <TFile.h>
 #include <TH2.h>
 #include <TAxis.h>
@@ -39,25 +42,33 @@ class BinnedTransferFunctionOnPtBase: public Module {
 
         BinnedTransferFunctionOnPtBase(PoolPtr pool, const ParameterSet& parameters): Module(pool, parameters.getModuleName()) {
             m_reco_input = get<LorentzVector>(parameters.get<InputTag>("reco_particle"));
+            m_reco = momemta::CachedKinematics(m_reco_input);
 
             std::string file_path = parameters.get<std::string>("file");
             std::string th2_name = parameters.get<std::string>("th2_name");
 
-            std::unique_ptr<TFile> file(TFile::Open(file_path.c_str()));
-            if(!file->IsOpen() || file->IsZombie())
-                throw file_not_found_error("Could not open file " + file_path);
+            // The histogram is only read: share it between all the instances using the same one
+            m_th2 = momemta::SharedResources<TH2>::get(file_path + ":" + th2_name, [&file_path, &th2_name]() {
+                std::unique_ptr<TFile> file(TFile::Open(file_path.c_str()));
+                if(!file->IsOpen() || file->IsZombie())
+                    throw file_not_found_error("Could not open file " + file_path);
+
+                std::shared_ptr<TH2> th2(static_cast<TH2*>(file->Get(th2_name.c_str())));
+                if(!th2->InheritsFrom("TH2") || !th2.get())
+                    throw th2_not_found_error("Could not retrieve object " + th2_name + " deriving from class TH2 in file " + file_path + ".");
+                th2->SetDirectory(0);
+
+                file->Close();
 
-            m_th2 = std::unique_ptr<TH2>(static_cast<TH2*>(file->Get(th2_name.c_str())));
-            if(!m_th2->InheritsFrom("TH2") || !m_th2.get())
-                throw th2_not_found_error("Could not retrieve object " + th2_name + " deriving from class TH2 in file " + file_path + ".");
-            m_th2->SetDirectory(0);
+                return th2;
+            });
 
-            TAxis* yAxis = m_th2->GetYaxis();
+            const TAxis* yAxis = m_th2->GetYaxis();
             m_deltaMin = yAxis->GetXmin();
             m_deltaMax = yAxis->GetXmax();
             m_deltaRange = m_deltaMax - m_deltaMin;
 
-            TAxis* xAxis = m_th2->GetXaxis();
+            const TAxis* xAxis = m_th2->GetXaxis();
             double Pt_cut = parameters.get<double>("min_Pt", 0.);
             m_PtgenMin = std::max(xAxis->GetXmin(), Pt_cut);
             m_PtgenMax = xAxis->GetXmax();
@@ -71,13 +82,10 @@ class BinnedTransferFunctionOnPtBase: public Module {
             LOG(debug) << "\tDelta range is " << m_deltaMin << " to " << m_deltaMax << ".";
             LOG(debug) << "\tPt range is " << m_PtgenMin << " to " << m_PtgenMax << ".";
             LOG(debug) << "\tWill use values at Ptgen = " << m_fallBackPtgenMax << " for out-of-range values.";
-
-            file->Close();
-            file.reset();
         };
 
     protected:
-        std::unique_ptr<TH2> m_th2;
+        std::shared_ptr<const TH2> m_th2;
 
         double m_deltaMin, m_deltaMax, m_deltaRange;
         double m_PtgenMin, m_PtgenMax;
@@ -85,6 +93,7 @@ class BinnedTransferFunctionOnPtBase: public Module {
 
         // Input
         Value<LorentzVector> m_reco_input;
+        momemta::CachedKinematics m_reco;
 
     private:
         class file_not_found_error: public std::runtime_error{
@@ -147,18 +156,20 @@ class BinnedTransferFunctionOnPt: public BinnedTransferFunctionOnPtBase {
         }
 
         virtual Status work() override {
-            const double rec_Pt = m_reco_input->Pt();
-            const double cosh_eta = std::cosh(m_reco_input->Eta());
+            const momemta::Kinematics& reco = m_reco.get();
+
+            const double rec_Pt = reco.Pt;
+            const double cosh_eta = reco.cosh_eta;
             const double range = GetDeltaRange(rec_Pt);
             const double gen_Pt = rec_Pt - GetDeltaMax(rec_Pt) + range * (*m_ps_point);
             const double delta = rec_Pt - gen_Pt;
 
             // To change the particle's Pt without changing its direction and mass:
-            const double gen_E = std::sqrt(SQ(m_reco_input->M()) + SQ(cosh_eta * gen_Pt));
+            const double gen_E = std::sqrt(SQ(reco.M) + SQ(cosh_eta * gen_Pt));
             output->SetCoordinates(
-                    gen_Pt * std::cos(m_reco_input->Phi()),
-                    gen_Pt * std::sin(m_reco_input->Phi()),
-                    gen_Pt * std::sinh(m_reco_input->Eta()),
+                    gen_Pt * reco.cos_phi,
+                    gen_Pt * reco.sin_phi,
+                    gen_Pt * reco.sinh_eta,
                     gen_E);
 
             // The bin number is a ROOT "global bin number" using a 1D representation of the TH2
@@ -269,7 +280,8 @@ REGISTER_MODULE(BinnedTransferFunctionOnPt)
         .Output("TF_times_jacobian")
         .Attr("file:string")
         .Attr("th2_name:string")
-        .Attr("min_Pt:double=0");
+        .Attr("min_Pt:double=0")
+        .Cost(2);
 
 REGISTER_MODULE(BinnedTransferFunctionOnPtEvaluator)
         .Input("reco_particle")
@@ -277,4 +289,5 @@ REGISTER_MODULE(BinnedTransferFunctionOnPtEvaluator)
         .Output("TF")
         .Attr("file:string")
         .Attr("th2_name:string")
-        .Attr("min_Pt:double=0");
+        .Attr("min_Pt:double=0")
+        .Cost(2);
@@ -27,6 +27,8 @@
 
 #include <stdexcept>
 
+#include <InputsWatcher.h>
+
 /** \brief Final (main) Block A, describing \f$q_1 q_2 \to p_1 + p_2 + X\f$
  *
  * \f$q_1\f$ and \f$q_2\f$ are Bjorken fractions, \f$p_1\f$ and \f$p_2\f$ are the 4-momenta of the visible
@@ -93,9 +95,23 @@ class BlockA: public Module {
                 LOG(fatal) << exception.what();
                 throw exception;
             }
+
+            m_inputs.watch(p1);
+            m_inputs.watch(p2);
+            m_inputs.watch(m_branches);
         };
 
         virtual Status work() override {
+            // The solutions only depend on the visible particles: solve the equations again only when they change,
+            // usually once per event
+            if (m_inputs.changed())
+                m_status = solve();
+
+            return m_status;
+        }
+
+    private:
+        Status solve() {
 
             solutions->clear();
 
@@ -120,8 +136,8 @@ class BlockA: public Module {
             //        p2x=modp2*sin(theta2)*cos(phi2), p2y=modp2*sin(theta2)*sin(phi2)
             // Get modp1, modp2 as solutions of this system
 
-            std::vector<double> modp1;
-            std::vector<double> modp2;
+            FixedRoots<1> modp1;
+            FixedRoots<1> modp2;
 
             const double sin_theta1 = std::sin(theta1);
             const double cos_phi1 = std::cos(phi1);
@@ -139,7 +155,7 @@ class BlockA: public Module {
             const double b01 = sin_theta2 * sin_phi2;
             const double b00 = pby;
 
-            bool foundSolution = solve2Linear(a10, a01, a00, b10, b01, b00, modp1, modp2, false);
+            bool foundSolution = solve2Linear(a10, a01, a00, b10, b01, b00, modp1, modp2);
 
             if (!foundSolution)
                return Status::NEXT;
@@ -179,13 +195,15 @@ class BlockA: public Module {
             return Status::OK;
         }
 
-
-    private:
         double sqrt_s;
 
         // Inputs
         Value<LorentzVector> p1, p2;
         std::vector<Value<LorentzVector>> m_branches;
+
+        momemta::InputsWatcher m_inputs;
+        Status m_status;
+
         // Outputs
         std::shared_ptr<SolutionCollection> solutions = produce<SolutionCollection>("solutions");
 };
@@ -195,4 +213,5 @@ REGISTER_MODULE(BlockA)
     .Input("p2")
     .OptionalInputs("branches")
     .Output("solutions")
-    .GlobalAttr("energy:double");
\ No newline at end of file
+    .GlobalAttr("energy:double")
+    .Filter();
\ No newline at end of file
@@ -154,9 +154,10 @@ class BlockB: public Module {
             const double b = - 2 * A * B;
             const double c = C - SQ(A) - p11;
 
-            std::vector<double> E1;
+            QuadraticRoots E1;
 
-            solveQuadratic(a, b, c, E1, false);
+            solveQuadratic(a, b, c, E1);
+            removeDuplicateRoots(E1);
 
             if (E1.size() == 0)
                 return Status::NEXT;
@@ -225,4 +226,5 @@ REGISTER_MODULE(BlockB)
         .Output("solutions")
         .GlobalAttr("energy:double")
         .Attr("pT_is_met:bool=false")
-        .Attr("m1:double=0.");
+        .Attr("m1:double=0.")
+        .Filter();
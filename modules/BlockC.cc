@@ -22,6 +22,8 @@
 #include <momemta/Solution.h>
 #include <momemta/Types.h>
 
+#include <InputsWatcher.h>
+
 /** \brief \f$\require{cancel}\f$ Final (main) Block C, describing \f$s_{123} (\to p_3 + s_{12} (\to \cancel{p_1} p_2))\f$
  *
  * This Block addresses the change of variables needed to pass from the standard phase-space
@@ -40,6 +42,9 @@
  *
  * Up to four solutions are possible for \f$(E1, \alpha)\f$, where \f$\alpha = 2 p_1 \dot p_2\f$.
  *
+ * Solutions rejected because of the rounding errors of the analytical solution can be recovered by setting
+ * `polish_iterations`, as in BlockD.
+ *
  * ### Integration dimension
  *
  * This module requires **0** phase-space point.
@@ -56,6 +61,7 @@
  *   |------|------|--------------|
  *   | `pT_is_met` | bool, default false | Fix \f$\vec{p}_{T1} + \vec{p}_{T3} = \vec{\cancel{E_T}}\f$ (i.e. assume particles 1 and 3 are both invisible, and constrain them to the MET) or \f$\vec{p}_{T1} + \vec{p}_{T3} = - \sum_{i \in \text{2, branches}} \vec{p}_i\f$ (enforce zero total transverse momentum no matter what) |
  *   | `m1`  | double, default 0 | Mass of the invisible particle |
+ *   | `polish_iterations` | int, default 0 | Maximum number of Newton iterations used to refine the solutions rejected because of numerical errors (see above). |
  *
  * ### Inputs
  *
@@ -70,6 +76,7 @@
  *   | Name | Type | %Description |
  *   |------|------|--------------|
  *   | `solutions` | vector(Solution) | Solutions of the change of variable. Each solution embeds the LorentzVectors of the invisible particle (ie. \f$(p_1)\f$) and the massless particle (ie. \f$(p_3)\f$) and the associated jacobian. These solutions should be fed as input to the Looper module. |
+ *   | `recovered_solutions` | double | Number of solutions of the current phase-space point recovered by polishing the roots. |
  *
  * \note This block has been partially validated and is probably safe to use.
  *
@@ -89,6 +96,15 @@ public:
 
         m1 = parameters.get<double>("m1", 0.);
 
+        int64_t polish_iterations = parameters.get<int64_t>("polish_iterations", 0);
+        if (polish_iterations < 0) {
+            LOG(fatal) << "Invalid number of iterations for the polishing of the roots: " << polish_iterations
+                       << ". It must be positive, or 0 to disable polishing.";
+
+            throw Module::invalid_configuration("Invalid number of iterations for the polishing of the roots");
+        }
+        m_polish_iterations = polish_iterations;
+
         p2 = get<LorentzVector>(parameters.get<InputTag>("p2"));
         p3 = get<LorentzVector>(parameters.get<InputTag>("p3"));
 
@@ -107,43 +123,51 @@ public:
             met_tag = InputTag({"met", "p4"});
         }
         m_met = get<LorentzVector>(met_tag);
+
+        m_inputs.watch(p2);
+        m_inputs.watch(p3);
+        m_inputs.watch(m_branches);
+        if (pT_is_met)
+            m_inputs.watch(m_met);
     };
 
+    virtual void beginIntegration() override {
+        m_recovered_solutions = 0;
+    }
+
+    virtual void endIntegration() override {
+        if (m_polish_iterations > 0)
+            LOG(info) << "[BlockC] " << m_recovered_solutions << " solutions recovered by polishing the roots";
+    }
+
     virtual Status work() override {
 
         solutions->clear();
+        *recovered_solutions = 0;
 
-        const double p2Sq = p2->M2();
+        // Everything not depending on the invariants is only computed when the visible particles change,
+        // usually once per event
+        if (m_inputs.changed())
+            computeEventCoefficients();
+
+        const EventCoefficients& c = m_coefficients;
+
+        const double p2Sq = c.p2Sq;
 
         // Don't spend time on unphysical corner of the phase-space
         if (*s12 >= *s123 || *s123 >= SQ(sqrt_s) || *s12 <= p2Sq + SQ(m1))
             return Status::NEXT;
 
-        // pT will be used to fix the transverse momentum of the reconstructed neutrinos
-        // We can either enforce momentum conservation by disregarding the MET, ie:
-        //  pT = sum of all the visible particles,
-        // Or we can fix it using the MET given as input:
-        //  pT = -MET
-        // In the latter case, it is the user's job to ensure momentum conservation at
-        // the matrix element level (by using the Boost module, for instance).
-        LorentzVector pT;
-        if (pT_is_met) {
-            pT = -*m_met;
-        } else {
-            pT = *p2;
-            for (size_t i = 0; i < m_branches.size(); i++) {
-                pT += *m_branches[i];
-            }
-        }
+        const LorentzVector& pT = c.pT;
 
         // p1x = alpha1 E1 + beta1 ALPHA + gamma1
         // p1y = ...(2)
         // p1z = ...(3)
         // E3  = ...(4)
-        const double cosphi3 = std::cos(p3->Phi());
-        const double sinphi3 = std::sin(p3->Phi());
-        const double costhe3 = std::cos(p3->Theta());
-        const double sinthe3 = std::sin(p3->Theta());
+        const double cosphi3 = c.cosphi3;
+        const double sinphi3 = c.sinphi3;
+        const double costhe3 = c.costhe3;
+        const double sinthe3 = c.sinthe3;
 
         const double E2 = p2->E();
         const double p2x = p2->Px();
@@ -153,43 +177,39 @@ public:
         const double pTx = pT.Px();
         const double pTy = pT.Py();
 
-        // Term appears regularly, compute once.
-        const double X = p2x * sinthe3 * cosphi3 + p2y * sinthe3 * sinphi3 + p2z * costhe3;
+        const double X = c.X;
+        const double denom = c.denom;
 
-        // Denominator that appears in several of the follwing eq.
-        // No need to compute it multiple times
-        const double denom = 2. * (E2 - X);
-
-        const double beta1 = (cosphi3 * sinthe3) / denom;
+        const double beta1 = c.beta1;
         const double gamma1 =
                 -(2 * E2 * pTx - 2 * X * pTx - *s12 * cosphi3 * sinthe3 + *s123 * cosphi3 * sinthe3) / denom;
 
-        const double beta2 = (sinthe3 * sinphi3) / denom;
+        const double beta2 = c.beta2;
         const double gamma2 =
                 -(2 * E2 * pTy - 2 * X * pTy - *s12 * sinthe3 * sinphi3 + *s123 * sinthe3 * sinphi3) / denom;
 
-        const double alpha3 = E2 / p2z;
-        const double beta3 = (p2x * cosphi3 * sinthe3 + p2y * sinthe3 * sinphi3) / (-p2z * denom);
+        const double alpha3 = c.alpha3;
+        const double beta3 = c.beta3;
         const double gamma3 = 0.5 *
                               (-*s12 + SQ(m1) + p2Sq + 2 * p2x * (pTx + sinthe3 * cosphi3 * (*s123 - *s12) / denom) +
                                2 * p2y * (pTy + sinthe3 * sinphi3 * (*s123 - *s12) / denom)) /
                               p2z;
 
-        const double beta4 = -1. / denom;
+        const double beta4 = c.beta4;
         const double gamma4 = (*s123 - *s12) / denom;
 
         // a11 E1^2 + a22 ALPHA^2 + a12 E1*ALPHA + a10 E1 + a01 ALPHA + a00 = 0
         // id. with bij
-        const double a11 = SQ(alpha3) - 1;
-        const double a22 = SQ(beta1) + SQ(beta2) + SQ(beta3);
-        const double a12 = 2. * (alpha3 * beta3);
+        const double a11 = c.a11;
+        const double a22 = c.a22;
+        const double a12 = c.a12;
         const double a10 = 2. * (alpha3 * gamma3);
         const double a01 = 2. * (beta1 * gamma1 + beta2 * gamma2 + beta3 * gamma3);
         const double a00 = SQ(gamma1) + SQ(gamma2) + SQ(gamma3) + SQ(m1);
 
         const double b11 = 0;
-        const double b22 = beta4 * (-beta1 * sinthe3 * cosphi3 - beta2 * sinthe3 * sinphi3 - beta3 * costhe3);
-        const double b12 = beta4 - alpha3 * beta4 * costhe3;
+        const double b22 = c.b22;
+        const double b12 = c.b12;
         const double b10 = gamma4 - alpha3 * gamma4 * costhe3;
         const double b01 = -0.5 - (beta1 * gamma4 + beta4 * gamma1) * sinthe3 * cosphi3 -
                            (beta2 * gamma4 + beta4 * gamma2) * sinthe3 * sinphi3 -
@@ -197,25 +217,24 @@ public:
         const double b00 = gamma4 * (-gamma1 * sinthe3 * cosphi3 - gamma2 * sinthe3 * sinphi3 - gamma3 * costhe3);
 
         // Find the intersection of the 2 conics (at most 4 real solutions for (e1,ALPHA))
-        std::vector<double> e1, ALPHA;
-        solve2Quads(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, e1, ALPHA, false);
+        QuarticRoots e1, ALPHA;
+        solve2Quads(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, e1, ALPHA);
+        removeDuplicateSolutions(e1, ALPHA);
 
         // For each solution (e1,ALPHA), find the neutrino 4-momentum p1
         if (e1.size() == 0)
             return Status::NEXT;
 
-        for (unsigned int i = 0; i < e1.size(); i++) {
-            const double E1 = e1.at(i);
-            const double alp = ALPHA.at(i);
-
+        // Add the solution to the collection if it is physical. Returns false if it has been rejected.
+        auto addSolution = [&](const double E1, const double alp) -> bool {
             //Make sure E1 is not negative
             if (E1 <= 0.)
-                continue;
+                return false;
 
             const double E3 = beta4 * alp + gamma4;
             // Make sure E3 is not negative
             if (E3 <= 0.)
-                continue;
+                return false;
 
             const double p1x = beta1 * alp + gamma1;
             const double p1y = beta2 * alp + gamma2;
@@ -237,14 +256,14 @@ public:
             const double q1Pz = std::abs(tot.Pz() + tot.E()) / 2.;
             const double q2Pz = std::abs(tot.Pz() - tot.E()) / 2.;
             if (q1Pz > sqrt_s / 2 || q2Pz > sqrt_s / 2)
-                continue;
+                return false;
 
             if (!ApproxComparison((p1 + p3_sol + pT).Pt(), 0.)) {
 #ifndef NDEBUG
                 LOG(trace) << "[BlockC] Throwing solution because total Pt is incorrect. "
                            << "Expected " << 0. << ", got " << (p1 + p3_sol + pT).Pt();
 #endif
-                continue;
+                return false;
             }
 
             if (!ApproxComparison(p1.M() / p1.E(), m1 / p1.E())) {
@@ -252,7 +271,7 @@ public:
                LOG(trace) << "[BlockC] Throwing solution because p1 has an invalid mass. " <<
                            "Expected " << m1 << ", got " << p1.M();
 #endif
-                continue;
+                return false;
             }
 
             if (!ApproxComparison((p1 + *p2).M2(), *s12)) {
@@ -260,7 +279,7 @@ public:
                 LOG(trace) << "[BlockC] Throwing solution because of invalid invariant mass. " <<
                            "Expected " << *s12 << ", got " << (p1 + *p2).M2();
 #endif
-                continue;
+                return false;
             }
 
             if (!ApproxComparison((p1 + *p2 + p3_sol).M2(), *s123)) {
@@ -268,7 +287,7 @@ public:
                 LOG(trace) << "[BlockC] Throwing solution because of invalid invariant mass. " <<
                            "Expected " << *s123 << ", got " << (p1 + *p2 + p3_sol).M2();
 #endif
-                continue;
+                return false;
             }
 
             const double jacobian = SQ(E3) * sinthe3 / (32 * SQ(M_PI) * SQ(sqrt_s) *
@@ -277,16 +296,100 @@ public:
 
             Solution s {{p1, p3_sol}, jacobian, true};
             solutions->push_back(s);
+
+            return true;
+        };
+
+        for (std::size_t i = 0; i < e1.size(); i++) {
+            if (addSolution(e1[i], ALPHA[i]) || m_polish_iterations == 0)
+                continue;
+
+            // The solution may have been rejected only because of numerical errors: try again once polished
+            double E1 = e1[i];
+            double alp = ALPHA[i];
+            polish2QuadsSolution(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, E1, alp,
+                                 m_polish_iterations);
+
+            if (addSolution(E1, alp)) {
+                m_recovered_solutions++;
+                (*recovered_solutions)++;
+            }
         }
 
         return solutions->size() > 0 ? Status::OK : Status::NEXT;
     }
 
+    /// Compute the coefficients depending only on the visible particles
+    void computeEventCoefficients() {
+        EventCoefficients& c = m_coefficients;
+
+        c.p2Sq = p2->M2();
+
+        // pT will be used to fix the transverse momentum of the reconstructed neutrinos
+        // We can either enforce momentum conservation by disregarding the MET, ie:
+        //  pT = sum of all the visible particles,
+        // Or we can fix it using the MET given as input:
+        //  pT = -MET
+        // In the latter case, it is the user's job to ensure momentum conservation at
+        // the matrix element level (by using the Boost module, for instance).
+        if (pT_is_met) {
+            c.pT = -*m_met;
+        } else {
+            c.pT = *p2;
+            for (size_t i = 0; i < m_branches.size(); i++) {
+                c.pT += *m_branches[i];
+            }
+        }
+
+        c.cosphi3 = std::cos(p3->Phi());
+        c.sinphi3 = std::sin(p3->Phi());
+        c.costhe3 = std::cos(p3->Theta());
+        c.sinthe3 = std::sin(p3->Theta());
+
+        const double E2 = p2->E();
+        const double p2x = p2->Px();
+        const double p2y = p2->Py();
+        const double p2z = p2->Pz();
+
+        // Term appears regularly, compute once.
+        c.X = p2x * c.sinthe3 * c.cosphi3 + p2y * c.sinthe3 * c.sinphi3 + p2z * c.costhe3;
+
+        // Denominator that appears in several of the follwing eq.
+        // No need to compute it multiple times
+        c.denom = 2. * (E2 - c.X);
+
+        c.beta1 = (c.cosphi3 * c.sinthe3) / c.denom;
+        c.beta2 = (c.sinthe3 * c.sinphi3) / c.denom;
+        c.alpha3 = E2 / p2z;
+        c.beta3 = (p2x * c.cosphi3 * c.sinthe3 + p2y * c.sinthe3 * c.sinphi3) / (-p2z * c.denom);
+        c.beta4 = -1. / c.denom;
+
+        c.a11 = SQ(c.alpha3) - 1;
+        c.a22 = SQ(c.beta1) + SQ(c.beta2) + SQ(c.beta3);
+        c.a12 = 2. * (c.alpha3 * c.beta3);
+
+        c.b22 = c.beta4 * (-c.beta1 * c.sinthe3 * c.cosphi3 - c.beta2 * c.sinthe3 * c.sinphi3 - c.beta3 * c.costhe3);
+        c.b12 = c.beta4 - c.alpha3 * c.beta4 * c.costhe3;
+    }
+
 private:
+    /// Coefficients depending only on the visible particles, see computeEventCoefficients()
+    struct EventCoefficients {
+        double p2Sq;
+        LorentzVector pT;
+        double cosphi3, sinphi3, costhe3, sinthe3;
+        double X, denom;
+        double beta1, beta2, alpha3, beta3, beta4;
+        double a11, a22, a12, b22, b12;
+    };
+
     double sqrt_s;
     bool pT_is_met;
     double m1;
 
+    unsigned int m_polish_iterations;
+    std::size_t m_recovered_solutions = 0;
+
     // Inputs
     Value<double> s12;
     Value<double> s123;
@@ -295,8 +398,12 @@ private:
     Value<LorentzVector> p2;
     Value<LorentzVector> p3;
 
+    momemta::InputsWatcher m_inputs;
+    EventCoefficients m_coefficients;
+
     // Outputs
     std::shared_ptr<SolutionCollection> solutions = produce<SolutionCollection>("solutions");
+    std::shared_ptr<double> recovered_solutions = produce<double>("recovered_solutions");
 };
 
 REGISTER_MODULE(BlockC)
@@ -307,7 +414,10 @@ REGISTER_MODULE(BlockC)
         .OptionalInputs("branches")
         .Input("met=met::p4")
         .Output("solutions")
+        .Output("recovered_solutions")
         .GlobalAttr("energy:double")
         .Attr("pT_is_met:bool=false")
-        .Attr("m1:double=0");
+        .Attr("m1:double=0")
+        .Attr("polish_iterations:int=0")
+        .Filter();
 
@@ -23,6 +23,8 @@
 #include <momemta/Types.h>
 #include <momemta/Math.h>
 
+#include <InputsWatcher.h>
+
 /** \brief \f$\require{cancel}\f$ Final (main) Block D, describing \f$X + s_{134} (\to p_4 + s_{13} (\to \cancel{p_1} p_3)) + s_{256} (\to p_6 + s_{25} (\to \cancel{p_2} p_5))\f$
  *
  * This Block addresses the change of variables needed to pass from the standard phase-space
@@ -45,6 +47,12 @@
  *
  * Up to four solutions are possible for \f$(p_1, p_2)\f$.
  *
+ * The equations are reduced to a quartic, solved analytically. Rounding errors in this solution can be large enough
+ * for a valid solution to fail the consistency checks made on the reconstructed momenta, and be rejected. If
+ * `polish_iterations` is set, such solutions are refined with a few Newton iterations on the original system of
+ * equations, and tried again. The number of solutions recovered this way is given by the `recovered_solutions` output
+ * for each phase-space point, and their total is logged at the end of each integration.
+ *
  * ### Integration dimension
  *
  * This module requires **0** phase-space point.
@@ -61,6 +69,7 @@
  *   |------|------|--------------|
  *   | `pT_is_met` | bool, default false | Fix \f$\vec{p}_{T}^{tot} = -\vec{\cancel{E_T}}\f$ or \f$\vec{p}_{T}^{tot} = \sum_{i \in \text{ vis}} \vec{p}_i\f$ |
  *   | `m1` <br /> `m2` | double, default 0 | Masses of the invisible particles \f$p_1\f$ and \f$p_2\f$ |
+ *   | `polish_iterations` | int, default 0 | Maximum number of Newton iterations used to refine the solutions rejected because of numerical errors (see above). |
  *
  * ### Inputs
  *
@@ -76,6 +85,7 @@
  *   | Name | Type | %Description |
  *   |------|------|--------------|
  *   | `solutions` | vector(Solution) | Solutions of the change of variable. Each solution embed  the LorentzVectors of the invisible particles (ie. one \f$(p_1, p_2)\f$ pair) and the associated jacobian. These solutions should be fed as input to the Looper module. |
+ *   | `recovered_solutions` | double | Number of solutions of the current phase-space point recovered by polishing the roots (see above). It can be declared as an integrand component to monitor the polishing. |
  *
  * \note This block has been validated and is safe to use.
  *
@@ -94,6 +104,15 @@ class BlockD: public Module {
             m1 = parameters.get<double>("m1", 0.);
             m2 = parameters.get<double>("m2", 0.);
 
+            int64_t polish_iterations = parameters.get<int64_t>("polish_iterations", 0);
+            if (polish_iterations < 0) {
+                LOG(fatal) << "Invalid number of iterations for the polishing of the roots: " << polish_iterations
+                           << ". It must be positive, or 0 to disable polishing.";
+
+                throw Module::invalid_configuration("Invalid number of iterations for the polishing of the roots");
+            }
+            m_polish_iterations = polish_iterations;
+
             s13 = get<double>(parameters.get<InputTag>("s13"));
             s134 = get<double>(parameters.get<InputTag>("s134"));
             s25 = get<double>(parameters.get<InputTag>("s25"));
@@ -120,61 +139,63 @@ class BlockD: public Module {
             }
 
             m_met = get<LorentzVector>(met_tag);
+
+            m_inputs.watch(m_particles);
+            m_inputs.watch(m_branches);
+            if (pT_is_met)
+                m_inputs.watch(m_met);
         };
 
+        virtual void beginIntegration() override {
+            m_recovered_solutions = 0;
+        }
+
+        virtual void endIntegration() override {
+            if (m_polish_iterations > 0)
+                LOG(info) << "[BlockD] " << m_recovered_solutions << " solutions recovered by polishing the roots";
+        }
+
         virtual Status work() override {
 
             solutions->clear();
+            *recovered_solutions = 0;
 
             const LorentzVector& p3 = *m_particles[0];
             const LorentzVector& p4 = *m_particles[1];
             const LorentzVector& p5 = *m_particles[2];
             const LorentzVector& p6 = *m_particles[3];
 
+            // Everything not depending on the invariants is only computed when the visible particles change,
+            // usually once per event
+            if (m_inputs.changed())
+                computeEventCoefficients();
+
+            const EventCoefficients& c = m_coefficients;
+
             const double p11 = SQ(m1);
             const double p22 = SQ(m2);
-            const double p33 = p3.M2();
-            const double p44 = p4.M2();
-            const double p55 = p5.M2();
-            const double p66 = p6.M2();
+            const double p33 = c.p33;
+            const double p44 = c.p44;
+            const double p55 = c.p55;
+            const double p66 = c.p66;
 
             // Don't spend time on unphysical corner of the phase-space
             if (*s13 + p44 >= *s134 || *s25 + p66 >= *s256 || *s134 + *s256 >= SQ(sqrt_s) || *s13 <= p11 + p33 || *s25 <= p22 + p55)
                 return Status::NEXT;
 
-            // pT will be used to fix the transverse momentum of the reconstructed neutrinos
-            // We can either enforce momentum conservation by disregarding the MET, ie:
-            //  pT = sum of all the visible particles,
-            // Or we can fix it using the MET given as input:
-            //  pT = -MET
-            // In the latter case, it is the user's job to ensure momentum conservation at
-            // the matrix element level (by using the Boost module, for instance).
+            const LorentzVector& pT = c.pT;
 
-            LorentzVector pT;
-            if (pT_is_met) {
-                pT = - *m_met;
-            } else {
-                pT = p3 + p4 + p5 + p6;
-                for (size_t i = 0; i < m_branches.size(); i++) {
-                    pT += *m_branches[i];
-                }
-            }
-
-            const double p34 = p3.Dot(p4);
-            const double p56 = p5.Dot(p6);
+            const double p34 = c.p34;
+            const double p56 = c.p56;
 
-            // A1 p1x + B1 p1y + C1 = 0, with C1(E1,E2)
-            // A2 p1y + B2 p2y + C2 = 0, with C2(E1,E2)
-            // ==> express p1x and p1y as functions of E1, E2
+            const double A1 = c.A1;
+            const double A2 = c.A2;
 
-            const double A1 = 2.*( -p3.Px() + p3.Pz()*p4.Px()/p4.Pz() );
-            const double A2 = 2.*( p5.Px() - p5.Pz()*p6.Px()/p6.Pz() );
+            const double B1 = c.B1;
+            const double B2 = c.B2;
 
-            const double B1 = 2.*( -p3.Py() + p3.Pz()*p4.Py()/p4.Pz() );
-            const double B2 = 2.*( p5.Py() - p5.Pz()*p6.Py()/p6.Pz() );
-
-            const double Dx = B2*A1 - B1*A2;
-            const double Dy = A2*B1 - A1*B2;
+            const double Dx = c.Dx;
+            const double Dy = c.Dy;
 
             const double X = 2*( pT.Px()*p5.Px() + pT.Py()*p5.Py() - p5.Pz()/p6.Pz()*( 0.5*(*s25 - *s256 + p66) + p56 + pT.Px()*p6.Px() + pT.Py()*p6.Py() ) ) + p55 + p22 - *s25;
             const double Y = p3.Pz()/p4.Pz()*( *s13 - *s134 + 2*p34 + p44 ) - p33 - p11 + *s13;
@@ -186,20 +207,20 @@ class BlockD: public Module {
             // p2x = ...(5)
             // p2y = ...(6)
 
-            const double alpha1 = -2*B2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dx;
-            const double beta1 = 2*B1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dx;
+            const double alpha1 = c.alpha1;
+            const double beta1 = c.beta1;
             const double gamma1 = B1*X/Dx + B2*Y/Dx;
 
-            const double alpha2 = -2*A2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dy;
-            const double beta2 = 2*A1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dy;
+            const double alpha2 = c.alpha2;
+            const double beta2 = c.beta2;
             const double gamma2 = A1*X/Dy + A2*Y/Dy;
 
-            const double alpha3 = (p4.E() - alpha1*p4.Px() - alpha2*p4.Py())/p4.Pz();
-            const double beta3 = -(beta1*p4.Px() + beta2*p4.Py())/p4.Pz();
+            const double alpha3 = c.alpha3;
+            const double beta3 = c.beta3;
             const double gamma3 = ( 0.5*(*s13 - *s134 + p44) + p34 - gamma1*p4.Px() - gamma2*p4.Py() )/p4.Pz();
 
-            const double alpha4 = (alpha1*p6.Px() + alpha2*p6.Py())/p6.Pz();
-            const double beta4 = (p6.E() + beta1*p6.Px() + beta2*p6.Py())/p6.Pz();
+            const double alpha4 = c.alpha4;
+            const double beta4 = c.beta4;
             const double gamma4 = ( 0.5*(*s25 - *s256 + p66) + p56 + (gamma1 + pT.Px())*p6.Px() + (gamma2 + pT.Py())*p6.Py() )/p6.Pz();
 
             const double alpha5 = -alpha1;
@@ -213,35 +234,34 @@ class BlockD: public Module {
             // a11 E1^2 + a22 E2^2 + a12 E1E2 + a10 E1 + a01 E2 + a00 = 0
             // id. with bij
 
-            const double a11 = -1 + ( SQ(alpha1) + SQ(alpha2) + SQ(alpha3) );
-            const double a22 = SQ(beta1) + SQ(beta2) + SQ(beta3);
-            const double a12 = 2.*( alpha1*beta1 + alpha2*beta2 + alpha3*beta3 );
+            const double a11 = c.a11;
+            const double a22 = c.a22;
+            const double a12 = c.a12;
             const double a10 = 2.*( alpha1*gamma1 + alpha2*gamma2 + alpha3*gamma3 );
             const double a01 = 2.*( beta1*gamma1 + beta2*gamma2 + beta3*gamma3 );
             const double a00 = SQ(gamma1) + SQ(gamma2) + SQ(gamma3) + p11;
 
-            const double b11 = SQ(alpha5) + SQ(alpha6) + SQ(alpha4);
-            const double b22 = -1 + ( SQ(beta5) + SQ(beta6) + SQ(beta4) );
-            const double b12 = 2.*( alpha5*beta5 + alpha6*beta6 + alpha4*beta4 );
+            const double b11 = c.b11;
+            const double b22 = c.b22;
+            const double b12 = c.b12;
             const double b10 = 2.*( alpha5*gamma5 + alpha6*gamma6 + alpha4*gamma4 );
             const double b01 = 2.*( beta5*gamma5 + beta6*gamma6 + beta4*gamma4 );
             const double b00 = SQ(gamma5) + SQ(gamma6) + SQ(gamma4) + p22;
 
             // Find the intersection of the 2 conics (at most 4 real solutions for (E1,E2))
-            std::vector<double> E1, E2;
-            solve2Quads(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, E1, E2, false);
+            QuarticRoots E1, E2;
+            solve2Quads(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, E1, E2);
+            removeDuplicateSolutions(E1, E2);
 
             // For each solution (E1,E2), find the neutrino 4-momenta p1,p2
 
             if (E1.size() == 0)
                 return Status::NEXT;
 
-            for(unsigned int i = 0; i < E1.size(); i++){
-                const double e1 = E1.at(i);
-                const double e2 = E2.at(i);
-
+            // Add the solution to the collection if it is physical. Returns false if it has been rejected.
+            auto addSolution = [&](const double e1, const double e2) -> bool {
                 if (e1 <= 0 || e2 <= 0)
-                    continue;
+                    return false;
 
                 LorentzVector p1(
                         alpha1*e1 + beta1*e2 + gamma1,
@@ -263,14 +283,14 @@ class BlockD: public Module {
                 double q1Pz = std::abs(tot.Pz() + tot.E()) / 2.;
                 double q2Pz = std::abs(tot.Pz() - tot.E()) / 2.;
                 if (q1Pz > sqrt_s / 2 || q2Pz > sqrt_s / 2)
-                    continue;
+                    return false;
 
                 if (!ApproxComparison((p1 + p2 + pT).Pt(), 0.)) {
 #ifndef NDEBUG
                     LOG(trace) << "[BlockD] Throwing solution because neutrino balance is incorrect. "
                                << "Expected " << pT.Pt() << ", got " <<(p1 + p2).Pt();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison(p1.M() / p1.E(), m1 / p1.E())) {
@@ -278,7 +298,7 @@ class BlockD: public Module {
                     LOG(trace) << "[BlockD] Throwing solution because p1 has an invalid mass. " <<
                                "Expected " << m1 << ", got " << p1.M();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison(p2.M() / p2.E(), m2 / p2.E())) {
@@ -286,7 +306,7 @@ class BlockD: public Module {
                     LOG(trace) << "[BlockD] Throwing solution because p2 has an invalid mass. " <<
                                "Expected " << m2 << ", got " << p2.M();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison((p1 + p3).M2(), *s13)) {
@@ -294,7 +314,7 @@ class BlockD: public Module {
                     LOG(trace) << "[BlockD] Throwing solution because of invalid invariant mass. " <<
                                "Expected " << *s13 << ", got " << (p1 + p3).M2();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison((p1 + p3 + p4).M2(), *s134)) {
@@ -302,7 +322,7 @@ class BlockD: public Module {
                     LOG(trace) << "[BlockD] Throwing solution because of invalid invariant mass. " <<
                                "Expected " << *s134 << ", got " << (p1 + p3 + p4).M2();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison((p2 + p5).M2(), *s25)) {
@@ -310,7 +330,7 @@ class BlockD: public Module {
                     LOG(trace) << "[BlockD] Throwing solution because of invalid invariant mass. " <<
                                "Expected " << *s25 << ", got " << (p2 + p5).M2();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison((p2 + p5 + p6).M2(), *s256)) {
@@ -318,18 +338,110 @@ class BlockD: public Module {
                     LOG(trace) << "[BlockD] Throwing solution because of invalid invariant mass. " <<
                                "Expected " << *s256 << ", got " << (p2 + p5 + p6).M2();
 #endif
-                    continue;
+                    return false;
                 }
 
 
                 double jacobian = computeJacobian(p1, p2, p3, p4, p5, p6);
                 Solution s { {p1, p2}, jacobian, true };
                 solutions->push_back(s);
+
+                return true;
+            };
+
+            for (std::size_t i = 0; i < E1.size(); i++) {
+                if (addSolution(E1[i], E2[i]) || m_polish_iterations == 0)
+                    continue;
+
+                // The solution may have been rejected only because of numerical errors: try again once polished
+                double e1 = E1[i];
+                double e2 = E2[i];
+                polish2QuadsSolution(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, e1, e2,
+                                     m_polish_iterations);
+
+                if (addSolution(e1, e2)) {
+                    m_recovered_solutions++;
+                    (*recovered_solutions)++;
+                }
             }
 
             return solutions->size() > 0 ? Status::OK : Status::NEXT;
         }
 
+        /// Compute the coefficients depending only on the visible particles
+        void computeEventCoefficients() {
+            const LorentzVector& p3 = *m_particles[0];
+            const LorentzVector& p4 = *m_particles[1];
+            const LorentzVector& p5 = *m_particles[2];
+            const LorentzVector& p6 = *m_particles[3];
+
+            EventCoefficients& c = m_coefficients;
+
+            c.p33 = p3.M2();
+            c.p44 = p4.M2();
+            c.p55 = p5.M2();
+            c.p66 = p6.M2();
+
+            // pT will be used to fix the transverse momentum of the reconstructed neutrinos
+            // We can either enforce momentum conservation by disregarding the MET, ie:
+            //  pT = sum of all the visible particles,
+            // Or we can fix it using the MET given as input:
+            //  pT = -MET
+            // In the latter case, it is the user's job to ensure momentum conservation at
+            // the matrix element level (by using the Boost module, for instance).
+
+            if (pT_is_met) {
+                c.pT = - *m_met;
+            } else {
+                c.pT = p3 + p4 + p5 + p6;
+                for (size_t i = 0; i < m_branches.size(); i++) {
+                    c.pT += *m_branches[i];
+                }
+            }
+
+            c.p34 = p3.Dot(p4);
+            c.p56 = p5.Dot(p6);
+
+            // A1 p1x + B1 p1y + C1 = 0, with C1(E1,E2)
+            // A2 p1y + B2 p2y + C2 = 0, with C2(E1,E2)
+            // ==> express p1x and p1y as functions of E1, E2
+
+            c.A1 = 2.*( -p3.Px() + p3.Pz()*p4.Px()/p4.Pz() );
+            c.A2 = 2.*( p5.Px() - p5.Pz()*p6.Px()/p6.Pz() );
+
+            c.B1 = 2.*( -p3.Py() + p3.Pz()*p4.Py()/p4.Pz() );
+            c.B2 = 2.*( p5.Py() - p5.Pz()*p6.Py()/p6.Pz() );
+
+            c.Dx = c.B2*c.A1 - c.B1*c.A2;
+            c.Dy = c.A2*c.B1 - c.A1*c.B2;
+
+            c.alpha1 = -2*c.B2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/c.Dx;
+            c.beta1 = 2*c.B1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/c.Dx;
+
+            c.alpha2 = -2*c.A2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/c.Dy;
+            c.beta2 = 2*c.A1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/c.Dy;
+
+            c.alpha3 = (p4.E() - c.alpha1*p4.Px() - c.alpha2*p4.Py())/p4.Pz();
+            c.beta3 = -(c.beta1*p4.Px() + c.beta2*p4.Py())/p4.Pz();
+
+            c.alpha4 = (c.alpha1*p6.Px() + c.alpha2*p6.Py())/p6.Pz();
+            c.beta4 = (p6.E() + c.beta1*p6.Px() + c.beta2*p6.Py())/p6.Pz();
+
+            const double alpha5 = -c.alpha1;
+            const double beta5 = -c.beta1;
+
+            const double alpha6 = -c.alpha2;
+            const double beta6 = -c.beta2;
+
+            c.a11 = -1 + ( SQ(c.alpha1) + SQ(c.alpha2) + SQ(c.alpha3) );
+            c.a22 = SQ(c.beta1) + SQ(c.beta2) + SQ(c.beta3);
+            c.a12 = 2.*( c.alpha1*c.beta1 + c.alpha2*c.beta2 + c.alpha3*c.beta3 );
+
+            c.b11 = SQ(alpha5) + SQ(alpha6) + SQ(c.alpha4);
+            c.b22 = -1 + ( SQ(beta5) + SQ(beta6) + SQ(c.beta4) );
+            c.b12 = 2.*( alpha5*beta5 + alpha6*beta6 + c.alpha4*c.beta4 );
+        }
+
         double computeJacobian(const LorentzVector& p1, const LorentzVector& p2, const LorentzVector& p3, const LorentzVector& p4, const LorentzVector& p5, const LorentzVector& p6) {
 
             const double E1  = p1.E();
@@ -414,12 +526,25 @@ class BlockD: public Module {
         }
 
     private:
+        /// Coefficients depending only on the visible particles, see computeEventCoefficients()
+        struct EventCoefficients {
+            double p33, p44, p55, p66;
+            LorentzVector pT;
+            double p34, p56;
+            double A1, A2, B1, B2, Dx, Dy;
+            double alpha1, beta1, alpha2, beta2, alpha3, beta3, alpha4, beta4;
+            double a11, a22, a12, b11, b22, b12;
+        };
+
         double sqrt_s;
         bool pT_is_met;
 
         double m1;
         double m2;
 
+        unsigned int m_polish_iterations;
+        std::size_t m_recovered_solutions = 0;
+
         // Inputs
         Value<double> s13;
         Value<double> s134;
@@ -429,8 +554,12 @@ class BlockD: public Module {
         std::vector<Value<LorentzVector>> m_branches;
         Value<LorentzVector> m_met;
 
+        momemta::InputsWatcher m_inputs;
+        EventCoefficients m_coefficients;
+
         // Outputs
         std::shared_ptr<SolutionCollection> solutions = produce<SolutionCollection>("solutions");
+        std::shared_ptr<double> recovered_solutions = produce<double>("recovered_solutions");
 };
 
 REGISTER_MODULE(BlockD)
@@ -445,7 +574,10 @@ REGISTER_MODULE(BlockD)
         .OptionalInputs("branches")
         .Input("met=met::p4")
         .Output("solutions")
+        .Output("recovered_solutions")
         .GlobalAttr("energy:double")
         .Attr("pT_is_met:bool=false")
         .Attr("m1:double=0.")
-        .Attr("m2:double=0.");
+        .Attr("m2:double=0.")
+        .Attr("polish_iterations:int=0")
+        .Filter();
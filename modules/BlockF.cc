@@ -212,11 +212,12 @@ class BlockF: public Module {
             const double a01 = - 2 * (B1x * C1x + B1z * C1z + pby);
             const double a00 = SQ(Etot) - (SQ(C1x) + SQ(C1z) + SQ(pby) + sq_m1);
 
-            std::vector<double> p2y_sol;
+            QuadraticRoots p2y_sol;
             const bool foundSolution = solveQuadratic(a02 + SQ(a) * a20 + a * a11,
                                                 2 * a * b * a20 + b * a11 + a01 + a * a10,
                                                 SQ(b) * a20 + b * a10 + a00,
                                                 p2y_sol);
+            removeDuplicateRoots(p2y_sol);
 
             if (!foundSolution)
                 return Status::NEXT;
@@ -326,4 +327,5 @@ REGISTER_MODULE(BlockF)
         .Output("solutions")
         .GlobalAttr("energy:double")
         .Attr("m1:double=0")
-        .Attr("m2:double=0");
+        .Attr("m2:double=0")
+        .Filter();
@@ -27,6 +27,8 @@
 
 #include <Math/GenVector/VectorUtil.h>
 
+#include <InputsWatcher.h>
+
 /** \brief Final (main) Block G, describing \f$X + s_{12} (\to p_1 p_2) + s_{34} (\to p_3 p_4)\f$
  *
  * This Block addresses the change of variables needed to pass from the standard phase-space
@@ -45,6 +47,9 @@
  *
  * Up to four solutions are possible for \f$(p_1, p_2, p_3, p_4)\f$.
  *
+ * Solutions rejected because of the rounding errors of the analytical solution can be recovered by setting
+ * `polish_iterations`, as in BlockD.
+ *
  * ### Integration dimension
  *
  * This module requires **0** phase-space point.
@@ -55,6 +60,12 @@
  *   |------|------|--------------|
  *   | `energy` | double | Collision energy. |
  *
+ * ### Parameters
+ *
+ *   | Name | Type | %Description |
+ *   |------|------|--------------|
+ *   | `polish_iterations` | int, default 0 | Maximum number of Newton iterations used to refine the solutions rejected because of numerical errors (see above). |
+ *
  * ### Inputs
  *
  *   | Name | Type | %Description |
@@ -68,6 +79,7 @@
  *   | Name | Type | %Description |
  *   |------|------|--------------|
  *   | `solutions` | vector(Solution) | Solutions of the change of variable. Each solution embeds the LorentzVectors of the particles whose energy was computed (ie. a set \f$(p_1, p_2, p_3, p_4)\f$) and the associated jacobian. |
+ *   | `recovered_solutions` | double | Number of solutions of the current phase-space point recovered by polishing the roots. |
  *
  * \note This block has been validated and is safe to use.
  *
@@ -83,6 +95,15 @@ class BlockG: public Module {
 
             sqrt_s = parameters.globalParameters().get<double>("energy");
 
+            int64_t polish_iterations = parameters.get<int64_t>("polish_iterations", 0);
+            if (polish_iterations < 0) {
+                LOG(fatal) << "Invalid number of iterations for the polishing of the roots: " << polish_iterations
+                           << ". It must be positive, or 0 to disable polishing.";
+
+                throw Module::invalid_configuration("Invalid number of iterations for the polishing of the roots");
+            }
+            m_polish_iterations = polish_iterations;
+
             s12 = get<double>(parameters.get<InputTag>("s12"));
             s34 = get<double>(parameters.get<InputTag>("s34"));
 
@@ -96,11 +117,24 @@ class BlockG: public Module {
                 for (auto& t: branches_tags)
                     m_branches.push_back(get<LorentzVector>(t));
             }
+
+            m_inputs.watch(m_particles);
+            m_inputs.watch(m_branches);
         };
 
+        virtual void beginIntegration() override {
+            m_recovered_solutions = 0;
+        }
+
+        virtual void endIntegration() override {
+            if (m_polish_iterations > 0)
+                LOG(info) << "[BlockG] " << m_recovered_solutions << " solutions recovered by polishing the roots";
+        }
+
         virtual Status work() override {
 
             solutions->clear();
+            *recovered_solutions = 0;
 
             if (*s12 + *s34 >= SQ(sqrt_s))
                 return Status::NEXT;
@@ -110,66 +144,62 @@ class BlockG: public Module {
             const LorentzVector& p3 = *m_particles[2];
             const LorentzVector& p4 = *m_particles[3];
 
-            LorentzVector pb;
-            for (size_t i = 0; i < m_branches.size(); i++) {
-                pb += *m_branches[i];
-            }
+            // Everything not depending on the invariants is only computed when the visible particles change,
+            // usually once per event
+            if (m_inputs.changed())
+                computeEventCoefficients();
+
+            const EventCoefficients& c = m_coefficients;
 
-            const double pbx = pb.Px();
-            const double pby = pb.Py();
-            const double sin_theta_1 = std::sin(p1.Theta());
-            const double sin_theta_2 = std::sin(p2.Theta());
-            const double sin_theta_3 = std::sin(p3.Theta());
-            const double sin_theta_4 = std::sin(p4.Theta());
-            const double phi_1 = p1.Phi();
-            const double phi_2 = p2.Phi();
-            const double phi_3 = p3.Phi();
-            const double phi_4 = p4.Phi();
-            const double sin_phi_3_2 = std::sin(phi_3 - phi_2);
-            const double sin_phi_2_1 = std::sin(phi_2 - phi_1);
-            const double sin_phi_4_2 = std::sin(phi_4 - phi_2);
-            const double sin_phi_1_3 = std::sin(phi_1 - phi_3);
-            const double sin_phi_1_4 = std::sin(phi_1 - phi_4);
+            const LorentzVector& pb = c.pb;
+
+            const double sin_theta_1 = c.sin_theta_1;
+            const double sin_theta_2 = c.sin_theta_2;
+            const double sin_theta_3 = c.sin_theta_3;
+            const double sin_theta_4 = c.sin_theta_4;
+            const double phi_1 = c.phi_1;
+            const double phi_2 = c.phi_2;
+            const double phi_3 = c.phi_3;
+            const double phi_4 = c.phi_4;
+            const double sin_phi_2_1 = c.sin_phi_2_1;
 
             /*
              * p1 = alpha1 p3 + beta1 p4 + gamma1
              * p2 = alpha2 p3 + beta2 p4 + gamma2
              */
 
-            const double denom_1 = sin_theta_1 * sin_phi_2_1;
-            const double denom_2 = sin_theta_2 * sin_phi_2_1;
-
-            const double alpha_1 = sin_theta_3 * sin_phi_3_2 / denom_1;
-            const double beta_1 = sin_theta_4 * sin_phi_4_2 / denom_1;
-            const double gamma_1 = ( std::cos(phi_2) * pby - std::sin(phi_2) * pbx ) / denom_1;
+            const double alpha_1 = c.alpha_1;
+            const double beta_1 = c.beta_1;
+            const double gamma_1 = c.gamma_1;
 
-            const double alpha_2 = sin_theta_3 * sin_phi_1_3 / denom_2;
-            const double beta_2 = sin_theta_4 * sin_phi_1_4 / denom_2;
-            const double gamma_2 = ( std::sin(phi_1) * pbx - std::cos(phi_1) * pby ) / denom_2;
+            const double alpha_2 = c.alpha_2;
+            const double beta_2 = c.beta_2;
+            const double gamma_2 = c.gamma_2;
 
-            const double cos_theta_34 = ROOT::Math::VectorUtil::CosTheta(p3, p4);
-            const double cos_theta_12 = ROOT::Math::VectorUtil::CosTheta(p1, p2);
+            const double cos_theta_34 = c.cos_theta_34;
+            const double cos_theta_12 = c.cos_theta_12;
             const double X = 0.5 * (*s34) / (1 - cos_theta_34);
             const double Y = 0.5 * (*s12) / (1 - cos_theta_12);
 
-            std::vector<double> gen_p3_solutions;
-            solveQuartic(
-                    alpha_1 * alpha_2,
-                    alpha_1 * gamma_2 + gamma_1 * alpha_2,
-                    gamma_1 * gamma_2 + (beta_1 * alpha_2 + alpha_1 * beta_2) * X - Y,
-                    (beta_1 * gamma_2 + gamma_1 * beta_2) * X,
-                    beta_1 * beta_2 * SQ(X),
-                    gen_p3_solutions
-                    );
+            // q4 p3^4 + q3 p3^3 + q2 p3^2 + q1 p3 + q0 = 0
+            const double q4 = alpha_1 * alpha_2;
+            const double q3 = alpha_1 * gamma_2 + gamma_1 * alpha_2;
+            const double q2 = gamma_1 * gamma_2 + (beta_1 * alpha_2 + alpha_1 * beta_2) * X - Y;
+            const double q1 = (beta_1 * gamma_2 + gamma_1 * beta_2) * X;
+            const double q0 = beta_1 * beta_2 * SQ(X);
 
-            for (const auto& p3_sol: gen_p3_solutions) {
+            QuarticRoots gen_p3_solutions;
+            solveQuartic(q4, q3, q2, q1, q0, gen_p3_solutions);
+            removeDuplicateRoots(gen_p3_solutions);
 
+            // Add the solution to the collection if it is physical. Returns false if it has been rejected.
+            auto addSolution = [&](const double p3_sol) -> bool {
                 const double p4_sol = X / p3_sol;
                 const double p1_sol = alpha_1 * p3_sol + beta_1 * p4_sol + gamma_1;
                 const double p2_sol = alpha_2 * p3_sol + beta_2 * p4_sol + gamma_2;
 
                 if (p1_sol < 0 || p2_sol < 0 || p3_sol < 0 || p4_sol < 0)
-                    continue;
+                    return false;
 
                 LorentzVector gen_p1(p1_sol * sin_theta_1 * std::cos(phi_1), p1_sol * sin_theta_1 * std::sin(phi_1), p1_sol * std::cos(p1.Theta()), p1_sol);
                 LorentzVector gen_p2(p2_sol * sin_theta_2 * std::cos(phi_2), p2_sol * sin_theta_2 * std::sin(phi_2), p2_sol * std::cos(p2.Theta()), p2_sol);
@@ -181,14 +211,14 @@ class BlockG: public Module {
                 double q1Pz = std::abs(tot.Pz() + tot.E()) / 2.;
                 double q2Pz = std::abs(tot.Pz() - tot.E()) / 2.;
                 if (q1Pz > sqrt_s / 2 || q2Pz > sqrt_s / 2)
-                    continue;
+                    return false;
 
                 if (!ApproxComparison(tot.Pt(), 0.)) {
 #ifndef NDEBUG
                     LOG(trace) << "[BlockG] Throwing solution because total Pt is incorrect. "
                                << "Expected " << 0. << ", got " << tot.Pt();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison((gen_p1 + gen_p2).M2(), *s12)) {
@@ -196,7 +226,7 @@ class BlockG: public Module {
                     LOG(trace) << "[BlockG] Throwing solution because of invalid invariant mass. " <<
                                "Expected " << *s12 << ", got " << (gen_p1 + gen_p2).M2();
 #endif
-                    continue;
+                    return false;
                 }
 
                 if (!ApproxComparison((gen_p3 + gen_p4).M2(), *s34)) {
@@ -204,7 +234,7 @@ class BlockG: public Module {
                     LOG(trace) << "[BlockG] Throwing solution because of invalid invariant mass. " <<
                                "Expected " << *s34 << ", got " << (gen_p3 + gen_p4).M2();
 #endif
-                    continue;
+                    return false;
                 }
 
                 double jacobian = 1 / std::abs( 2 *
@@ -216,6 +246,19 @@ class BlockG: public Module {
 
                 Solution s = { { gen_p1, gen_p2, gen_p3, gen_p4 }, jacobian, true };
                 solutions->push_back(s);
+
+                return true;
+            };
+
+            for (const double p3_sol: gen_p3_solutions) {
+                if (addSolution(p3_sol) || m_polish_iterations == 0)
+                    continue;
+
+                // The solution may have been rejected only because of numerical errors: try again once polished
+                if (addSolution(polishQuarticRoot(q4, q3, q2, q1, q0, p3_sol, m_polish_iterations))) {
+                    m_recovered_solutions++;
+                    (*recovered_solutions)++;
+                }
             }
 
             if (!solutions->size())
@@ -224,16 +267,78 @@ class BlockG: public Module {
             return Status::OK;
         }
 
-
     private:
+        /// Compute the coefficients depending only on the visible particles
+        void computeEventCoefficients() {
+            const LorentzVector& p1 = *m_particles[0];
+            const LorentzVector& p2 = *m_particles[1];
+            const LorentzVector& p3 = *m_particles[2];
+            const LorentzVector& p4 = *m_particles[3];
+
+            EventCoefficients& c = m_coefficients;
+
+            c.pb = LorentzVector();
+            for (size_t i = 0; i < m_branches.size(); i++) {
+                c.pb += *m_branches[i];
+            }
+
+            const double pbx = c.pb.Px();
+            const double pby = c.pb.Py();
+            c.sin_theta_1 = std::sin(p1.Theta());
+            c.sin_theta_2 = std::sin(p2.Theta());
+            c.sin_theta_3 = std::sin(p3.Theta());
+            c.sin_theta_4 = std::sin(p4.Theta());
+            c.phi_1 = p1.Phi();
+            c.phi_2 = p2.Phi();
+            c.phi_3 = p3.Phi();
+            c.phi_4 = p4.Phi();
+            const double sin_phi_3_2 = std::sin(c.phi_3 - c.phi_2);
+            c.sin_phi_2_1 = std::sin(c.phi_2 - c.phi_1);
+            const double sin_phi_4_2 = std::sin(c.phi_4 - c.phi_2);
+            const double sin_phi_1_3 = std::sin(c.phi_1 - c.phi_3);
+            const double sin_phi_1_4 = std::sin(c.phi_1 - c.phi_4);
+
+            const double denom_1 = c.sin_theta_1 * c.sin_phi_2_1;
+            const double denom_2 = c.sin_theta_2 * c.sin_phi_2_1;
+
+            c.alpha_1 = c.sin_theta_3 * sin_phi_3_2 / denom_1;
+            c.beta_1 = c.sin_theta_4 * sin_phi_4_2 / denom_1;
+            c.gamma_1 = ( std::cos(c.phi_2) * pby - std::sin(c.phi_2) * pbx ) / denom_1;
+
+            c.alpha_2 = c.sin_theta_3 * sin_phi_1_3 / denom_2;
+            c.beta_2 = c.sin_theta_4 * sin_phi_1_4 / denom_2;
+            c.gamma_2 = ( std::sin(c.phi_1) * pbx - std::cos(c.phi_1) * pby ) / denom_2;
+
+            c.cos_theta_34 = ROOT::Math::VectorUtil::CosTheta(p3, p4);
+            c.cos_theta_12 = ROOT::Math::VectorUtil::CosTheta(p1, p2);
+        }
+
+        /// Coefficients depending only on the visible particles, see computeEventCoefficients()
+        struct EventCoefficients {
+            LorentzVector pb;
+            double sin_theta_1, sin_theta_2, sin_theta_3, sin_theta_4;
+            double phi_1, phi_2, phi_3, phi_4;
+            double sin_phi_2_1;
+            double alpha_1, beta_1, gamma_1, alpha_2, beta_2, gamma_2;
+            double cos_theta_34, cos_theta_12;
+        };
+
         double sqrt_s;
 
+        unsigned int m_polish_iterations;
+        std::size_t m_recovered_solutions = 0;
+
         // Inputs
         std::vector<Value<LorentzVector>> m_branches;
         std::vector<Value<LorentzVector>> m_particles;
         Value<double> s12, s34;
+
+        momemta::InputsWatcher m_inputs;
+        EventCoefficients m_coefficients;
+
         // Outputs
         std::shared_ptr<SolutionCollection> solutions = produce<SolutionCollection>("solutions");
+        std::shared_ptr<double> recovered_solutions = produce<double>("recovered_solutions");
 };
 
 REGISTER_MODULE(BlockG)
@@ -245,4 +350,7 @@ REGISTER_MODULE(BlockG)
         .Input("p4")
         .OptionalInputs("branches")
         .Output("solutions")
-        .GlobalAttr("energy:double");
\ No newline at end of file
+        .Output("recovered_solutions")
+        .GlobalAttr("energy:double")
+        .Attr("polish_iterations:int=0")
+        .Filter();
\ No newline at end of file
@@ -158,4 +158,5 @@ REGISTER_MODULE(BuildInitialState)
         .Inputs("particles")
         .Output("partons")
         .GlobalAttr("energy:double")
-        .Attr("do_transverse_boost:bool=false");
\ No newline at end of file
+        .Attr("do_transverse_boost:bool=false")
+        .Filter();
\ No newline at end of file
@@ -23,6 +23,8 @@
 #include <momemta/Types.h>
 #include <momemta/Math.h>
 
+#include <FourVector.h>
+
 #include <Math/DistFunc.h>
 
 /** \brief Helper class for Gaussian transfer function modules
@@ -37,6 +39,7 @@ class GaussianTransferFunctionOnEnergyBase: public Module {
 
         GaussianTransferFunctionOnEnergyBase(PoolPtr pool, const ParameterSet& parameters): Module(pool, parameters.getModuleName()) {
             m_reco_input = get<LorentzVector>(parameters.get<InputTag>("reco_particle"));
+            m_reco = momemta::CachedKinematics(m_reco_input);
 
             m_sigma = parameters.get<double>("sigma", 0.10);
             m_sigma_range = parameters.get<double>("sigma_range", 5);
@@ -50,6 +53,7 @@ class GaussianTransferFunctionOnEnergyBase: public Module {
 
         // Input
         Value<LorentzVector> m_reco_input;
+        momemta::CachedKinematics m_reco;
 };
 
 /** \brief Integrate over a transfer function on energy described by a Gaussian distribution
@@ -99,27 +103,29 @@ class GaussianTransferFunctionOnEnergy: public GaussianTransferFunctionOnEnergyB
         }
 
         virtual Status work() override {
+            const momemta::Kinematics& reco = m_reco.get();
+
             // Estimate the width over which to integrate using the width of the TF at E_rec ...
-            const double sigma_E_rec = m_reco_input->E() * m_sigma;
+            const double sigma_E_rec = reco.E * m_sigma;
 
-            double range_min = std::max( { m_min_E, m_reco_input->M(), m_reco_input->E() - (m_sigma_range * sigma_E_rec) } );
-            double range_max = m_reco_input->E() + (m_sigma_range * sigma_E_rec);
+            double range_min = std::max( { m_min_E, reco.M, reco.E - (m_sigma_range * sigma_E_rec) } );
+            double range_max = reco.E + (m_sigma_range * sigma_E_rec);
             double range = (range_max - range_min);
 
             double gen_E = range_min + range * (*m_ps_point);
-            double gen_pt = std::sqrt(SQ(gen_E) - SQ(m_reco_input->M())) / std::cosh(m_reco_input->Eta());
+            double gen_pt = std::sqrt(SQ(gen_E) - SQ(reco.M)) / reco.cosh_eta;
 
             output->SetCoordinates(
-                    gen_pt * std::cos(m_reco_input->Phi()),
-                    gen_pt * std::sin(m_reco_input->Phi()),
-                    gen_pt * std::sinh(m_reco_input->Eta()),
+                    gen_pt * reco.cos_phi,
+                    gen_pt * reco.sin_phi,
+                    gen_pt * reco.sinh_eta,
                     gen_E);
 
             // ... but compute the width of the TF at E_gen!
             const double sigma_E_gen = gen_E * m_sigma;
 
             // Compute TF*jacobian, where the jacobian includes the transformation of [0,1]->[range_min,range_max] and d|P|/dE
-            *TF_times_jacobian = ROOT::Math::normal_pdf(gen_E, sigma_E_gen, m_reco_input->E()) * range * dP_over_dE(*output);
+            *TF_times_jacobian = ROOT::Math::normal_pdf(gen_E, sigma_E_gen, reco.E) * range * dP_over_dE(*output);
 
             return Status::OK;
         }
@@ -196,7 +202,8 @@ REGISTER_MODULE(GaussianTransferFunctionOnEnergy)
         .Output("TF_times_jacobian")
         .Attr("sigma:double=0.10")
         .Attr("sigma_range:double=5")
-        .Attr("min_E:double=0");
+        .Attr("min_E:double=0")
+        .Cost(2);
 
 REGISTER_MODULE(GaussianTransferFunctionOnEnergyEvaluator)
         .Input("gen_particle")
@@ -204,4 +211,5 @@ REGISTER_MODULE(GaussianTransferFunctionOnEnergyEvaluator)
         .Output("TF")
         .Attr("sigma:double=0.10")
         .Attr("sigma_range:double=5")
-        .Attr("min_E:double=0");
+        .Attr("min_E:double=0")
+        .Cost(2);
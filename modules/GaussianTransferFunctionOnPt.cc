@@ -23,6 +23,8 @@
 #include <momemta/Types.h>
 #include <momemta/Math.h>
 
+#include <FourVector.h>
+
 #include <Math/DistFunc.h>
 
 /** \brief Helper class for Gaussian transfer function modules
@@ -37,6 +39,7 @@ class GaussianTransferFunctionOnPtBase: public Module {
 
         GaussianTransferFunctionOnPtBase(PoolPtr pool, const ParameterSet& parameters): Module(pool, parameters.getModuleName()) {
             m_reco_input = get<LorentzVector>(parameters.get<InputTag>("reco_particle"));
+            m_reco = momemta::CachedKinematics(m_reco_input);
 
             m_sigma = parameters.get<double>("sigma", 0.10);
             m_sigma_range = parameters.get<double>("sigma_range", 5);
@@ -50,6 +53,7 @@ class GaussianTransferFunctionOnPtBase: public Module {
 
         // Input
         Value<LorentzVector> m_reco_input;
+        momemta::CachedKinematics m_reco;
 };
 
 /** \brief Integrate over a transfer function on Pt described by a Gaussian distribution
@@ -99,30 +103,32 @@ class GaussianTransferFunctionOnPt: public GaussianTransferFunctionOnPtBase {
         }
 
         virtual Status work() override {
+            const momemta::Kinematics& reco = m_reco.get();
+
             // Estimate the width over which to integrate using the width of the TF at Pt_rec ...
-            const double sigma_Pt_rec = m_reco_input->Pt() * m_sigma;
+            const double sigma_Pt_rec = reco.Pt * m_sigma;
 
-            const double cosh_eta = std::cosh(m_reco_input->Eta());
-            double range_min = std::max(m_min_Pt, m_reco_input->Pt() - (m_sigma_range * sigma_Pt_rec));
-            double range_max = m_reco_input->Pt() + (m_sigma_range * sigma_Pt_rec);
+            const double cosh_eta = reco.cosh_eta;
+            double range_min = std::max(m_min_Pt, reco.Pt - (m_sigma_range * sigma_Pt_rec));
+            double range_max = reco.Pt + (m_sigma_range * sigma_Pt_rec);
             double range = (range_max - range_min);
 
             double gen_Pt = range_min + range * (*m_ps_point);
 
             // To change the particle's Pt without changing its direction and mass:
-            const double gen_E = std::sqrt(SQ(m_reco_input->M()) + SQ(cosh_eta * gen_Pt));
+            const double gen_E = std::sqrt(SQ(reco.M) + SQ(cosh_eta * gen_Pt));
 
             output->SetCoordinates(
-                    gen_Pt * std::cos(m_reco_input->Phi()),
-                    gen_Pt * std::sin(m_reco_input->Phi()),
-                    gen_Pt * std::sinh(m_reco_input->Eta()),
+                    gen_Pt * reco.cos_phi,
+                    gen_Pt * reco.sin_phi,
+                    gen_Pt * reco.sinh_eta,
                     gen_E);
 
             // ... but compute the width of the TF at Pt_gen!
             const double sigma_Pt_gen = gen_Pt * m_sigma;
 
             // Compute TF*jacobian, where the jacobian includes the transformation of [0,1]->[range_min,range_max] and d|P|/dPt = cosh(eta)
-            *TF_times_jacobian = ROOT::Math::normal_pdf(gen_Pt, sigma_Pt_gen, m_reco_input->Pt()) * range * cosh_eta;
+            *TF_times_jacobian = ROOT::Math::normal_pdf(gen_Pt, sigma_Pt_gen, reco.Pt) * range * cosh_eta;
 
             return Status::OK;
         }
@@ -199,7 +205,8 @@ REGISTER_MODULE(GaussianTransferFunctionOnPt)
         .Output("TF_times_jacobian")
         .Attr("sigma:double=0.10")
         .Attr("sigma_range:double=5")
-        .Attr("min_Pt:double=0");
+        .Attr("min_Pt:double=0")
+        .Cost(2);
 
 REGISTER_MODULE(GaussianTransferFunctionOnPtEvaluator)
         .Input("gen_particle")
@@ -207,4 +214,5 @@ REGISTER_MODULE(GaussianTransferFunctionOnPtEvaluator)
         .Output("TF")
         .Attr("sigma:double=0.10")
         .Attr("sigma_range:double=5")
-        .Attr("min_Pt:double=0");
+        .Attr("min_Pt:double=0")
+        .Cost(2);
@@ -20,17 +20,11 @@
 
 #include <vector>
 
-#include <momemta/config.h>
 #include <momemta/ParameterSet.h>
 #include <momemta/Solution.h>
 
 #include <Path.h>
 
-#ifdef DEBUG_TIMING
-#include <chrono>
-using namespace std::chrono;
-#endif
-
 #define CALL(X) { for (auto& m: path.modules()) \
         m->X(); \
     }
@@ -44,6 +38,11 @@ using namespace std::chrono;
  *
  * If the path is executed, the solution is ensured to be valid.
  *
+ * Modules of the path not depending, even indirectly, on the outputs of the looper are automatically moved out of the
+ * path when building the computation graph, and executed only once, before the looper. Stateful modules (implementing
+ * Module::beginPoint(), Module::beginLoop(), Module::endLoop() or Module::endPoint()), sticky modules and nested loopers
+ * always stay in the path.
+ *
  * ### In details
  *
  * Each blocks produce a set of solutions. In order to define the final integrand value, various computations
@@ -129,27 +128,25 @@ class Looper: public Module {
 
         virtual void endIntegration() override {
             CALL(endIntegration);
+        }
 
-#ifdef DEBUG_TIMING
-            LOG(info) << "Time spent evaluating modules of looper " << name() << ":";
-            for (auto it: m_timings) {
-                LOG(info) << "    " << it.first->name() << ": " << duration_cast<duration<double>>(it.second).count() << "s";
-            }
-#endif
+        virtual void finish() override {
+            CALL(finish);
         }
 
         virtual void beginPoint() override {
-            CALL(beginPoint);
+            path.plan().beginPoint();
         }
 
         virtual void endPoint() override {
-            CALL(endPoint);
+            path.plan().endPoint();
         }
 
         virtual Status work() override {
             particles->clear();
 
-            CALL(beginLoop);
+            const auto& plan = path.plan();
+            plan.beginLoop();
 
             auto status = Status::OK;
 
@@ -158,33 +155,19 @@ class Looper: public Module {
                 if (!s.valid)
                     continue;
 
-                *particles = s.values;
+                // Particles' capacity is kept from one point to the next: no memory allocation
+                particles->assign(s.values.begin(), s.values.end());
                 *jacobian = s.jacobian;
 
-                for (auto& m: path.modules()) {
-#ifdef DEBUG_TIMING
-                    auto start = high_resolution_clock::now();
-#endif
-                    auto module_status = m->work();
-#ifdef DEBUG_TIMING
-                    m_timings[m.get()] += high_resolution_clock::now() - start;
-#endif
-
-                    if (module_status == Status::OK)
-                        continue;
-                    else if (module_status == Status::NEXT)
-                        break;
-                    else {
-                        status = module_status;
-                        break;
-                    }
-                }
-
-                if (status != Status::OK)
+                // Status::NEXT only stops the execution of the path for this solution
+                auto module_status = plan.work();
+                if (module_status == Status::ABORT) {
+                    status = module_status;
                     break;
+                }
             }
 
-            CALL(endLoop);
+            plan.endLoop();
 
             return status;
         }
@@ -199,10 +182,6 @@ class Looper: public Module {
         std::shared_ptr<std::vector<LorentzVector>> particles = produce<std::vector<LorentzVector>>("particles");
         std::shared_ptr<double> jacobian = produce<double>("jacobian");
 
-#ifdef DEBUG_TIMING
-        std::unordered_map<Module*, std::chrono::high_resolution_clock::duration> m_timings;
-#endif
-
 };
 
 REGISTER_MODULE(Looper)
@@ -62,6 +62,29 @@ void LooperSummer<LorentzVector>::beginPoint() {
   result->SetXYZT(0, 0, 0, 0);
 }
 
+/**
+ * \brief Specialization for vectors, summed element by element
+ *
+ * The sum is initialized with zeros, as many as there are elements in the input at the beginning of the point, so
+ * that its size is known even when the loop is empty. Inputs larger than that extend the sum.
+ */
+template<>
+void LooperSummer<std::vector<double>>::beginPoint() {
+    result->assign(input->size(), 0);
+}
+
+template<>
+Module::Status LooperSummer<std::vector<double>>::work() {
+    const std::vector<double>& values = *input;
+    if (result->size() < values.size())
+        result->resize(values.size(), 0);
+
+    for (size_t i = 0; i < values.size(); i++)
+        (*result)[i] += values[i];
+
+    return Status::OK;
+}
+
 REGISTER_MODULE_NAME("IntLooperSummer", LooperSummer<int64_t>)
         .Input("input")
         .Output("sum");
@@ -73,3 +96,7 @@ REGISTER_MODULE_NAME("DoubleLooperSummer", LooperSummer<double>)
 REGISTER_MODULE_NAME("P4LooperSummer", LooperSummer<LorentzVector>)
         .Input("input")
         .Output("sum");
+
+REGISTER_MODULE_NAME("VectorLooperSummer", LooperSummer<std::vector<double>>)
+        .Input("input")
+        .Output("sum");
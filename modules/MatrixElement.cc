@@ -18,7 +18,13 @@
 
 // Must be loaded before `momemta/Logging.h`, otherwise there's conflict between usage
 // of `log()` and `namespace log`
-#include <numeric>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <LHAPDF/LHAPDF.h>
 
 #include <momemta/Logging.h>
@@ -30,6 +36,78 @@
 #include <momemta/Types.h>
 #include <momemta/Utils.h>
 
+#include <SharedResources.h>
+
+namespace {
+
+/// Number of parton flavours for which PDF values are cached: \f$-6 \ldots 6\f$, the gluon having index 0
+const size_t N_PDF_FLAVOURS = 13;
+
+/// Index of a parton flavour in the PDF caches, or -1 if it's not cached
+int pdfFlavourIndex(int pdg_id) {
+    if (pdg_id == 21)
+        return 6;
+
+    if (pdg_id >= -6 && pdg_id <= 6)
+        return pdg_id + 6;
+
+    return -1;
+}
+
+/**
+ * \brief PDFs at a fixed scale, tabulated on a grid uniform in \f$\log x\f$
+ *
+ * \f$x f(x)\f$ is evaluated once for each flavour on the grid, and interpolated with a cubic Catmull-Rom spline in
+ * \f$\log x\f$ afterwards.
+ */
+class PdfGrid {
+    public:
+        PdfGrid(const LHAPDF::PDF& pdf, double q2, size_t n_points): n_points(n_points) {
+            log_x_min = std::log(pdf.xMin());
+            log_x_max = std::log(pdf.xMax());
+            step = (log_x_max - log_x_min) / (n_points - 1);
+
+            for (size_t flavour = 0; flavour < N_PDF_FLAVOURS; flavour++) {
+                int pdg_id = (flavour == 6) ? 21 : (int) flavour - 6;
+                values[flavour].resize(n_points);
+                for (size_t i = 0; i < n_points; i++) {
+                    // Make sure the last point is exactly at the upper bound
+                    double x = (i == n_points - 1) ? pdf.xMax() : std::exp(log_x_min + i * step);
+                    values[flavour][i] = pdf.xfxQ2(pdg_id, x, q2);
+                }
+            }
+        }
+
+        bool inRange(double log_x) const {
+            return log_x >= log_x_min && log_x <= log_x_max;
+        }
+
+        /// \f$x f(x)\f$ for a flavour index given by pdfFlavourIndex()
+        double xfx(size_t flavour, double log_x) const {
+            const auto& f = values[flavour];
+
+            double u = (log_x - log_x_min) / step;
+            size_t i = std::min(static_cast<size_t>(u), n_points - 2);
+            double t = u - i;
+
+            double p0 = f[(i == 0) ? 0 : i - 1];
+            double p1 = f[i];
+            double p2 = f[i + 1];
+            double p3 = f[std::min(i + 2, n_points - 1)];
+
+            return p1 + 0.5 * t * (p2 - p0 + t * (2 * p0 - 5 * p1 + 4 * p2 - p3 + t * (3 * (p1 - p2) + p3 - p0)));
+        }
+
+    private:
+        size_t n_points;
+        double log_x_min;
+        double log_x_max;
+        double step;
+        std::vector<double> values[N_PDF_FLAVOURS];
+};
+
+}
+
 /** \brief Compute the integrand: matrix element, PDFs, jacobians
  *
  * ### Summary
@@ -70,6 +148,10 @@
  *    - \f$f(i, x^j, Q_f^2)\f$ is the PDF of parton flavour \f$i\f$ evaluated on the initial particles' Björken-\f$x\f$ and using factorisation scale \f$Q_f\f$.
  *    - \f$\left| \mathcal{M}(i_1, i_2, j) \right|^2\f$ is the matrix element squared evaluated on all the particles' momenta in the event, for solution \f$j\f$. Along with the PDFs, a sum is done over all the initial parton flavours \f$i_1, i_2\f$ defined by the matrix element.
  *
+ * The jacobians are multiplicative factors of all the outputs: if any of them is exactly zero (for instance a binned
+ * transfer function evaluated outside of its support, or an underflowing Breit-Wigner jacobian), the outputs are set to
+ * zero without evaluating the matrix element and the PDFs.
+ *
  * ### Expected parameter sets
  *
  * Some inputs expected by this module are not simple parameters, but sets of parameters and input tags. These are used for:
@@ -110,9 +192,54 @@
  * ```
  * means that the particle vector corresponds to (electron, positron), while the matrix element expects to be given first the positron, then the electron.
  *
+ * ### PDFs
+ *
+ * For each phase-space point, the PDF of each flavour is evaluated only once for each initial parton, even if it's
+ * needed for several initial states. Since the factorisation scale is fixed, the PDFs can also be tabulated once in
+ * \f$x\f$ by setting `pdf_grid_points`. A few thousand points are typically enough to reproduce LHAPDF to a relative
+ * precision of \f$10^{-6}\f$ or better, much smaller than the uncertainties of the PDF themselves. Values of \f$x\f$
+ * outside the range of the PDF set are still evaluated by LHAPDF.
+ *
+ * ### PDF and scale variations
+ *
+ * The matrix element does not depend on the PDFs, so the integrand can be computed for several PDF set members or
+ * factorisation scales from a single evaluation of the matrix element. The `variations` output first holds the
+ * integrand computed with the central member and the factorisation scale multiplied by each factor of
+ * `pdf_scale_variations`. If `pdf_members` is true, the integrand computed with each member of the PDF set follows, in
+ * order, starting with the central member. Each entry can be declared as an additional integrand component, e.g.
+ * ```
+ * integrand("integrand::sum", "variations::sum/1", "variations::sum/2")
+ * ```
+ * where `variations` is a `VectorLooperSummer` module summing `ttbar::variations` over the solutions. All the
+ * components are then integrated in the same pass. The variations are always evaluated using LHAPDF directly, even if
+ * `pdf_grid_points` is set.
+ *
+ * ### Helicities
+ *
+ * By default, the matrix element is summed over all the helicity combinations. Combinations found to vanish are
+ * skipped afterwards, until the beginning of the next integration where they are all tried again. Set `reset_helicities`
+ * to false to keep them across events. If `helicities_file` is set, the non-vanishing combinations are read from this
+ * file when it exists, kept across events, and written back to the file at the end of the run, so that they are only
+ * discovered once.
+ *
+ * Instead of summing over all the helicity combinations, a single one can be sampled for each phase-space point by
+ * setting the `helicity_ps_point` input. This adds a dimension to the integration, but only one combination is
+ * evaluated for each point instead of all of them. Adaptive algorithms like Vegas will importance-sample the
+ * combinations contributing the most. The first point of each integration is still summed over all the combinations,
+ * to discover the vanishing ones, unless they were read from `helicities_file` or kept from the previous event. This is
+ * only supported by matrix elements implementing `momemta::MatrixElement::computeSampledHelicity`; other matrix
+ * elements keep summing over all the combinations.
+ *
+ * ### Evaluation by batches
+ *
+ * When the phase-space points are evaluated by batches (see the `n_vec` cuba option), the matrix element is evaluated
+ * for all the points of the batch at once using `momemta::MatrixElement::computeBatch`, unless `helicity_ps_point` is
+ * set. This only applies if the module is not inside the path of a Looper: such modules are executed one point at a
+ * time.
+ *
  * ### Integration dimension
  *
- * This module requires **0** phase-space point.
+ * This module requires **0** phase-space point, or **1** if `helicity_ps_point` is set.
  *
  * ### Global Parameters
  *
@@ -127,9 +254,14 @@
  *   | `use_pdf` | bool, default true | Evaluate PDFs and use them in the integrand. |
  *   | `pdf` | string | Name of the LHAPDF set to be used (see [full list](https://lhapdf.hepforge.org/pdfsets.html)). |
  *   | `pdf_scale` | double | Factorisation scale used when evaluating the PDFs. |
+ *   | `pdf_grid_points` | int, default 0 | If positive, tabulate the PDFs once on a grid of this many points uniform in \f$\log x\f$, and interpolate them instead of calling LHAPDF for each point (see below). |
+ *   | `pdf_members` | bool, default false | Compute the integrand for each member of the PDF set in the `variations` output (see below). |
+ *   | `pdf_scale_variations` | vector(double) (optional) | Compute the integrand for each of these factors multiplying `pdf_scale` in the `variations` output (see below). |
  *   | `matrix_element` | string | Name of the matrix element to be used. |
  *   | `matrix_element_parameters` | ParameterSet | Set of parameters passed to the matrix element (see above explanation). |
  *   | `override_parameters` | ParameterSet (optional) | Overrides the value of the ME parameters (usually those specified in the param card) by the ones specified. |
+ *   | `reset_helicities` | bool, default true | Try again all the helicity combinations at the beginning of each integration (see above). |
+ *   | `helicities_file` | string (optional) | File used to persist the non-vanishing helicity combinations across runs (see above). |
  *
  * ### Inputs
  *
@@ -138,12 +270,14 @@
  *   | `initialState` | vector(vector(LorentzVector)) | Sets of initial parton 4-momenta (one pair per invisibles' solution), typically coming from a BuildInitialState module. |
  *   | `particles` | ParameterSet | Set of parameters defining the particles (see above explanation). |
  *   | `jacobians` | vector(double) | All jacobians defined in the integration (transfer functions, generators, blocks...). |
+ *   | `helicity_ps_point` | double (optional) | Phase-space point generated by CUBA, used to sample the helicity combination (see above). |
  *
  * ### Outputs
  *
  *   | Name | Type | %Description |
  *   |------|------|--------------|
- *   | `integrands` | vector(double) | Vector of integrands (one per invisibles' solution). All entries in this vector will be summed by MoMEMta to define the final integrand used by Cuba to compute the integral. |
+ *   | `output` | double | Value of the integrand. |
+ *   | `variations` | vector(double) | Value of the integrand for each PDF and scale variation, if any (see above). |
  *
  * \ingroup modules
  */
@@ -204,6 +338,21 @@ class MatrixElement: public Module {
 
                 p->cacheParameters();
                 p->cacheCouplings();
+                p->updateParameters();
+                p->updateCouplings();
+            }
+
+            // Helicities
+            reset_helicities = parameters.get<bool>("reset_helicities", true);
+            if (parameters.exists("helicities_file")) {
+                helicities_file = parameters.get<std::string>("helicities_file");
+                reset_helicities = false;
+                loadHelicities();
+            }
+
+            sample_helicity = parameters.exists("helicity_ps_point");
+            if (sample_helicity) {
+                m_helicity_ps_point = get<double>(parameters.get<InputTag>("helicity_ps_point"));
             }
 
             // PDF, if asked
@@ -211,55 +360,219 @@ class MatrixElement: public Module {
                 // Silence LHAPDF
                 LHAPDF::setVerbosity(0);
 
+                // LHAPDF does not guarantee that a PDF can be evaluated from several threads at once: each instance
+                // loads its own, instead of sharing it with the other instances
                 std::string pdf = parameters.get<std::string>("pdf");
                 m_pdf.reset(LHAPDF::mkPDF(pdf, 0));
 
                 double pdf_scale = parameters.get<double>("pdf_scale");
                 pdf_scale_squared = SQ(pdf_scale);
+
+                int64_t pdf_grid_points = parameters.get<int64_t>("pdf_grid_points", 0);
+                if (pdf_grid_points == 1 || pdf_grid_points < 0) {
+                    LOG(fatal) << "Invalid number of points for the PDF grid: " << pdf_grid_points
+                               << ". It must be either 0 (no grid) or at least 2.";
+
+                    throw Module::invalid_configuration("Invalid number of points for the PDF grid");
+                }
+
+                if (pdf_grid_points > 0) {
+                    // Grids are only read: share them between all the instances using the same one
+                    std::ostringstream key;
+                    key.precision(17);
+                    key << pdf << ":" << pdf_scale_squared << ":" << pdf_grid_points;
+
+                    const auto& pdf_set = *m_pdf;
+                    double q2 = pdf_scale_squared;
+                    m_pdf_grid = momemta::SharedResources<PdfGrid>::get(key.str(), [&pdf_set, q2, pdf_grid_points]() {
+                        return std::make_shared<PdfGrid>(pdf_set, q2, pdf_grid_points);
+                    });
+                }
+
+                if (parameters.exists("pdf_scale_variations")) {
+                    for (double factor: parameters.get<std::vector<double>>("pdf_scale_variations")) {
+                        if (factor <= 0) {
+                            LOG(fatal) << "Invalid factor for the factorisation scale variations: " << factor
+                                       << ". Factors must be positive.";
+
+                            throw Module::invalid_configuration("Invalid factor for the factorisation scale variations");
+                        }
+
+                        PdfVariation variation;
+                        variation.pdf = m_pdf;
+                        variation.scale_squared = SQ(factor * pdf_scale);
+                        m_pdf_variations.push_back(variation);
+                    }
+                }
+
+                if (parameters.get<bool>("pdf_members", false)) {
+                    size_t n_members = LHAPDF::PDFSet(pdf).size();
+                    for (size_t member = 0; member < n_members; member++) {
+                        PdfVariation variation;
+                        variation.scale_squared = pdf_scale_squared;
+                        if (member == 0) {
+                            variation.pdf = m_pdf;
+                        } else {
+                            variation.pdf.reset(LHAPDF::mkPDF(pdf, member));
+                        }
+
+                        m_pdf_variations.push_back(variation);
+                    }
+                }
+
+                m_variations->resize(m_pdf_variations.size());
             }
 
-            // Prepare arrays for sorting particles
+            // Order the particles as expected by the matrix element, once and for all
+            std::vector<int> pdg_ids(m_particles_ids.size());
+            m_me_particles.resize(m_particles_ids.size());
+            std::vector<bool> filled(m_particles_ids.size(), false);
             for (size_t i = 0; i < m_particles_ids.size(); i++) {
-                indexing.push_back(m_particles_ids[i].me_index - 1);
+                int64_t index = m_particles_ids[i].me_index - 1;
+                if (index < 0 || index >= (int64_t) m_particles_ids.size() || filled[index]) {
+                    LOG(fatal) << "Invalid matrix element index for particle " << i << ": " <<
+                               m_particles_ids[i].me_index << ". Indices must be unique, and between 1 and the number of"
+                                       " particles.";
+
+                    throw Module::invalid_configuration("Invalid matrix element index");
+                }
+
+                filled[index] = true;
+                pdg_ids[index] = m_particles_ids[i].pdg_id;
+                m_me_particles[index] = m_particles[i];
             }
 
-            // Pre-allocate memory for the finalState array
-            finalState.resize(m_particles_ids.size());
+            m_me_pdg_ids = pdg_ids;
+            m_final_state = m_ME->resolveFinalState(pdg_ids);
+            if (m_final_state < 0) {
+                LOG(fatal) << "The final state of the particles is not defined by matrix element " << matrix_element
+                           << ". Check the PDG ids of the particles.";
 
-            // Sort the array taking into account the indexing in the configuration
-            std::vector<int64_t> suite(indexing.size());
-            std::iota(suite.begin(), suite.end(), 0);
+                throw Module::invalid_configuration("Unknown final state for the matrix element");
+            }
 
-            permutations = get_permutations(suite, indexing);
+            // Momenta are copied in these arrays before evaluating the matrix element
+            m_final_momenta.resize(m_me_particles.size());
+            for (const auto& momentum: m_final_momenta)
+                m_final_momenta_ptr.push_back(momentum.data());
         };
 
         virtual void beginIntegration() {
             // Don't assume the non-zero helicities will be the same for each event
             // In principle they are, but this protects against buggy calls to the ME (e.g. returning NaN or inf)
-            m_ME->resetHelicities();
+            if (reset_helicities)
+                m_ME->resetHelicities();
+        }
+
+        virtual void finish() override {
+            if (!helicities_file.empty())
+                saveHelicities();
         }
 
         virtual Status work() override {
-            static std::vector<LorentzVector> empty_vector;
+            // The integrand vanishes if any of the jacobians does: don't evaluate the matrix element and PDFs
+            if (hasVanishingJacobian()) {
+                setVanishingIntegrand();
+                return Status::OK;
+            }
 
-            *m_integrand = 0;
             const std::vector<LorentzVector>& partons = *m_partons;
 
-            LorentzVectorRefCollection particles;
-            for (const auto& p: m_particles)
-                particles.push_back(std::ref(*p));
+            setMomentum(partons[0], m_initial_momenta[0]);
+            setMomentum(partons[1], m_initial_momenta[1]);
+            const double* initial_momenta[2] = { m_initial_momenta[0], m_initial_momenta[1] };
 
-            for (size_t i = 0; i < m_particles_ids.size(); i++) {
-                finalState[i] = std::make_pair(m_particles_ids[i].pdg_id, toVector(particles[i].get()));
+            for (size_t i = 0; i < m_me_particles.size(); i++)
+                setMomentum(*m_me_particles[i], m_final_momenta[i].data());
+
+            if (sample_helicity)
+                m_ME->computeSampledHelicityFlat(m_final_state, initial_momenta, m_final_momenta_ptr.data(),
+                                                 *m_helicity_ps_point, m_result);
+            else
+                m_ME->computeFlat(m_final_state, initial_momenta, m_final_momenta_ptr.data(), m_result);
+
+            computeIntegrand();
+
+            return Status::OK;
+        }
+
+        /**
+         * \brief Evaluate the matrix element for all the points of the batch at once
+         *
+         * The momenta of the points are collected and given to momemta::MatrixElement::computeBatch(), which may
+         * evaluate several points at once using SIMD instructions. Helicity sampling is only implemented point by
+         * point: if `helicity_ps_point` is set, the points are evaluated one by one.
+         */
+        virtual void work_batch(Batch& batch) override {
+            if (sample_helicity) {
+                Module::work_batch(batch);
+                return;
+            }
+
+            m_batch_points.clear();
+            m_batch_initial_momenta.clear();
+            m_batch_final_states.clear();
+
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                if (batch.status(i) != Status::OK)
+                    continue;
+
+                batch.load(i);
+
+                if (hasVanishingJacobian()) {
+                    setVanishingIntegrand();
+                    batch.store(i);
+                    continue;
+                }
+
+                const std::vector<LorentzVector>& partons = *m_partons;
+                m_batch_initial_momenta.push_back({toMomentum(partons[0]), toMomentum(partons[1])});
+
+                std::vector<std::pair<int, std::vector<double>>> final_state;
+                for (size_t p = 0; p < m_me_particles.size(); p++)
+                    final_state.push_back({m_me_pdg_ids[p], toMomentum(*m_me_particles[p])});
+                m_batch_final_states.push_back(std::move(final_state));
+
+                m_batch_points.push_back(i);
+            }
+
+            if (m_batch_points.empty())
+                return;
+
+            auto results = m_ME->computeBatch(m_batch_initial_momenta, m_batch_final_states);
+
+            // Inputs are loaded again to apply the PDFs and jacobians of each point
+            for (std::size_t k = 0; k < m_batch_points.size(); k++) {
+                batch.load(m_batch_points[k]);
+
+                m_result.clear();
+                for (const auto& result: results[k])
+                    m_result.push_back(result.first, result.second);
+
+                computeIntegrand();
+
+                batch.store(m_batch_points[k]);
+            }
+        }
+
+    private:
+        bool hasVanishingJacobian() const {
+            for (const auto& jacobian: m_jacobians) {
+                if (*jacobian == 0)
+                    return true;
             }
 
-            // Sort the array taking into account the indexing in the configuration
-            apply_permutations(finalState, permutations);
+            return false;
+        }
 
-            std::pair<std::vector<double>, std::vector<double>> initialState { toVector(partons[0]),
-                                                                               toVector(partons[1]) };
+        void setVanishingIntegrand() {
+            *m_integrand = 0;
+            std::fill(m_variations->begin(), m_variations->end(), 0.);
+        }
 
-            auto result = m_ME->compute(initialState, finalState);
+        /// Apply the flux factor, jacobians and PDFs to the matrix element in #m_result, and set the outputs
+        void computeIntegrand() {
+            const std::vector<LorentzVector>& partons = *m_partons;
 
             double x1 = std::abs(partons[0].Pz() / (sqrt_s / 2.));
             double x2 = std::abs(partons[1].Pz() / (sqrt_s / 2.));
@@ -273,53 +586,234 @@ class MatrixElement: public Module {
             }
 
             // PDF
-            double final_integrand = 0;
-            for (const auto& me: result) {
-                double pdf1 = use_pdf ? m_pdf->xfxQ2(me.first.first, x1, pdf_scale_squared) / x1 : 1;
-                double pdf2 = use_pdf ? m_pdf->xfxQ2(me.first.second, x2, pdf_scale_squared) / x2 : 1;
+            double log_x1 = 0;
+            double log_x2 = 0;
+            if (m_pdf_grid) {
+                log_x1 = std::log(x1);
+                log_x2 = std::log(x2);
+            }
 
-                final_integrand += me.second * pdf1 * pdf2;
+            if (use_pdf) {
+                resetPdfCache(m_pdf_cache[0], x1, log_x1);
+                resetPdfCache(m_pdf_cache[1], x2, log_x2);
+            }
+
+            double final_integrand = 0;
+            for (size_t i = 0; i < m_result.size; i++) {
+                const auto& initial_state = m_result.initialStates[i];
+                double pdf1 = use_pdf ? getPdf(m_pdf_cache[0], *m_pdf, m_pdf_grid.get(), pdf_scale_squared,
+                                               initial_state.first) : 1;
+                double pdf2 = use_pdf ? getPdf(m_pdf_cache[1], *m_pdf, m_pdf_grid.get(), pdf_scale_squared,
+                                               initial_state.second) : 1;
+
+                final_integrand += m_result.values[i] * pdf1 * pdf2;
             }
 
             final_integrand *= integrand;
             *m_integrand = final_integrand;
 
-            return Status::OK;
+            // PDF and scale variations, reusing the matrix element
+            for (size_t v = 0; v < m_pdf_variations.size(); v++) {
+                auto& variation = m_pdf_variations[v];
+                resetPdfCache(variation.cache[0], x1, log_x1);
+                resetPdfCache(variation.cache[1], x2, log_x2);
+
+                double variation_integrand = 0;
+                for (size_t i = 0; i < m_result.size; i++) {
+                    const auto& initial_state = m_result.initialStates[i];
+                    double pdf1 = getPdf(variation.cache[0], *variation.pdf, nullptr, variation.scale_squared,
+                                         initial_state.first);
+                    double pdf2 = getPdf(variation.cache[1], *variation.pdf, nullptr, variation.scale_squared,
+                                         initial_state.second);
+
+                    variation_integrand += m_result.values[i] * pdf1 * pdf2;
+                }
+
+                (*m_variations)[v] = variation_integrand * integrand;
+            }
+        }
+
+        /// PDF values for one of the initial partons, evaluated at most once per flavour for each point
+        struct PdfCache {
+            double x;
+            double log_x;
+            bool cached[N_PDF_FLAVOURS];
+            double values[N_PDF_FLAVOURS];
+        };
+
+        /// A member of the PDF set evaluated at a given factorisation scale
+        struct PdfVariation {
+            std::shared_ptr<const LHAPDF::PDF> pdf;
+            double scale_squared;
+            PdfCache cache[2];
+        };
+
+        static void resetPdfCache(PdfCache& cache, double x, double log_x) {
+            cache.x = x;
+            cache.log_x = log_x;
+            std::fill(cache.cached, cache.cached + N_PDF_FLAVOURS, false);
+        }
+
+        /**
+         * \brief \f$f(x)\f$ for a parton flavour, using the cache
+         *
+         * \p grid, if not null, must tabulate \p pdf at the scale \p q2.
+         */
+        static double getPdf(PdfCache& cache, const LHAPDF::PDF& pdf, const PdfGrid* grid, double q2, int pdg_id) {
+            int index = pdfFlavourIndex(pdg_id);
+            if (index < 0)
+                return pdf.xfxQ2(pdg_id, cache.x, q2) / cache.x;
+
+            if (!cache.cached[index]) {
+                double xfx = (grid && grid->inRange(cache.log_x)) ?
+                             grid->xfx(index, cache.log_x) :
+                             pdf.xfxQ2(pdg_id, cache.x, q2);
+
+                cache.values[index] = xfx / cache.x;
+                cache.cached[index] = true;
+            }
+
+            return cache.values[index];
+        }
+
+        /// Copy a 4-momentum in the layout expected by the matrix element: (E, px, py, pz)
+        static void setMomentum(const LorentzVector& p4, double* momentum) {
+            momentum[0] = p4.E();
+            momentum[1] = p4.Px();
+            momentum[2] = p4.Py();
+            momentum[3] = p4.Pz();
+        }
+
+        /// Same as setMomentum(), for momemta::MatrixElement::computeBatch()
+        static std::vector<double> toMomentum(const LorentzVector& p4) {
+            return { p4.E(), p4.Px(), p4.Py(), p4.Pz() };
+        }
+
+        /**
+         * \brief Read the non-vanishing helicity combinations from #helicities_file
+         *
+         * The file contains one line per sub-process of the matrix element, with one character ('0' or '1') per
+         * helicity combination. Nothing is done if the file does not exist yet.
+         */
+        void loadHelicities() {
+            std::ifstream file(helicities_file);
+            if (!file.is_open()) {
+                LOG(debug) << "[MatrixElement] Helicities file " << helicities_file << " does not exist yet.";
+                return;
+            }
+
+            momemta::MatrixElement::HelicityTable table;
+            std::string line;
+            while (std::getline(file, line)) {
+                if (line.empty())
+                    continue;
+
+                std::vector<bool> helicities;
+                for (char c: line)
+                    helicities.push_back(c == '1');
+                table.push_back(helicities);
+            }
+
+            if (!m_ME->setGoodHelicities(table)) {
+                LOG(warning) << "[MatrixElement] Helicities read from " << helicities_file
+                             << " do not match the matrix element. Ignoring them.";
+                return;
+            }
+
+            LOG(debug) << "[MatrixElement] Helicities read from " << helicities_file << ".";
+        }
+
+        /// Write the non-vanishing helicity combinations to #helicities_file
+        void saveHelicities() {
+            auto table = m_ME->getGoodHelicities();
+            if (table.empty())
+                return;
+
+            // Several instances may write the same file: write to a temporary file first, and rename it, so that the
+            // file is always complete
+            std::string tmp_file = helicities_file + "." + std::to_string(reinterpret_cast<std::uintptr_t>(this));
+            {
+                std::ofstream file(tmp_file);
+                for (const auto& helicities: table) {
+                    for (bool good: helicities)
+                        file << (good ? '1' : '0');
+                    file << std::endl;
+                }
+
+                if (!file) {
+                    LOG(error) << "[MatrixElement] Failed to write helicities to " << tmp_file << ".";
+                    return;
+                }
+            }
+
+            if (std::rename(tmp_file.c_str(), helicities_file.c_str()) != 0) {
+                LOG(error) << "[MatrixElement] Failed to write helicities to " << helicities_file << ".";
+                std::remove(tmp_file.c_str());
+            }
         }
 
-    private:
         double sqrt_s;
         bool use_pdf;
         double pdf_scale_squared = 0;
         std::shared_ptr<momemta::MatrixElement> m_ME;
-        std::shared_ptr<LHAPDF::PDF> m_pdf;
-
-        std::vector<int64_t> indexing;
-        std::vector<size_t> permutations;
-        std::vector<std::pair<int, std::vector<double>>> finalState;
+        std::shared_ptr<const LHAPDF::PDF> m_pdf;
+        std::shared_ptr<const PdfGrid> m_pdf_grid;
+        PdfCache m_pdf_cache[2];
+        std::vector<PdfVariation> m_pdf_variations;
+
+        // Final state of the matrix element, and buffers passed to it
+        momemta::MatrixElement::FinalStateHandle m_final_state;
+        double m_initial_momenta[2][4];
+        std::vector<std::array<double, 4>> m_final_momenta;
+        std::vector<const double*> m_final_momenta_ptr;
+        momemta::MatrixElement::FlatResult m_result;
+        // PDG ids of the final-state particles, in the order expected by the matrix element
+        std::vector<int> m_me_pdg_ids;
+
+        // Points of the batch for which the matrix element is evaluated, and their momenta
+        std::vector<std::size_t> m_batch_points;
+        std::vector<std::pair<std::vector<double>, std::vector<double>>> m_batch_initial_momenta;
+        std::vector<std::vector<std::pair<int, std::vector<double>>>> m_batch_final_states;
+
+        bool reset_helicities;
+        bool sample_helicity;
+        std::string helicities_file;
 
         // Inputs
         Value<std::vector<LorentzVector>> m_partons;
 
         std::vector<Value<LorentzVector>> m_particles;
+        // Same as m_particles, in the order expected by the matrix element
+        std::vector<Value<LorentzVector>> m_me_particles;
         std::vector<ParticleId> m_particles_ids;
 
         std::vector<Value<double>> m_jacobians;
 
+        Value<double> m_helicity_ps_point;
+
         // Outputs
         std::shared_ptr<double> m_integrand = produce<double>("output");
+        std::shared_ptr<std::vector<double>> m_variations = produce<std::vector<double>>("variations");
 };
 
 REGISTER_MODULE(MatrixElement)
         .Input("initialState")
         .OptionalInputs("jacobians")
+        .OptionalInput("helicity_ps_point")
         .Inputs("particles/inputs")
         .Output("output")
+        .Output("variations")
         .GlobalAttr("energy:double")
         .Attr("matrix_element:string")
         .Attr("matrix_element_parameters:pset")
         .OptionalAttr("override_parameters:pset")
+        .Attr("reset_helicities:bool=true")
+        .OptionalAttr("helicities_file:string")
         .Attr("particles:pset")
         .Attr("use_pdf:bool=true")
         .OptionalAttr("pdf:string")
-        .OptionalAttr("pdf_scale:double");
+        .OptionalAttr("pdf_scale:double")
+        .Attr("pdf_grid_points:int=0")
+        .Attr("pdf_members:bool=false")
+        .OptionalAttr("pdf_scale_variations:list(double)")
+        .Cost(100);
@@ -166,8 +166,9 @@ class SecondaryBlockA: public Module {
             const double Bz = ((a12 * a21 - a11 * a22) * c3 - (a12 * a31 - a11 * a32) * c2  + (a22 * a31 - a21 * a32) * c1) * inv_det;
 
             // Now the mass-shell condition for p1 gives a quadratic equation in E1 with up to two solutions
-            std::vector<double> E1_sol;
+            QuadraticRoots E1_sol;
             bool foundSolution = solveQuadratic(SQ(Ax) + SQ(Ay) + SQ(Az) - 1, 2 * (Ax * Bx + Ay * By + Az * Bz), SQ(Bx) + SQ(By) + SQ(Bz) + sq_m1, E1_sol);
+            removeDuplicateRoots(E1_sol);
 
             if (!foundSolution)
                 return Status::NEXT;
@@ -258,4 +259,5 @@ REGISTER_MODULE(SecondaryBlockA)
         .Input("p4")
         .Output("solutions")
         .GlobalAttr("energy: double")
-        .Attr("m1: double=0");
+        .Attr("m1: double=0")
+        .Filter();
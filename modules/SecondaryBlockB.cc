@@ -139,8 +139,9 @@ class SecondaryBlockB: public Module {
             const double E1_linear = 2 * (p1t_indep * p1t_linear + p1z_indep * p1z_linear);
             const double E1_quadratic = -1 + p1t_linear_squared + p1z_linear_squared;
 
-            std::vector<double> E1_solutions; // up to two solutions
+            QuadraticRoots E1_solutions; // up to two solutions
             bool foundSolution = solveQuadratic(E1_quadratic, E1_linear, E1_indep, E1_solutions);
+            removeDuplicateRoots(E1_solutions);
             if (!foundSolution)
                 return Status::NEXT;
 
@@ -215,4 +216,5 @@ REGISTER_MODULE(SecondaryBlockB)
         .Input("p2")
         .Input("p3")
         .Output("solutions")
-        .GlobalAttr("energy: double");
+        .GlobalAttr("energy: double")
+        .Filter();
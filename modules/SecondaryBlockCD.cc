@@ -92,7 +92,7 @@ class SecondaryBlockCD: public Module {
             if (*s12 >= SQ(sqrt_s) || sq_m1 + sq_m2 >= *s12)
                return Status::NEXT;
 
-            std::vector<double> E1_solutions; // up to two solutions
+            QuadraticRoots E1_solutions; // up to two solutions
             const double theta1 = p1->Theta();
             const double phi1 = p1->Phi();
 
@@ -107,6 +107,7 @@ class SecondaryBlockCD: public Module {
             const double indepTerm = SQ(sq_m1 + sq_m2 - *s12) + 4 * sq_m1 * SQ(norm2) * SQ(cos_theta12);
 
             bool foundSolution = solveQuadratic(quadraticTerm, linearTerm, indepTerm, E1_solutions);
+            removeDuplicateRoots(E1_solutions);
 
             if (!foundSolution) {
                 return Status::NEXT;
@@ -174,4 +175,5 @@ REGISTER_MODULE(SecondaryBlockCD)
         .Input("p1")
         .Input("p2")
         .Output("solutions")
-        .GlobalAttr("energy: double");
+        .GlobalAttr("energy: double")
+        .Filter();
@@ -111,10 +111,11 @@ class SecondaryBlockE: public Module {
             double X = p3 * c23 - E3;
             double Y = *s123 - *s12 - sq_m3;
 
-            std::vector<double> abs_p1, abs_p2;
+            QuarticRoots abs_p1, abs_p2;
             solve2Quads(SQ(X), SQ(p3 * c13) - sq_E3, 2 * p3 * c13 * X,  X * Y, p3 * c13 * Y, 0.25 * SQ(Y) - sq_E3 * sq_m1,
                         2 * X / E3, 0, 2 * (p3 * c13 / E3 - c12), Y / E3, 0, sq_m1 - *s12,
                         abs_p2, abs_p1);
+            removeDuplicateSolutions(abs_p2, abs_p1);
 
             // Use now the obtained |p1| and |p2| solutions to build p1 and p2 (m2=0!)
             for (std::size_t i = 0; i < abs_p1.size(); i++) {
@@ -205,4 +206,5 @@ REGISTER_MODULE(SecondaryBlockE)
         .Input("p2")
         .Input("p3")
         .Output("solutions")
-        .GlobalAttr("energy: double");
+        .GlobalAttr("energy: double")
+        .Filter();
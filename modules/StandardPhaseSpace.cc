@@ -21,12 +21,16 @@
 #include <momemta/ParameterSet.h>
 #include <momemta/Types.h>
 
+#include <FourVector.h>
+
 /** \brief Compute the phase space density for observed particles (not concerned by the change of variable)
  *
  * \f[
  *  d\Phi = \prod_{i \in \text{vis.}} \frac{\left|p_i\right|^2 \sin(\theta_i)}{2 E_i(2\pi)^3}
  * \f]
  *
+ * Since \f$\left|p_i\right| \sin(\theta_i) = p_{T,i}\f$, each factor is computed as \f$\left|p_i\right| p_{T,i} / (2 E_i(2\pi)^3)\f$,
+ * without any trigonometric function.
  *
  * ### Integration dimension
  *
@@ -53,13 +57,25 @@ class StandardPhaseSpace: public Module {
             std::vector<InputTag> input_particles_tags = parameters.get<std::vector<InputTag>>("particles");
             for (auto& t: input_particles_tags)
                 input_particles.push_back(get<LorentzVector>(t));
+
+            m_momenta.resize(input_particles.size());
+            m_P2.resize(input_particles.size());
+            m_Pt2.resize(input_particles.size());
         };
 
         virtual Status work() override {
 
+            const std::size_t n = input_particles.size();
+            for (std::size_t i = 0; i < n; i++)
+                m_momenta.set(i, *input_particles[i]);
+
+            m_momenta.P2(m_P2.data());
+            m_momenta.Pt2(m_Pt2.data());
+            const double* E = m_momenta.E();
+
             *phase_space = 1;
-            for (const auto& p: input_particles) {
-                *phase_space *= SQ(p->P()) * sin(p->Theta()) / (2.0 * p->E() * CB(2. * M_PI));
+            for (std::size_t i = 0; i < n; i++) {
+                *phase_space *= std::sqrt(m_P2[i] * m_Pt2[i]) / (2.0 * E[i] * CB(2. * M_PI));
             }
 
             return Status::OK;
@@ -70,6 +86,10 @@ class StandardPhaseSpace: public Module {
         // Inputs
         std::vector<Value<LorentzVector>> input_particles;
 
+        momemta::FourVectors m_momenta;
+        std::vector<double> m_P2;
+        std::vector<double> m_Pt2;
+
         // Outputs
         std::shared_ptr<double> phase_space = produce<double>("phase_space");
 };
@@ -0,0 +1,152 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2016  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Parallel computation of weights integration test
+ * \ingroup IntegrationTests
+ */
+
+#include <catch.hpp>
+
+#include <thread>
+
+#include <momemta/ConfigurationReader.h>
+#include <momemta/Logging.h>
+#include <momemta/MatrixElement.h>
+#include <momemta/MatrixElementFactory.h>
+#include <momemta/MoMEMta.h>
+#include <momemta/ParameterSet.h>
+
+
+using namespace momemta;
+
+TEST_CASE("Parallel computation of weights", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    ConfigurationReader configuration("no_integration.lua");
+    MoMEMta weight(configuration.freeze());
+
+    std::vector<Event> events;
+    for (size_t i = 0; i < 32; i++) {
+        // Slightly change the energy of the b-quarks for each event
+        double factor = 1 + 0.01 * i;
+
+        // Electron
+        Particle electron { "electron", LorentzVector(16.171895980835, -13.7919054031372, -3.42997527122497, 21.5293197631836), -11 };
+        // b-quark
+        Particle bjet1 { "bjet1", LorentzVector(-55.7908325195313, -111.59294128418, -122.144721984863, 174.66259765625 * factor), 5 };
+        // Muon
+        Particle muon { "muon", LorentzVector(-18.9018573760986, 10.0896110534668, -0.602926552295686, 21.4346446990967), +13 };
+        // Anti b-quark
+        Particle bjet2 { "bjet2", LorentzVector(71.3899612426758, 96.0094833374023, -77.2513122558594, 142.492813110352 * factor), -5 };
+        // Electronic neutrino
+        Particle nu1 { "neutrino1", LorentzVector(-57.9413, 40.7629, -54.2982, 89.2587), +12 };
+        // Muonic neutrino
+        Particle nu2 { "neutrino2", LorentzVector(57.9413, -40.7629, -40.8437, 81.7742), -14 };
+
+        events.push_back({{electron, muon, bjet1, bjet2, nu1, nu2}, LorentzVector()});
+    }
+
+    auto batch_weights = weight.computeWeightsBatch(events, 4);
+
+    REQUIRE(weight.getIntegrationStatus() == MoMEMta::IntegrationStatus::SUCCESS);
+    REQUIRE(batch_weights.size() == events.size());
+
+    for (size_t i = 0; i < events.size(); i++) {
+        auto weights = weight.computeWeights(events[i].particles, events[i].met);
+
+        REQUIRE(batch_weights[i].size() == 1);
+        REQUIRE(batch_weights[i][0].first == weights[0].first);
+    }
+
+    SECTION("Vegas grids cannot be shared by several threads") {
+        ConfigurationReader grid_configuration("no_integration.lua");
+        grid_configuration.getCubaConfiguration().set("grid_file", std::string("grid.state"));
+        MoMEMta grid_weight(grid_configuration.freeze());
+
+        REQUIRE_THROWS_AS(grid_weight.computeWeightsBatch(events, 4), std::runtime_error);
+
+        auto weights = grid_weight.computeWeightsBatch({events[0]}, 4);
+        REQUIRE(weights.size() == 1);
+    }
+}
+
+TEST_CASE("Evaluation of a matrix element from several threads", "[integration_tests]") {
+    ParameterSet configuration;
+    configuration.set("card", "../../MatrixElements/Cards/param_card.dat");
+
+    using Momentum = std::vector<double>;
+    using InitialState = std::pair<Momentum, Momentum>;
+    using FinalState = std::vector<std::pair<int, Momentum>>;
+
+    const size_t n_points = 32;
+
+    std::vector<InitialState> initialStates;
+    std::vector<FinalState> finalStates;
+    for (size_t i = 0; i < n_points; i++) {
+        // Slightly change the energy of the b-quarks for each point
+        double factor = 1 + 0.01 * i;
+
+        FinalState finalState = {
+                {-13, {21.5293197631836, 16.171895980835, -13.7919054031372, -3.42997527122497}},
+                {14, {89.2587, -57.9413, 40.7629, -54.2982}},
+                {5, {174.66259765625 * factor, -55.7908325195313, -111.59294128418, -122.144721984863}},
+                {13, {21.4346446990967, -18.9018573760986, 10.0896110534668, -0.602926552295686}},
+                {-14, {81.7742, 57.9413, -40.7629, -40.8437}},
+                {-5, {142.492813110352 * factor, 71.3899612426758, 96.0094833374023, -77.2513122558594}}
+        };
+
+        double E = 0, pz = 0;
+        for (const auto& p: finalState) {
+            E += p.second[0];
+            pz += p.second[3];
+        }
+
+        initialStates.push_back({{(E + pz) / 2, 0, 0, (E + pz) / 2}, {(E - pz) / 2, 0, 0, -(E - pz) / 2}});
+        finalStates.push_back(finalState);
+    }
+
+    std::vector<MatrixElement::Result> expected;
+    auto reference = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+    for (size_t i = 0; i < n_points; i++)
+        expected.push_back(reference->compute(initialStates[i], finalStates[i]));
+
+    // A single instance, evaluated concurrently while it discovers the vanishing helicity combinations
+    auto me = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+
+    std::vector<MatrixElement::Result> results[2];
+    auto evaluate = [&](size_t thread) {
+        for (size_t i = 0; i < n_points; i++) {
+            // Each thread goes through the points in a different order
+            size_t point = (thread == 0) ? i : n_points - 1 - i;
+            results[thread].push_back(me->compute(initialStates[point], finalStates[point]));
+        }
+    };
+
+    std::thread other(evaluate, 1);
+    evaluate(0);
+    other.join();
+
+    REQUIRE(me->getGoodHelicities() == reference->getGoodHelicities());
+
+    for (size_t i = 0; i < n_points; i++) {
+        REQUIRE(results[0][i] == expected[i]);
+        REQUIRE(results[1][n_points - 1 - i] == expected[i]);
+    }
+}
@@ -30,25 +30,209 @@
 
 using namespace momemta;
 
+/// The event used by all the tests: two leptons and two b-jets from a fully leptonic ttbar decay
+static std::vector<Particle> test_event() {
+    return {
+        // Electron
+        { "electron", LorentzVector(16.171895980835, -13.7919054031372, -3.42997527122497, 21.5293197631836), -11 },
+        // Muon
+        { "muon", LorentzVector(-18.9018573760986, 10.0896110534668, -0.602926552295686, 21.4346446990967), +13 },
+        // b-quark
+        { "bjet1", LorentzVector(-55.7908325195313, -111.59294128418, -122.144721984863, 174.66259765625), 5 },
+        // Anti b-quark
+        { "bjet2", LorentzVector(71.3899612426758, 96.0094833374023, -77.2513122558594, 142.492813110352), -5 }
+    };
+}
+
 TEST_CASE("Integrand evaluation", "[integration_tests]") {
     logging::set_level(logging::level::fatal);
 
     ConfigurationReader configuration("integrand.lua");
     MoMEMta weight(configuration.freeze());
 
-    // Electron
-    Particle electron { "electron", LorentzVector(16.171895980835, -13.7919054031372, -3.42997527122497, 21.5293197631836), -11 };
-    // b-quark
-    Particle bjet1 { "bjet1", LorentzVector(-55.7908325195313, -111.59294128418, -122.144721984863, 174.66259765625), 5 };
-    // Muon
-    Particle muon { "muon", LorentzVector(-18.9018573760986, 10.0896110534668, -0.602926552295686, 21.4346446990967), +13 };
-    // Anti b-quark
-    Particle bjet2 { "bjet2", LorentzVector(71.3899612426758, 96.0094833374023, -77.2513122558594, 142.492813110352), -5 };
-
-    weight.setEvent({electron, muon, bjet1, bjet2});
+    weight.setEvent(test_event());
     std::vector<double> psPoint { 0.25, 0.15, 0.1, 0.4 };
     std::vector<double> weights = weight.evaluateIntegrand(psPoint);
 
     REQUIRE(weights.size() == 1);
     REQUIRE(weights[0] * 1e21 == Approx(6.0072644042));
 }
+
+TEST_CASE("Integrand evaluation by batches", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    ParameterSet parameters;
+    parameters.set("pdf_variations", true);
+
+    ConfigurationReader configuration("integrand.lua", parameters);
+    MoMEMta weight(configuration.freeze());
+
+    weight.setEvent(test_event());
+
+    std::vector<std::vector<double>> psPoints;
+    for (size_t i = 0; i < 16; i++)
+        psPoints.push_back({ 0.05 + 0.06 * i, 0.15, 0.9 - 0.05 * i, 0.4 });
+
+    auto batch_weights = weight.evaluateIntegrandBatch(psPoints);
+    REQUIRE(batch_weights.size() == psPoints.size());
+
+    size_t n_non_zero = 0;
+    for (size_t i = 0; i < psPoints.size(); i++) {
+        std::vector<double> weights = weight.evaluateIntegrand(psPoints[i]);
+
+        REQUIRE(batch_weights[i].size() == 5);
+        for (size_t c = 0; c < weights.size(); c++)
+            REQUIRE(batch_weights[i][c] == weights[c]);
+
+        if (weights[0] != 0)
+            n_non_zero++;
+    }
+
+    REQUIRE(n_non_zero > 0);
+}
+
+TEST_CASE("Matrix element evaluated by batches", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    ConfigurationReader configuration("matrix_element_batch.lua");
+    MoMEMta weight(configuration.freeze());
+
+    std::vector<Particle> event = test_event();
+    // Electronic neutrino
+    event.push_back({ "neutrino1", LorentzVector(-57.9413, 40.7629, -54.2982, 89.2587), +12 });
+    // Muonic neutrino
+    event.push_back({ "neutrino2", LorentzVector(57.9413, -40.7629, -40.8437, 81.7742), -14 });
+
+    weight.setEvent(event);
+
+    // The matrix element module is at the top level: the whole batch is given to MatrixElement::computeBatch()
+    std::vector<std::vector<double>> psPoints;
+    for (size_t i = 0; i < 13; i++)
+        psPoints.push_back({ 0.1 + 0.06 * i, 0.9 - 0.05 * i });
+
+    auto batch_weights = weight.evaluateIntegrandBatch(psPoints);
+    REQUIRE(batch_weights.size() == psPoints.size());
+
+    for (size_t i = 0; i < psPoints.size(); i++) {
+        std::vector<double> weights = weight.evaluateIntegrand(psPoints[i]);
+
+        REQUIRE(weights.size() == 3);
+        REQUIRE(weights[0] != 0);
+        REQUIRE(batch_weights[i].size() == 3);
+
+        // The vectorized matrix element is not bitwise identical to the scalar one
+        for (size_t c = 0; c < weights.size(); c++)
+            REQUIRE(batch_weights[i][c] == Approx(weights[c]).epsilon(1e-10));
+    }
+}
+
+TEST_CASE("Integrand evaluation using a clone", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    ConfigurationReader configuration("integrand.lua");
+    MoMEMta weight(configuration.freeze());
+
+    std::unique_ptr<MoMEMta> clone = weight.clone();
+
+    std::vector<double> psPoint { 0.25, 0.15, 0.1, 0.4 };
+
+    weight.setEvent(test_event());
+    std::vector<double> weights = weight.evaluateIntegrand(psPoint);
+
+    clone->setEvent(test_event());
+    std::vector<double> clone_weights = clone->evaluateIntegrand(psPoint);
+
+    REQUIRE(clone_weights.size() == 1);
+    REQUIRE(clone_weights[0] == weights[0]);
+}
+
+TEST_CASE("Integrand evaluation using bound inputs", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    ConfigurationReader configuration("integrand.lua");
+    MoMEMta weight(configuration.freeze());
+
+    std::vector<Particle> event = test_event();
+    const Particle& electron = event[0];
+    const Particle& muon = event[1];
+    const Particle& bjet1 = event[2];
+    const Particle& bjet2 = event[3];
+
+    std::vector<double> psPoint { 0.25, 0.15, 0.1, 0.4 };
+
+    weight.setEvent(event);
+    std::vector<double> weights = weight.evaluateIntegrand(psPoint);
+
+    SECTION("Inputs must be bound first") {
+        LorentzVector p4s[] = { electron.p4, muon.p4, bjet1.p4, bjet2.p4 };
+        REQUIRE_THROWS(weight.setEvent(p4s, nullptr));
+    }
+
+    SECTION("All the inputs must be bound once") {
+        REQUIRE_THROWS(weight.bindInputs({"electron", "muon", "bjet1"}));
+        REQUIRE_THROWS(weight.bindInputs({"electron", "muon", "bjet1", "bjet1"}));
+        REQUIRE_THROWS(weight.bindInputs({"electron", "muon", "bjet1", "jet"}));
+    }
+
+    SECTION("Bound inputs") {
+        weight.bindInputs({"bjet1", "bjet2", "electron", "muon"});
+
+        LorentzVector p4s[] = { bjet1.p4, bjet2.p4, electron.p4, muon.p4 };
+        int64_t types[] = { bjet1.type, bjet2.type, electron.type, muon.type };
+        weight.setEvent(p4s, types);
+
+        std::vector<double> bound_weights = weight.evaluateIntegrand(psPoint);
+
+        REQUIRE(bound_weights.size() == 1);
+        REQUIRE(bound_weights[0] == weights[0]);
+    }
+}
+
+TEST_CASE("Integrand evaluation using a PDF grid", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    std::vector<std::vector<double>> psPoints { { 0.25, 0.15, 0.1, 0.4 }, { 0.5, 0.5, 0.5, 0.5 }, { 0.8, 0.3, 0.6, 0.2 } };
+
+    ConfigurationReader configuration("integrand.lua");
+    MoMEMta weight(configuration.freeze());
+
+    ConfigurationReader grid_configuration("integrand.lua");
+    grid_configuration.getGlobalParameters().set("pdf_grid_points", static_cast<int64_t>(4000));
+    MoMEMta grid_weight(grid_configuration.freeze());
+
+    weight.setEvent(test_event());
+    grid_weight.setEvent(test_event());
+
+    for (const auto& psPoint: psPoints) {
+        std::vector<double> weights = weight.evaluateIntegrand(psPoint);
+        std::vector<double> grid_weights = grid_weight.evaluateIntegrand(psPoint);
+
+        REQUIRE(grid_weights.size() == 1);
+        REQUIRE(grid_weights[0] * 1e21 == Approx(weights[0] * 1e21).epsilon(1e-5));
+    }
+}
+
+TEST_CASE("Integrand evaluation with PDF and scale variations", "[integration_tests]") {
+    logging::set_level(logging::level::fatal);
+
+    ParameterSet parameters;
+    parameters.set("pdf_variations", true);
+
+    ConfigurationReader configuration("integrand.lua", parameters);
+    MoMEMta weight(configuration.freeze());
+
+    weight.setEvent(test_event());
+    std::vector<double> psPoint { 0.25, 0.15, 0.1, 0.4 };
+    std::vector<double> weights = weight.evaluateIntegrand(psPoint);
+
+    REQUIRE(weights.size() == 5);
+
+    // Variations using the nominal scale and the central member reproduce the nominal integrand
+    REQUIRE(weights[1] == weights[0]);
+    REQUIRE(weights[3] == weights[0]);
+
+    REQUIRE(weights[2] > 0);
+    REQUIRE(weights[2] != weights[0]);
+    REQUIRE(weights[4] > 0);
+    REQUIRE(weights[4] != weights[0]);
+}
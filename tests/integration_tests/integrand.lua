@@ -8,7 +8,8 @@ parameters = {
     top_mass = 173.,
     top_width = 1.491500,
     W_mass = 80.419002,
-    W_width = 2.047600
+    W_width = 2.047600,
+    pdf_grid_points = 0
 }
 
 BreitWignerGenerator.flatter_s13 = {
@@ -60,9 +61,17 @@ BlockD.blockd = {
     s256 = 'flatter_s256::s',
 }
 
+-- PDF and scale variations are only computed if the `pdf_variations` global is injected
+local looper_path
+if pdf_variations then
+    looper_path = Path("boost", "ttbar", "integrand", "variations")
+else
+    looper_path = Path("boost", "ttbar", "integrand")
+end
+
 Looper.looper = {
     solutions = "blockd::solutions",
-    path = Path("boost", "ttbar", "integrand")
+    path = looper_path
 }
 
     full_inputs = copy_and_append(inputs, {'looper::particles/1', 'looper::particles/2'})
@@ -79,6 +88,9 @@ Looper.looper = {
     MatrixElement.ttbar = {
       pdf = 'CT10nlo',
       pdf_scale = parameter('top_mass'),
+      pdf_grid_points = parameter('pdf_grid_points'),
+      pdf_scale_variations = pdf_variations and {1., 2.} or nil,
+      pdf_members = pdf_variations or false,
 
       matrix_element = 'pp_ttx_fully_leptonic',
       matrix_element_parameters = {
@@ -129,4 +141,13 @@ Looper.looper = {
         input = "ttbar::output"
     }
 
-integrand("integrand::sum")
+if pdf_variations then
+    VectorLooperSummer.variations = {
+        input = "ttbar::variations"
+    }
+
+    -- Nominal, central scale, twice the scale, first two members of the set
+    integrand("integrand::sum", "variations::sum/1", "variations::sum/2", "variations::sum/3", "variations::sum/4")
+else
+    integrand("integrand::sum")
+end
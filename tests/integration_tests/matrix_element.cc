@@ -0,0 +1,210 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Batch evaluation of matrix elements integration test
+ * \ingroup IntegrationTests
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+
+#include <momemta/MatrixElement.h>
+#include <momemta/MatrixElementFactory.h>
+#include <momemta/ParameterSet.h>
+
+using namespace momemta;
+
+TEST_CASE("Batch evaluation of the matrix element", "[integration_tests]") {
+    ParameterSet configuration;
+    configuration.set("card", "../../MatrixElements/Cards/param_card.dat");
+
+    auto me = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+
+    using Momentum = std::vector<double>;
+    using InitialState = std::pair<Momentum, Momentum>;
+    using FinalState = std::vector<std::pair<int, Momentum>>;
+
+    // Not a multiple of the batch size, to also cover partially filled batches
+    const size_t n_points = 7;
+
+    std::vector<InitialState> initialStates;
+    std::vector<FinalState> finalStates;
+    for (size_t i = 0; i < n_points; i++) {
+        // Slightly change the energy of the b-quarks for each point
+        double factor = 1 + 0.01 * i;
+
+        FinalState finalState = {
+                {-13, {21.5293197631836, 16.171895980835, -13.7919054031372, -3.42997527122497}},
+                {14, {89.2587, -57.9413, 40.7629, -54.2982}},
+                {5, {174.66259765625 * factor, -55.7908325195313, -111.59294128418, -122.144721984863}},
+                {13, {21.4346446990967, -18.9018573760986, 10.0896110534668, -0.602926552295686}},
+                {-14, {81.7742, 57.9413, -40.7629, -40.8437}},
+                {-5, {142.492813110352 * factor, 71.3899612426758, 96.0094833374023, -77.2513122558594}}
+        };
+
+        double E = 0, pz = 0;
+        for (const auto& p: finalState) {
+            E += p.second[0];
+            pz += p.second[3];
+        }
+
+        initialStates.push_back({{(E + pz) / 2, 0, 0, (E + pz) / 2}, {(E - pz) / 2, 0, 0, -(E - pz) / 2}});
+        finalStates.push_back(finalState);
+    }
+
+    auto batch_results = me->computeBatch(initialStates, finalStates);
+    REQUIRE(batch_results.size() == n_points);
+
+    for (size_t i = 0; i < n_points; i++) {
+        auto result = me->compute(initialStates[i], finalStates[i]);
+
+        // External wavefunctions are cached between evaluations: evaluating the same point again must
+        // give exactly the same result
+        REQUIRE(me->compute(initialStates[i], finalStates[i]) == result);
+
+        REQUIRE(batch_results[i].size() == result.size());
+        REQUIRE(result.count({21, 21}) == 1);
+        REQUIRE(result.at({21, 21}) > 0);
+
+        for (const auto& r: result) {
+            REQUIRE(batch_results[i].count(r.first) == 1);
+            REQUIRE(batch_results[i].at(r.first) == Approx(r.second).epsilon(1e-10));
+        }
+    }
+}
+
+TEST_CASE("Helicity sampling of the matrix element", "[integration_tests]") {
+    ParameterSet configuration;
+    configuration.set("card", "../../MatrixElements/Cards/param_card.dat");
+
+    auto me = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+
+    std::vector<std::pair<int, std::vector<double>>> finalState = {
+            {-13, {21.5293197631836, 16.171895980835, -13.7919054031372, -3.42997527122497}},
+            {14, {89.2587, -57.9413, 40.7629, -54.2982}},
+            {5, {174.66259765625, -55.7908325195313, -111.59294128418, -122.144721984863}},
+            {13, {21.4346446990967, -18.9018573760986, 10.0896110534668, -0.602926552295686}},
+            {-14, {81.7742, 57.9413, -40.7629, -40.8437}},
+            {-5, {142.492813110352, 71.3899612426758, 96.0094833374023, -77.2513122558594}}
+    };
+
+    double E = 0, pz = 0;
+    for (const auto& p: finalState) {
+        E += p.second[0];
+        pz += p.second[3];
+    }
+
+    std::pair<std::vector<double>, std::vector<double>> initialState = {
+            {(E + pz) / 2, 0, 0, (E + pz) / 2}, {(E - pz) / 2, 0, 0, -(E - pz) / 2}
+    };
+
+    // Discover the vanishing helicity combinations
+    auto result = me->compute(initialState, finalState);
+
+    auto table = me->getGoodHelicities();
+    REQUIRE(table.size() == 2);
+
+    SECTION("Persistence of the helicity combinations") {
+        REQUIRE(me->setGoodHelicities(table));
+        REQUIRE(me->getGoodHelicities() == table);
+
+        REQUIRE_FALSE(me->setGoodHelicities({table[0]}));
+        REQUIRE(me->getGoodHelicities() == table);
+
+        // The same helicity combinations must be skipped by a new instance
+        auto other = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+        REQUIRE(other->setGoodHelicities(table));
+        REQUIRE(other->compute(initialState, finalState) == result);
+    }
+
+    SECTION("Helicity combinations are only sampled once the vanishing ones are known") {
+        auto other = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+        REQUIRE(other->computeSampledHelicity(initialState, finalState, 0.5) == result);
+        REQUIRE(other->getGoodHelicities() == table);
+
+        auto restored = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+        REQUIRE(restored->setGoodHelicities(table));
+        REQUIRE(restored->computeSampledHelicity(initialState, finalState, 0.5) != result);
+    }
+
+    SECTION("Average over the sampled helicity combinations") {
+        // Sampling uniformly, each non-vanishing combination of each sub-process is picked the same number of times
+        size_t n_samples = 1;
+        for (const auto& helicities: table)
+            n_samples *= std::count(helicities.begin(), helicities.end(), true);
+
+        std::map<std::pair<int, int>, double> average;
+        for (size_t i = 0; i < n_samples; i++) {
+            auto sampled = me->computeSampledHelicity(initialState, finalState, (i + 0.5) / n_samples);
+            for (const auto& r: sampled)
+                average[r.first] += r.second / n_samples;
+        }
+
+        REQUIRE(average.size() == result.size());
+        for (const auto& r: result)
+            REQUIRE(average.at(r.first) == Approx(r.second).epsilon(1e-10));
+    }
+}
+
+TEST_CASE("Allocation-free evaluation of the matrix element", "[integration_tests]") {
+    ParameterSet configuration;
+    configuration.set("card", "../../MatrixElements/Cards/param_card.dat");
+
+    auto me = MatrixElementFactory::get().create("pp_ttx_fully_leptonic", configuration);
+
+    REQUIRE(me->resolveFinalState({-13, 14, 5, 13, -14, 6}) < 0);
+
+    auto handle = me->resolveFinalState({-13, 14, 5, 13, -14, -5});
+    REQUIRE(handle >= 0);
+
+    std::vector<std::pair<int, std::vector<double>>> finalState = {
+            {-13, {21.5293197631836, 16.171895980835, -13.7919054031372, -3.42997527122497}},
+            {14, {89.2587, -57.9413, 40.7629, -54.2982}},
+            {5, {174.66259765625, -55.7908325195313, -111.59294128418, -122.144721984863}},
+            {13, {21.4346446990967, -18.9018573760986, 10.0896110534668, -0.602926552295686}},
+            {-14, {81.7742, 57.9413, -40.7629, -40.8437}},
+            {-5, {142.492813110352, 71.3899612426758, 96.0094833374023, -77.2513122558594}}
+    };
+
+    double E = 0, pz = 0;
+    const double* finalMomenta[6];
+    for (size_t i = 0; i < finalState.size(); i++) {
+        E += finalState[i].second[0];
+        pz += finalState[i].second[3];
+        finalMomenta[i] = finalState[i].second.data();
+    }
+
+    std::pair<std::vector<double>, std::vector<double>> initialState = {
+            {(E + pz) / 2, 0, 0, (E + pz) / 2}, {(E - pz) / 2, 0, 0, -(E - pz) / 2}
+    };
+    const double* initialMomenta[2] = { initialState.first.data(), initialState.second.data() };
+
+    auto result = me->compute(initialState, finalState);
+
+    momemta::MatrixElement::FlatResult flat;
+    me->computeFlat(handle, initialMomenta, finalMomenta, flat);
+
+    REQUIRE(flat.size == result.size());
+    for (size_t i = 0; i < flat.size; i++) {
+        REQUIRE(result.count(flat.initialStates[i]) == 1);
+        REQUIRE(result.at(flat.initialStates[i]) == flat.values[i]);
+    }
+}
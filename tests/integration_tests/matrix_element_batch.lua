@@ -0,0 +1,86 @@
+local electron = declare_input("electron")
+local muon = declare_input("muon")
+local bjet1 = declare_input("bjet1")
+local bjet2 = declare_input("bjet2")
+local neutrino1 = declare_input("neutrino1")
+local neutrino2 = declare_input("neutrino2")
+
+parameters = {
+    energy = 13000.,
+    top_mass = 173.
+}
+
+-- The matrix element is not inside a looper, so that it's evaluated by batches of phase-space points
+GaussianTransferFunctionOnEnergy.tf_bjet1 = {
+    ps_point = add_dimension(),
+    reco_particle = bjet1.reco_p4,
+    sigma = 0.10
+}
+
+GaussianTransferFunctionOnEnergy.tf_bjet2 = {
+    ps_point = add_dimension(),
+    reco_particle = bjet2.reco_p4,
+    sigma = 0.10
+}
+
+inputs = {
+    electron.reco_p4,
+    'tf_bjet1::output',
+    muon.reco_p4,
+    'tf_bjet2::output',
+    neutrino1.reco_p4,
+    neutrino2.reco_p4
+}
+
+BuildInitialState.boost = {
+    do_transverse_boost = true,
+    particles = inputs
+}
+
+MatrixElement.ttbar = {
+    pdf = 'CT10nlo',
+    pdf_scale = parameter('top_mass'),
+    pdf_scale_variations = {1., 2.},
+    matrix_element = 'pp_ttx_fully_leptonic',
+    matrix_element_parameters = {
+        card = '../../MatrixElements/Cards/param_card.dat'
+    },
+    initialState = 'boost::partons',
+    particles = {
+        inputs = inputs,
+        ids = {
+            {
+                pdg_id = -13,
+                me_index = 1,
+            },
+
+            {
+                pdg_id = 5,
+                me_index = 3,
+            },
+
+            {
+                pdg_id = 13,
+                me_index = 4,
+            },
+
+            {
+                pdg_id = -5,
+                me_index = 6,
+            },
+
+            {
+                pdg_id = 14,
+                me_index = 2,
+            },
+
+            {
+                pdg_id = -14,
+                me_index = 5,
+            }
+        }
+    },
+    jacobians = {'tf_bjet1::TF_times_jacobian', 'tf_bjet2::TF_times_jacobian'}
+}
+
+integrand("ttbar::output", "ttbar::variations/1", "ttbar::variations/2")
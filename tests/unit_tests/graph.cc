@@ -24,8 +24,12 @@
 
 #include <catch.hpp>
 
+#include <algorithm>
+#include <set>
+
 #include <momemta/ConfigurationReader.h>
 #include <momemta/Logging.h>
+#include <momemta/ParameterSet.h>
 
 #include <Graph.h>
 
@@ -213,14 +217,15 @@ integrand("sum::output")
         REQUIRE(graph->getPaths().back() == conf.getPaths().front()->id);
 
         auto modules = graph->getDecls(DEFAULT_EXECUTION_PATH);
-        REQUIRE(modules.size() == 2); // Only the looper + dummy module
+        // The looper, the dummy module, and the sum, moved out of the looper path. The constants are identical to the
+        // dummy module and are merged into it.
+        REQUIRE(modules.size() == 3);
 
-        REQUIRE(modules.at(0).name == "dummy");
-        REQUIRE(modules.at(1).name == "looper");
+        REQUIRE(modules.back().name == "looper");
 
         modules = graph->getDecls(graph->getPaths().back());
-        // Order is not guaranteed, only test the number of modules
-        REQUIRE(modules.size() == 4);
+        REQUIRE(modules.size() == 1);
+        REQUIRE(modules.at(0).name == "printer");
     }
 
     SECTION("A module using looper's output must be inside the looper execution path") {
@@ -312,15 +317,15 @@ integrand("some::output")
         REQUIRE(graph->getPaths().back() == conf.getPaths().front()->id);
 
         auto modules = graph->getDecls(DEFAULT_EXECUTION_PATH);
-        REQUIRE(modules.size() == 2); // Only looper_1 + dummy module
+        // looper_1 and dummy_1. dummy_2 does not depend on looper_1, and is merged into dummy_1
+        REQUIRE(modules.size() == 2);
 
-        REQUIRE(modules.at(0).name == "dummy_1");
-        REQUIRE(modules.at(1).name == "looper_1");
+        REQUIRE(modules.back().name == "looper_1");
 
         modules = graph->getDecls(graph->getPaths().at(1));
 
-        // Looper_1 path, dummy_1, printer_1 and looper_2
-        REQUIRE(modules.size() == 3);
+        // Looper_1 path, printer_1 and looper_2
+        REQUIRE(modules.size() == 2);
 
         modules = graph->getDecls(graph->getPaths().at(2));
 
@@ -328,6 +333,287 @@ integrand("some::output")
         REQUIRE(modules.at(0).name == "printer_2");
     }
 
+    SECTION("Modules not depending on a looper are moved out of its path") {
+        const std::string conf_str = R"(
+
+DoubleConstant.dummy_1 = { value = 42. }
+DoubleConstant.dummy_2 = { value = 42. }
+
+Looper.looper_2 = {
+    solutions = "dummy_2::value",
+    path = Path("invariant_2", "printer_2", "variant", "summer")
+}
+
+Looper.looper_1 = {
+    solutions = "dummy_1::value",
+    path = Path("invariant_1", "printer_1", "looper_2", "dummy_2")
+}
+
+SolutionPrinter.printer_1 = { input = "looper_1::particles" }
+SolutionPrinter.printer_2 = { input = "looper_2::particles" }
+
+-- Does not depend on any looper
+DoubleLinearCombinator.invariant_1 = {
+    inputs = { "dummy_1::value" },
+    coefficients = {2}
+}
+
+-- Only depends on a module moved out of the loopers
+DoubleLinearCombinator.invariant_2 = {
+    inputs = { "invariant_1::output" },
+    coefficients = {2}
+}
+
+-- Depends on looper_2
+DoubleLinearCombinator.variant = {
+    inputs = { "invariant_2::output", "looper_2::jacobian" },
+    coefficients = {1, 1}
+}
+
+-- Stateful: executed once per solution, even if its input is the same for every solution
+DoubleLooperSummer.summer = { input = "invariant_2::output" }
+
+DoubleLinearCombinator.result = {
+    inputs = { "variant::output", "summer::sum" },
+    coefficients = {1, 1}
+}
+
+integrand("result::output")
+)";
+
+        auto conf = get_conf(conf_str);
+
+        logging::set_level(logging::level::off);
+        momemta::ComputationGraphBuilder builder(available_modules, conf);
+        auto graph = builder.build();
+
+        REQUIRE(graph->getPaths().size() == 3);
+
+        auto names = [&graph](const boost::uuids::uuid& path) {
+            std::set<std::string> result;
+            for (const auto& decl: graph->getDecls(path))
+                result.insert(decl.name);
+            return result;
+        };
+
+        // dummy_2 is moved out of looper_1, and merged into dummy_1
+        REQUIRE(names(DEFAULT_EXECUTION_PATH) ==
+                std::set<std::string>({"dummy_1", "invariant_1", "invariant_2", "looper_1", "result"}));
+        REQUIRE(names(graph->getPaths().at(1)) == std::set<std::string>({"printer_1", "looper_2"}));
+        REQUIRE(names(graph->getPaths().at(2)) == std::set<std::string>({"printer_2", "variant", "summer"}));
+
+        // Moved modules are executed before the looper
+        auto modules = graph->getDecls(DEFAULT_EXECUTION_PATH);
+        auto position = [&modules](const std::string& name) {
+            return std::find_if(modules.begin(), modules.end(), [&name](const Configuration::ModuleDecl& decl) {
+                return decl.name == name;
+            }) - modules.begin();
+        };
+
+        REQUIRE(position("invariant_2") < position("looper_1"));
+        REQUIRE(position("looper_1") < position("result"));
+    }
+
+    SECTION("Modules are classified using what their inputs depend on") {
+        const std::string conf_str = R"(
+local input = declare_input("input")
+
+DoubleConstant.constant = { value = 42. }
+
+-- Only depends on the event
+StandardPhaseSpace.phase_space = { particles = { input.reco_p4 } }
+
+DoubleLinearCombinator.event = {
+    inputs = { "constant::value", "phase_space::phase_space" },
+    coefficients = {1, 1}
+}
+
+-- Depends on the phase-space point
+GaussianTransferFunctionOnEnergy.tf = {
+    ps_point = add_dimension(),
+    reco_particle = input.reco_p4,
+    sigma = 0.05
+}
+
+DoubleLinearCombinator.point = {
+    inputs = { "event::output", "tf::TF_times_jacobian" },
+    coefficients = {1, 1}
+}
+
+-- Has side effects
+DoublePrinter.printer = { input = "constant::value" }
+
+integrand("point::output")
+)";
+
+        auto conf = get_conf(conf_str);
+
+        momemta::ComputationGraphBuilder builder(available_modules, conf);
+        auto graph = builder.build();
+
+        REQUIRE(graph->getStage("constant") == momemta::ModuleStage::Constant);
+        REQUIRE(graph->getStage("phase_space") == momemta::ModuleStage::Event);
+        REQUIRE(graph->getStage("event") == momemta::ModuleStage::Event);
+        REQUIRE(graph->getStage("tf") == momemta::ModuleStage::Point);
+        REQUIRE(graph->getStage("point") == momemta::ModuleStage::Point);
+        REQUIRE(graph->getStage("printer") == momemta::ModuleStage::Point);
+    }
+
+    SECTION("Filters are executed as early as possible") {
+        const std::string conf_str = R"(
+parameters = { energy = 13000. }
+
+local input = declare_input("input")
+
+GaussianTransferFunctionOnEnergy.tf = {
+    ps_point = add_dimension(),
+    reco_particle = input.reco_p4,
+    sigma = 0.05
+}
+
+-- Filters, depending on a transfer function or not
+BuildInitialState.boost_1 = { particles = { "tf::output" } }
+BuildInitialState.boost_2 = { particles = { input.reco_p4 } }
+
+P4VectorPrinter.printer_1 = { input = "boost_1::partons" }
+P4VectorPrinter.printer_2 = { input = "boost_2::partons" }
+
+integrand("tf::TF_times_jacobian")
+)";
+
+        auto conf = get_conf(conf_str);
+
+        momemta::ComputationGraphBuilder builder(available_modules, conf);
+        auto graph = builder.build();
+
+        auto modules = graph->getDecls(DEFAULT_EXECUTION_PATH);
+        REQUIRE(modules.size() == 5);
+
+        // boost_2 does not need anything, and boost_1 only needs the transfer function: both are executed before
+        // the printers
+        REQUIRE(modules.at(0).name == "boost_2");
+        REQUIRE(modules.at(1).name == "tf");
+        REQUIRE(modules.at(2).name == "boost_1");
+    }
+
+    SECTION("Filters needing expensive modules are executed last") {
+        const std::string conf_str = R"(
+parameters = { energy = 13000. }
+
+local input = declare_input("input")
+
+GaussianTransferFunctionOnEnergy.tf = {
+    ps_point = add_dimension(),
+    reco_particle = input.reco_p4,
+    sigma = 0.05
+}
+
+FlatTransferFunctionOnP.flat_1 = {
+    ps_point = add_dimension(),
+    reco_particle = input.reco_p4,
+    min = 0.,
+    max = 100.
+}
+
+FlatTransferFunctionOnP.flat_2 = {
+    ps_point = add_dimension(),
+    reco_particle = "flat_1::output",
+    min = 0.,
+    max = 100.
+}
+
+-- boost_1 needs a single transfer function, and boost_2 two cheap ones
+BuildInitialState.boost_1 = { particles = { "tf::output" } }
+BuildInitialState.boost_2 = { particles = { "flat_2::output" } }
+
+P4VectorPrinter.printer_1 = { input = "boost_1::partons" }
+P4VectorPrinter.printer_2 = { input = "boost_2::partons" }
+
+integrand("tf::TF_times_jacobian")
+)";
+
+        auto conf = get_conf(conf_str);
+
+        auto first_filter = [&conf](const momemta::ModuleList& modules) -> std::string {
+            momemta::ComputationGraphBuilder builder(modules, conf);
+            auto graph = builder.build();
+
+            for (const auto& decl: graph->getDecls(DEFAULT_EXECUTION_PATH)) {
+                if (decl.type == "BuildInitialState")
+                    return decl.name;
+            }
+
+            return "";
+        };
+
+        auto def = std::find_if(available_modules.begin(), available_modules.end(),
+                                [](const momemta::ModuleDef& def) {
+                                    return def.name == "GaussianTransferFunctionOnEnergy";
+                                });
+        REQUIRE(def != available_modules.end());
+        REQUIRE(def->cost > 1);
+
+        // As cheap as a simple module: boost_1 needs fewer modules than boost_2
+        def->cost = 1;
+        REQUIRE(first_filter(available_modules) == "boost_1");
+
+        // More expensive than the two modules needed by boost_2
+        def->cost = 3;
+        REQUIRE(first_filter(available_modules) == "boost_2");
+    }
+
+    SECTION("Identical modules are merged") {
+        const std::string conf_str = R"(
+local input = declare_input("input")
+
+StandardPhaseSpace.phase_space_1 = { particles = { input.reco_p4 } }
+StandardPhaseSpace.phase_space_2 = { particles = { input.reco_p4 } }
+
+-- Different parameters
+StandardPhaseSpace.phase_space_3 = { particles = { input.reco_p4, input.reco_p4 } }
+
+DoubleLinearCombinator.sum_1 = {
+    inputs = { "phase_space_1::phase_space", "phase_space_3::phase_space" },
+    coefficients = {1, 1}
+}
+
+DoubleLinearCombinator.sum_2 = {
+    inputs = { "phase_space_2::phase_space", "phase_space_3::phase_space" },
+    coefficients = {1, 1}
+}
+
+DoubleLinearCombinator.result = {
+    inputs = { "sum_1::output", "sum_2::output" },
+    coefficients = {1, 1}
+}
+
+integrand("result::output", "sum_2::output")
+)";
+
+        auto conf = get_conf(conf_str);
+
+        momemta::ComputationGraphBuilder builder(available_modules, conf);
+        auto graph = builder.build();
+
+        auto modules = graph->getDecls(DEFAULT_EXECUTION_PATH);
+        std::set<std::string> names;
+        for (const auto& module: modules)
+            names.emplace(module.name);
+
+        // sum_2 produces an integrand: it is kept instead of sum_1
+        REQUIRE(names == std::set<std::string>({"phase_space_1", "phase_space_3", "sum_2", "result"}));
+
+        auto result = std::find_if(modules.begin(), modules.end(), [](const Configuration::ModuleDecl& decl) {
+            return decl.name == "result";
+        });
+        REQUIRE(result != modules.end());
+
+        auto inputs = result->parameters->get<std::vector<InputTag>>("inputs");
+        REQUIRE(inputs.size() == 2);
+        REQUIRE(inputs[0].module == "sum_2");
+        REQUIRE(inputs[1].module == "sum_2");
+    }
+
     SECTION("Unused module should not increase the number of dimension") {
         const std::string conf_str = R"(
 
@@ -0,0 +1,92 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Unit tests for the internal 4-vector types
+ * \ingroup UnitTests
+ */
+
+#include <catch.hpp>
+
+#include <cmath>
+
+#include <momemta/Pool.h>
+
+#include <FourVector.h>
+
+using namespace momemta;
+
+TEST_CASE("Internal 4-vectors", "[kinematics]") {
+
+    const LorentzVector p1(10, -20, 30, 50);
+    const LorentzVector p2(-5, 15, 25, 40);
+
+    SECTION("FourVector") {
+        FourVector v1(p1);
+        FourVector v2(p2);
+
+        REQUIRE(v1.toLorentzVector() == p1);
+        REQUIRE(v1.Pt2() == Approx(p1.Pt() * p1.Pt()));
+        REQUIRE(v1.P2() == Approx(p1.P2()));
+        REQUIRE(v1.M2() == Approx(p1.M2()));
+        REQUIRE(v1.Dot(v2) == Approx(p1.Dot(p2)));
+
+        REQUIRE((v1 + v2).toLorentzVector() == p1 + p2);
+        REQUIRE((v1 - v2).toLorentzVector() == p1 - p2);
+        REQUIRE((v1 * 2.).toLorentzVector() == p1 * 2.);
+    }
+
+    SECTION("FourVectors") {
+        FourVectors vectors(2);
+        vectors.set(0, p1);
+        vectors.set(1, p2);
+
+        REQUIRE(vectors.size() == 2);
+        REQUIRE(vectors.get(1).toLorentzVector() == p2);
+
+        double Pt2[2], P2[2], M2[2];
+        vectors.Pt2(Pt2);
+        vectors.P2(P2);
+        vectors.M2(M2);
+
+        REQUIRE(Pt2[0] == Approx(p1.Pt() * p1.Pt()));
+        REQUIRE(P2[1] == Approx(p2.P2()));
+        REQUIRE(M2[1] == Approx(p2.M2()));
+    }
+
+    SECTION("Cached kinematics") {
+        Pool pool;
+        InputTag tag("module", "p");
+        auto p = pool.put<LorentzVector>(tag);
+        *p = p1;
+
+        CachedKinematics kinematics(pool.get<LorentzVector>(tag));
+
+        // Values are exactly the ones returned by ROOT
+        REQUIRE(kinematics.get().M == p1.M());
+        REQUIRE(kinematics.get().Eta == p1.Eta());
+        REQUIRE(kinematics.get().cosh_eta == std::cosh(p1.Eta()));
+        REQUIRE(kinematics.get().sin_phi == std::sin(p1.Phi()));
+
+        *p = p2;
+        REQUIRE(kinematics.get().E == p2.E());
+        REQUIRE(kinematics.get().Pt == p2.Pt());
+        REQUIRE(kinematics.get().Theta == p2.Theta());
+    }
+}
@@ -0,0 +1,254 @@
+/*
+ *  MoMEMta: a modular implementation of the Matrix Element Method
+ *  Copyright (C) 2017  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Unit tests for the polynomial solvers
+ * \ingroup UnitTests
+ */
+
+#include <catch.hpp>
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <momemta/Math.h>
+#include <momemta/MathBatch.h>
+
+using namespace momemta;
+
+namespace {
+
+const std::size_t N_BATCHES = 250;
+
+template <std::size_t N>
+void compareRoots(const FixedRoots<N>& roots, const std::vector<double>& expected) {
+    REQUIRE(roots.size() == expected.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+        REQUIRE(roots[i] == expected[i]);
+}
+
+template <std::size_t N>
+void compareLane(const batch::LaneRoots<N>& roots, std::size_t lane, const FixedRoots<N>& expected) {
+    REQUIRE(roots.size[lane] == expected.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+        REQUIRE(roots.roots[i][lane] == Approx(expected[i]).epsilon(1e-10));
+}
+
+}
+
+TEST_CASE("Polynomial solvers", "[math]") {
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> coefficient(-10, 10);
+
+    SECTION("Fixed-size roots") {
+        QuadraticRoots roots;
+        roots.push_back(1);
+        roots.push_back(2);
+
+        REQUIRE(roots.size() == 2);
+        REQUIRE_THROWS_AS(roots.push_back(3), std::length_error);
+        REQUIRE_THROWS_AS(roots.at(2), std::out_of_range);
+
+        roots.erase(roots.begin());
+        REQUIRE(roots.size() == 1);
+        REQUIRE(roots.at(0) == 2);
+
+        roots.clear();
+        REQUIRE(roots.empty());
+    }
+
+    SECTION("Multiple roots") {
+        // Single real root
+        CubicRoots cubic_roots;
+        REQUIRE(solveCubic(1, 0, 1, 1, cubic_roots));
+        REQUIRE(cubic_roots.size() == 1);
+
+        // Double root
+        QuadraticRoots quadratic_roots;
+        REQUIRE(solveQuadratic(1, -2, 1, quadratic_roots));
+        REQUIRE(quadratic_roots.size() == 2);
+        removeDuplicateRoots(quadratic_roots);
+        REQUIRE(quadratic_roots.size() == 1);
+        REQUIRE(quadratic_roots[0] == 1);
+
+        // x (x - 1)^2 (x + 1): the double root may be split by rounding errors
+        QuarticRoots quartic_roots;
+        REQUIRE(solveQuartic(1, -1, -1, 1, 0, quartic_roots));
+        REQUIRE(quartic_roots.size() == 4);
+        removeDuplicateRoots(quartic_roots);
+        REQUIRE(quartic_roots.size() == 3);
+        REQUIRE(quartic_roots[0] == Approx(-1));
+        REQUIRE(quartic_roots[1] == Approx(1));
+        REQUIRE(std::abs(quartic_roots[2]) < 1e-12);
+
+        // Roots only differing by rounding errors
+        QuarticRoots split_roots;
+        split_roots.push_back(1);
+        split_roots.push_back(1 + 1e-12);
+        split_roots.push_back(2);
+        removeDuplicateRoots(split_roots);
+        REQUIRE(split_roots.size() == 2);
+        REQUIRE(split_roots[0] == 1);
+        REQUIRE(split_roots[1] == 2);
+
+        std::vector<double> E1 = {1, 1, 1 + 1e-12, 2};
+        std::vector<double> E2 = {2, 3, 2 - 1e-12, 2};
+        removeDuplicateSolutions(E1, E2);
+        REQUIRE(E1 == std::vector<double>({1, 1, 2}));
+        REQUIRE(E2 == std::vector<double>({2, 3, 2}));
+    }
+
+    SECTION("Newton polishing") {
+        // (x - 1) (x - 2) (x + 3) (x - 5)
+        const double a = 1, b = -5, c = -7, d = 41, e = -30;
+        for (double root: {1., 2., -3., 5.}) {
+            REQUIRE(polishQuarticRoot(a, b, c, d, e, root * (1 + 1e-4), 10) == Approx(root).epsilon(1e-12));
+            REQUIRE(polishQuarticRoot(a, b, c, d, e, root, 10) == root);
+        }
+
+        // No iteration
+        REQUIRE(polishQuarticRoot(a, b, c, d, e, 1.1, 0) == 1.1);
+
+        // E1^2 + E2^2 = 25 and E1^2 - E2^2 = 7, with solutions (+-4, +-3)
+        double E1 = 4.001;
+        double E2 = 2.999;
+        polish2QuadsSolution(1, 1, 0, 0, 0, -25, 1, -1, 0, 0, 0, -7, E1, E2, 10);
+        REQUIRE(E1 == Approx(4).epsilon(1e-12));
+        REQUIRE(E2 == Approx(3).epsilon(1e-12));
+
+        // Solutions of solve2Quads are never made worse
+        for (std::size_t n = 0; n < 100; n++) {
+            double coefficients[12];
+            for (auto& x: coefficients)
+                x = coefficient(generator);
+
+            QuarticRoots E1s, E2s;
+            solve2Quads(coefficients[0], coefficients[1], coefficients[2], coefficients[3], coefficients[4],
+                        coefficients[5], coefficients[6], coefficients[7], coefficients[8], coefficients[9],
+                        coefficients[10], coefficients[11], E1s, E2s);
+
+            auto residual = [&coefficients](double x, double y) {
+                const double* a = coefficients;
+                const double* b = coefficients + 6;
+                return SQ(a[0] * SQ(x) + a[1] * SQ(y) + a[2] * x * y + a[3] * x + a[4] * y + a[5]) +
+                       SQ(b[0] * SQ(x) + b[1] * SQ(y) + b[2] * x * y + b[3] * x + b[4] * y + b[5]);
+            };
+
+            for (std::size_t i = 0; i < E1s.size(); i++) {
+                double x = E1s[i];
+                double y = E2s[i];
+                polish2QuadsSolution(coefficients[0], coefficients[1], coefficients[2], coefficients[3],
+                                     coefficients[4], coefficients[5], coefficients[6], coefficients[7],
+                                     coefficients[8], coefficients[9], coefficients[10], coefficients[11], x, y, 5);
+                REQUIRE(residual(x, y) <= residual(E1s[i], E2s[i]));
+            }
+        }
+    }
+
+    SECTION("Allocation-free solvers give the same roots") {
+        for (std::size_t n = 0; n < N_BATCHES * batch::NLANES; n++) {
+            double c[12];
+            for (auto& x: c)
+                x = coefficient(generator);
+
+            std::vector<double> expected, expected_E2;
+            QuadraticRoots quadratic_roots;
+            CubicRoots cubic_roots;
+            QuarticRoots quartic_roots, E1, E2;
+
+            REQUIRE(solveQuadratic(c[0], c[1], c[2], quadratic_roots) == solveQuadratic(c[0], c[1], c[2], expected));
+            compareRoots(quadratic_roots, expected);
+
+            expected.clear();
+            REQUIRE(solveCubic(c[0], c[1], c[2], c[3], cubic_roots) == solveCubic(c[0], c[1], c[2], c[3], expected));
+            compareRoots(cubic_roots, expected);
+
+            expected.clear();
+            REQUIRE(solveQuartic(c[0], c[1], c[2], c[3], c[4], quartic_roots) ==
+                    solveQuartic(c[0], c[1], c[2], c[3], c[4], expected));
+            compareRoots(quartic_roots, expected);
+
+            expected.clear();
+            REQUIRE(solve2Quads(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9], c[10], c[11], E1, E2) ==
+                    solve2Quads(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9], c[10], c[11], expected,
+                                expected_E2));
+            compareRoots(E1, expected);
+            compareRoots(E2, expected_E2);
+        }
+    }
+
+    SECTION("Batched solvers give the same roots as the scalar ones") {
+        for (std::size_t n = 0; n < N_BATCHES; n++) {
+            alignas(32) double c[12][batch::NLANES];
+            for (std::size_t i = 0; i < 12; i++) {
+                for (std::size_t l = 0; l < batch::NLANES; l++)
+                    c[i][l] = coefficient(generator);
+            }
+
+            // Exercise the special cases in some of the lanes
+            if (n % 5 == 1)
+                c[0][n % batch::NLANES] = 0;
+            if (n % 5 == 2) {
+                // Biquadratic equation
+                c[1][n % batch::NLANES] = 0;
+                c[3][n % batch::NLANES] = 0;
+            }
+            if (n % 5 == 3) {
+                // Conics without E1^2 term
+                c[0][n % batch::NLANES] = 0;
+                c[6][n % batch::NLANES] = 0;
+            }
+
+            batch::LaneRoots<2> quadratic_roots;
+            batch::solveQuadratic(c[0], c[1], c[2], quadratic_roots);
+
+            batch::LaneRoots<3> cubic_roots;
+            batch::solveCubic(c[0], c[1], c[2], c[3], cubic_roots);
+
+            batch::LaneRoots<4> quartic_roots;
+            batch::solveQuartic(c[0], c[1], c[2], c[3], c[4], quartic_roots);
+
+            batch::LaneRoots<4> E1, E2;
+            batch::solve2Quads(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9], c[10], c[11], E1, E2);
+
+            for (std::size_t l = 0; l < batch::NLANES; l++) {
+                QuadraticRoots expected_quadratic;
+                solveQuadratic(c[0][l], c[1][l], c[2][l], expected_quadratic);
+                compareLane(quadratic_roots, l, expected_quadratic);
+
+                CubicRoots expected_cubic;
+                solveCubic(c[0][l], c[1][l], c[2][l], c[3][l], expected_cubic);
+                compareLane(cubic_roots, l, expected_cubic);
+
+                QuarticRoots expected_quartic;
+                solveQuartic(c[0][l], c[1][l], c[2][l], c[3][l], c[4][l], expected_quartic);
+                compareLane(quartic_roots, l, expected_quartic);
+
+                QuarticRoots expected_E1, expected_E2;
+                solve2Quads(c[0][l], c[1][l], c[2][l], c[3][l], c[4][l], c[5][l], c[6][l], c[7][l], c[8][l],
+                            c[9][l], c[10][l], c[11][l], expected_E1, expected_E2);
+                compareLane(E1, l, expected_E1);
+                compareLane(E2, l, expected_E2);
+            }
+        }
+    }
+}
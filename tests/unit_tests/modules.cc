@@ -34,6 +34,9 @@
 #include <momemta/Types.h>
 #include <momemta/Math.h>
 
+#include <ExecutionPlan.h>
+#include <Profiler.h>
+
 #define N_PS_POINTS 5
 
 // A mock of ParameterSet to change visibility of the constructor
@@ -172,6 +175,104 @@ TEST_CASE("Modules", "[modules]") {
         REQUIRE(*jacobian == Approx(expected_jacobian));
     }
 
+    SECTION("Hooks") {
+        auto hooks = [](const std::string& type) {
+            return momemta::ModuleRegistry::get().find(type).module_def.hooks;
+        };
+
+        REQUIRE(hooks("DoubleConstant") == momemta::HOOK_NONE);
+        REQUIRE(hooks("BlockD") == momemta::HOOK_NONE);
+        REQUIRE(hooks("DoubleLooperSummer") == momemta::HOOK_BEGIN_POINT);
+        REQUIRE(hooks("SimpleCounter") == momemta::HOOK_BEGIN_LOOP);
+        REQUIRE(hooks("Looper") == (momemta::HOOK_BEGIN_POINT | momemta::HOOK_END_POINT));
+
+        // Only the modules implementing a hook are called
+        *pool->put<double>({"mock", "value"}) = 2;
+        parameters.reset(new ParameterSetMock("DoubleLooperSummer"));
+        parameters->set("input", InputTag("mock", "value"));
+        auto summer = createModule("DoubleLooperSummer");
+
+        parameters.reset(new ParameterSetMock("SimpleCounter"));
+        auto counter = createModule("SimpleCounter");
+
+        auto sum = pool->get<double>({"DoubleLooperSummer", "sum"});
+        auto count = pool->get<int64_t>({"SimpleCounter", "count"});
+
+        momemta::ExecutionPlan plan;
+        plan.add(summer.get(), hooks("DoubleLooperSummer"));
+        plan.add(counter.get(), hooks("SimpleCounter"));
+        REQUIRE(plan.modules().size() == 2);
+
+        for (auto module: plan.modules())
+            REQUIRE(module->work() == Module::Status::OK);
+
+        REQUIRE(*sum == Approx(2));
+        REQUIRE(*count == 1);
+
+        plan.beginPoint();
+        REQUIRE(*sum == Approx(0));
+        REQUIRE(*count == 1);
+
+        plan.beginLoop();
+        REQUIRE(*count == 0);
+    }
+
+    SECTION("Profiling") {
+        *pool->put<double>({"mock", "value"}) = 2;
+        parameters.reset(new ParameterSetMock("DoubleLooperSummer"));
+        parameters->set("input", InputTag("mock", "value"));
+        auto summer = createModule("DoubleLooperSummer");
+
+        auto profiler = std::make_shared<momemta::Profiler>();
+        REQUIRE(profiler->add(summer.get(), "summer", "DoubleLooperSummer") == 0);
+
+        momemta::ExecutionPlan plan;
+        plan.add(summer.get(), momemta::HOOK_ALL);
+        plan.setProfiler(profiler);
+
+        // Nothing is recorded while the profiler is disabled
+        REQUIRE(plan.work() == Module::Status::OK);
+        REQUIRE(profiler->profile().at(0).calls == 0);
+
+        profiler->setEnabled(true);
+        for (size_t i = 0; i < 10; i++)
+            REQUIRE(plan.work() == Module::Status::OK);
+
+        auto profile = profiler->profile().at(0);
+        REQUIRE(profile.name == "summer");
+        REQUIRE(profile.type == "DoubleLooperSummer");
+        REQUIRE(profile.calls == 10);
+        REQUIRE(profile.ok == 10);
+        REQUIRE(profile.next == 0);
+        REQUIRE(profile.total_time > 0);
+        REQUIRE(profile.median_time <= profile.p90_time);
+        REQUIRE(profile.p90_time <= profile.p99_time);
+
+        // Percentiles are estimated from a histogram
+        profiler->reset();
+        REQUIRE(profiler->profile().at(0).calls == 0);
+
+        for (size_t i = 0; i < 90; i++)
+            profiler->record(0, Module::Status::OK, std::chrono::microseconds(1));
+        for (size_t i = 0; i < 10; i++)
+            profiler->record(0, Module::Status::NEXT, std::chrono::milliseconds(1));
+
+        profile = profiler->profile().at(0);
+        REQUIRE(profile.calls == 100);
+        REQUIRE(profile.ok == 90);
+        REQUIRE(profile.next == 10);
+        REQUIRE(profile.total_time == Approx(10.09e-3));
+        REQUIRE(profile.median_time == Approx(1e-6).epsilon(0.125));
+        REQUIRE(profile.p90_time == Approx(1e-6).epsilon(0.125));
+        REQUIRE(profile.p99_time == Approx(1e-3).epsilon(0.125));
+
+        // Statistics of another instance are added to the ones of the modules with the same name
+        momemta::Profiler other = *profiler;
+        profiler->merge(other);
+        REQUIRE(profiler->profile().at(0).calls == 200);
+        REQUIRE(profiler->profile().at(0).next == 20);
+    }
+
     SECTION("BlockA") {
 
         parameters.reset(new ParameterSetMock("BlockA"));
@@ -271,11 +372,14 @@ TEST_CASE("Modules", "[modules]") {
         parameters->set("branches", std::vector<InputTag>({InputTag("input", "particles", 2)}));
 
         Value<SolutionCollection> solutions = pool->get<SolutionCollection>({"BlockC", "solutions"});
+        Value<double> recovered_solutions = pool->get<double>({"BlockC", "recovered_solutions"});
 
         auto module = createModule("BlockC");
 
         REQUIRE(module->work() == Module::Status::OK);
         REQUIRE(solutions->size() >= 2);
+        // Polishing is disabled
+        REQUIRE(*recovered_solutions == 0);
 
         for (const auto& solution : *solutions) {
             REQUIRE(solution.valid == true);
@@ -328,11 +432,14 @@ TEST_CASE("Modules", "[modules]") {
         parameters->set("p6", InputTag("input", "particles", 3));
 
         Value<SolutionCollection> solutions = pool->get<SolutionCollection>({"BlockD", "solutions"});
+        Value<double> recovered_solutions = pool->get<double>({"BlockD", "recovered_solutions"});
 
         auto module = createModule("BlockD");
 
         REQUIRE(module->work() == Module::Status::OK);
         REQUIRE(solutions->size() == 2);
+        // Polishing is disabled
+        REQUIRE(*recovered_solutions == 0);
 
         for (const auto& solution: *solutions) {
             REQUIRE(solution.valid == true);
@@ -353,6 +460,23 @@ TEST_CASE("Modules", "[modules]") {
             REQUIRE(solution.values.at(0).M() / solution.values.at(0).E() == Approx(0).margin(std::numeric_limits<float>::epsilon()));
             REQUIRE(solution.values.at(1).M() / solution.values.at(1).E() == Approx(0).margin(std::numeric_limits<float>::epsilon()));
         }
+
+        // Coefficients depending only on the particles are cached, and must be updated when the particles change
+        std::swap(input_particles->at(0), input_particles->at(2));
+        std::swap(input_particles->at(1), input_particles->at(3));
+
+        REQUIRE(module->work() == Module::Status::OK);
+        REQUIRE(solutions->size() == 2);
+
+        for (const auto& solution: *solutions) {
+            LorentzVector test_p13 = input_particles->at(0) + solution.values.at(0);
+            LorentzVector test_p25 = input_particles->at(2) + solution.values.at(1);
+
+            REQUIRE(test_p13.M2() == Approx(s_13_25));
+            REQUIRE((input_particles->at(1) + test_p13).M2() == Approx(s_134_256));
+            REQUIRE(test_p25.M2() == Approx(s_13_25));
+            REQUIRE((input_particles->at(3) + test_p25).M2() == Approx(s_134_256));
+        }
     }
 
     SECTION("BlockE") {
@@ -479,11 +603,14 @@ TEST_CASE("Modules", "[modules]") {
         parameters->set("p4", InputTag("input", "particles", 7));
 
         Value<SolutionCollection> solutions = pool->get<SolutionCollection>({"BlockG", "solutions"});
+        Value<double> recovered_solutions = pool->get<double>({"BlockG", "recovered_solutions"});
 
         auto module = createModule("BlockG");
 
         REQUIRE(module->work() == Module::Status::OK);
         REQUIRE(solutions->size() == 1);
+        // Polishing is disabled
+        REQUIRE(*recovered_solutions == 0);
 
         for (const auto& solution: *solutions) {
             REQUIRE(solution.valid == true);
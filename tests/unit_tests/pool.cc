@@ -88,4 +88,58 @@ TEST_CASE("memory pool", "[pool]") {
 
         REQUIRE(*value == Approx(1));
     }
-}
\ No newline at end of file
+
+    SECTION("Values point directly to the blocks") {
+        InputTag tag("module", "parameter");
+        InputTag other_tag("module", "other_parameter");
+
+        auto value = pool->get<double>(tag);
+        auto ptr = pool->put<double>(tag);
+        auto other_ptr = pool->put<double>(other_tag);
+
+        REQUIRE(value.get() == ptr.get());
+
+        // Blocks are allocated on separate cache lines
+        auto address = reinterpret_cast<std::uintptr_t>(ptr.get());
+        auto other_address = reinterpret_cast<std::uintptr_t>(other_ptr.get());
+        REQUIRE((other_address > address ? other_address - address : address - other_address) >=
+                momemta::PoolArena::ALIGNMENT);
+    }
+
+    SECTION("Values remain valid after the pool is destroyed") {
+        InputTag tag("module", "parameter");
+
+        auto ptr = pool->put<std::vector<double>>(tag);
+        ptr->push_back(2.5);
+
+        auto value = pool->get<double>(InputTag("module", "parameter", 0));
+        pool.reset();
+
+        REQUIRE(*value == Approx(2.5));
+    }
+
+    SECTION("Blocks can be copied for each point of a batch") {
+        InputTag tag("module", "parameter");
+
+        auto ptr = pool->put<std::vector<double>>(tag);
+        auto value = pool->get<double>(InputTag("module", "parameter", 1));
+
+        auto copies = pool->copies(InputTag("module", "parameter", 1));
+        copies.reserve(2);
+
+        *ptr = {1, 2};
+        copies.save(0);
+        *ptr = {3, 4, 5};
+        copies.save(1);
+
+        copies.restore(0);
+        REQUIRE(ptr->size() == 2);
+        REQUIRE(*value == Approx(2));
+
+        copies.restore(1);
+        REQUIRE(ptr->size() == 3);
+        REQUIRE(*value == Approx(4));
+
+        CHECK_THROWS_AS(pool->copies(InputTag("module", "other")), Pool::tag_not_found_error);
+    }
+}